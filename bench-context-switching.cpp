@@ -7,6 +7,14 @@
 #include <unistd.h>
 
 #include "libfiber/fiber.h"
+#include "libfiber/fiber_context_inline.h"
+#include "libfiber/fiber_scheduler.h"
+#include "libfiber/fiber_io.h"
+#include "libfiber/fiber_sync.h"
+#include "libfiber/fiber_stats.h"
+
+#include "bench-support-perf.h"
+#include "bench-support-histogram.h"
 
 #define MSG_TEXT "tst"
 #define MSG_TEXT_SIZE (strlen(MSG_TEXT) + 1)
@@ -66,8 +74,11 @@ void BM_ContextSwitching_Reference(benchmark::State& state) {
         return;
     }
 
+    BenchHistogram histogram(state, __func__);
+    BenchPerfCounters perf_counters(state);
     // Measure ops
     for (auto _ : state) {
+        histogram.Start();
         if (write(fds[1], write_buf, MSG_TEXT_SIZE) != MSG_TEXT_SIZE) {
             perror("write loop");
             break;
@@ -77,7 +88,9 @@ void BM_ContextSwitching_Reference(benchmark::State& state) {
             perror("read loop");
             break;
         }
+        histogram.Stop();
     }
+    perf_counters.Stop();
 
     close(fds[0]);
     close(fds[1]);
@@ -127,8 +140,11 @@ void BM_ContextSwitching_OsOverheadUnpinned(benchmark::State& state) {
         return;
     }
 
+    BenchHistogram histogram(state, __func__);
+    BenchPerfCounters perf_counters(state);
     // Measure ops
     for (auto _ : state) {
+        histogram.Start();
         if (write(main_fds.write_fd, write_buf, MSG_TEXT_SIZE) != MSG_TEXT_SIZE) {
             perror("write loop");
             break;
@@ -138,7 +154,9 @@ void BM_ContextSwitching_OsOverheadUnpinned(benchmark::State& state) {
             perror("read loop");
             break;
         }
+        histogram.Stop();
     }
+    perf_counters.Stop();
 
     close(main_fds.write_fd);
     close(main_fds.read_fd);
@@ -200,8 +218,11 @@ void BM_ContextSwitching_OsOverheadPinned(benchmark::State& state) {
         return;
     }
 
+    BenchHistogram histogram(state, __func__);
+    BenchPerfCounters perf_counters(state);
     // Measure ops
     for (auto _ : state) {
+        histogram.Start();
         if (write(main_fds.write_fd, write_buf, MSG_TEXT_SIZE) != MSG_TEXT_SIZE) {
             perror("write loop");
             break;
@@ -211,7 +232,9 @@ void BM_ContextSwitching_OsOverheadPinned(benchmark::State& state) {
             perror("read loop");
             break;
         }
+        histogram.Stop();
     }
+    perf_counters.Stop();
 
     close(main_fds.write_fd);
     close(main_fds.read_fd);
@@ -221,6 +244,99 @@ void BM_ContextSwitching_OsOverheadPinned(benchmark::State& state) {
     }
 }
 
+typedef struct condvar_info condvar_info_t;
+struct condvar_info {
+    pthread_mutex_t mutex;
+    pthread_cond_t main_to_child_cond;
+    pthread_cond_t child_to_main_cond;
+    bool main_to_child;
+    bool child_to_main;
+    bool stop;
+};
+
+void* condvar_thread_func(void* p) {
+    auto condvar_info = (condvar_info_t*)p;
+
+    pthread_mutex_lock(&condvar_info->mutex);
+    while (true) {
+        while (!condvar_info->main_to_child && !condvar_info->stop) {
+            pthread_cond_wait(&condvar_info->main_to_child_cond, &condvar_info->mutex);
+        }
+
+        if (condvar_info->stop) {
+            break;
+        }
+
+        condvar_info->main_to_child = false;
+        condvar_info->child_to_main = true;
+        pthread_cond_signal(&condvar_info->child_to_main_cond);
+    }
+    pthread_mutex_unlock(&condvar_info->mutex);
+
+    return nullptr;
+}
+
+void condvar_ping_pong(benchmark::State& state, bool pinned) {
+    uint core_index;
+    cpu_set_t cpuset;
+    condvar_info_t condvar_info = {
+            .mutex = PTHREAD_MUTEX_INITIALIZER,
+            .main_to_child_cond = PTHREAD_COND_INITIALIZER,
+            .child_to_main_cond = PTHREAD_COND_INITIALIZER,
+            .main_to_child = false,
+            .child_to_main = false,
+            .stop = false,
+    };
+
+    pthread_t child_thread;
+    pthread_create(&child_thread, nullptr, condvar_thread_func, (void*)&condvar_info);
+
+    if (pinned) {
+        getcpu(&core_index, nullptr);
+        CPU_ZERO(&cpuset);
+        CPU_SET(core_index, &cpuset);
+        pthread_setaffinity_np(child_thread, sizeof(cpu_set_t), &cpuset);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    }
+
+    BenchHistogram histogram(
+            state,
+            pinned ? "BM_ContextSwitching_CondvarOverheadPinned" : "BM_ContextSwitching_CondvarOverheadUnpinned");
+    BenchPerfCounters perf_counters(state);
+    // Measure ops
+    for (auto _ : state) {
+        histogram.Start();
+        pthread_mutex_lock(&condvar_info.mutex);
+        condvar_info.main_to_child = true;
+        pthread_cond_signal(&condvar_info.main_to_child_cond);
+
+        while (!condvar_info.child_to_main) {
+            pthread_cond_wait(&condvar_info.child_to_main_cond, &condvar_info.mutex);
+        }
+        condvar_info.child_to_main = false;
+        pthread_mutex_unlock(&condvar_info.mutex);
+        histogram.Stop();
+    }
+    perf_counters.Stop();
+
+    pthread_mutex_lock(&condvar_info.mutex);
+    condvar_info.stop = true;
+    pthread_cond_signal(&condvar_info.main_to_child_cond);
+    pthread_mutex_unlock(&condvar_info.mutex);
+
+    if (pthread_join(child_thread, nullptr)) {
+        perror("pthread_join");
+    }
+}
+
+void BM_ContextSwitching_CondvarOverheadUnpinned(benchmark::State& state) {
+    condvar_ping_pong(state, false);
+}
+
+void BM_ContextSwitching_CondvarOverheadPinned(benchmark::State& state) {
+    condvar_ping_pong(state, true);
+}
+
 [[noreturn]]
 void fiber_func(fiber_t* fiber_from, fiber_t* fiber_to) {
     while (true) {
@@ -240,13 +356,356 @@ void BM_ContextSwitching_Fiber2XPinnedOverhead(benchmark::State& state) {
 
     fiber_t* child_fiber = fiber_new(getpagesize() * 8, fiber_func, nullptr);
 
+    BenchHistogram histogram(state, __func__);
+    BenchPerfCounters perf_counters(state);
     for (auto _ : state) {
+        histogram.Start();
         fiber_context_swap(&main_context, child_fiber);
+        histogram.Stop();
     }
+    perf_counters.Stop();
 
     fiber_free(child_fiber);
 }
 
+[[noreturn]]
+void fiber_stats_func(fiber_t* fiber_from, fiber_t* fiber_to) {
+    while (true) {
+        fiber_stats_context_swap(fiber_to, fiber_from);
+    }
+}
+
+// Same as BM_ContextSwitching_Fiber2XPinnedOverhead with the stats updated at every swap, to measure the overhead of
+// the instrumentation the benchmarks have to be built with -DFIBER_STATS=ON
+void BM_ContextSwitching_Fiber2XPinnedOverheadStats(benchmark::State& state) {
+    uint core_index;
+    cpu_set_t cpuset;
+    fiber_t main_context = { 0 };
+
+    getcpu(&core_index, nullptr);
+    CPU_ZERO(&cpuset);
+    CPU_SET(core_index, &cpuset);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+
+    fiber_t* child_fiber = fiber_new(getpagesize() * 8, fiber_stats_func, nullptr);
+
+    BenchHistogram histogram(state, __func__);
+    BenchPerfCounters perf_counters(state);
+    for (auto _ : state) {
+        histogram.Start();
+        fiber_stats_context_swap(&main_context, child_fiber);
+        histogram.Stop();
+    }
+    perf_counters.Stop();
+
+#if FIBER_STATS_ENABLED == 1
+    fiber_stats_t stats;
+    fiber_stats_get(child_fiber, &stats);
+
+    state.counters["swaps_in"] = (double)stats.swaps_in;
+    state.counters["cycles_per_run"] = (double)stats.cycles_on_cpu / (double)stats.swaps_out;
+    state.counters["stack_used"] = (double)stats.stack_used;
+#else
+    state.SetLabel("stats disabled");
+#endif
+
+    fiber_free(child_fiber);
+}
+
+typedef void (fiber_context_swap_fp_t)(fiber_t* fiber_context_from, fiber_t* fiber_context_to);
+
+template <fiber_context_swap_fp_t fiber_context_swap_fp>
+[[noreturn]]
+void fiber_inline_func(fiber_t* fiber_from, fiber_t* fiber_to) {
+    while (true) {
+        fiber_context_swap_fp(fiber_to, fiber_from);
+    }
+}
+
+template <fiber_context_swap_fp_t fiber_context_swap_fp>
+void BM_ContextSwitching_Fiber2XPinnedOverheadInline(benchmark::State& state) {
+    uint core_index;
+    cpu_set_t cpuset;
+    fiber_t main_context = { 0 };
+
+    getcpu(&core_index, nullptr);
+    CPU_ZERO(&cpuset);
+    CPU_SET(core_index, &cpuset);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+
+    fiber_t* child_fiber = fiber_new(getpagesize() * 8, fiber_inline_func<fiber_context_swap_fp>, nullptr);
+
+    BenchHistogram histogram(state, __PRETTY_FUNCTION__);
+    BenchPerfCounters perf_counters(state);
+    // The swap is a template argument, the inline variants are expanded in the loop
+    for (auto _ : state) {
+        histogram.Start();
+        fiber_context_swap_fp(&main_context, child_fiber);
+        histogram.Stop();
+    }
+    perf_counters.Stop();
+
+    fiber_free(child_fiber);
+}
+
+typedef struct fiber_io_uring_ping_info fiber_io_uring_ping_info_t;
+struct fiber_io_uring_ping_info {
+    benchmark::State* state;
+    pipe_info_t fds;
+};
+
+void fiber_io_uring_echo_func(void* user_data) {
+    char read_buf[MSG_TEXT_SIZE] = { 0 };
+    auto pipe_info = (pipe_info_t*)user_data;
+
+    while (true) {
+        int read_rc = fiber_read(pipe_info->read_fd, read_buf, MSG_TEXT_SIZE);
+
+        if (read_rc < 0) {
+            perror("read fiber");
+            break;
+        } else if (read_rc != MSG_TEXT_SIZE) {
+            break;
+        }
+
+        if (fiber_write(pipe_info->write_fd, read_buf, MSG_TEXT_SIZE) != MSG_TEXT_SIZE) {
+            perror("write fiber");
+            break;
+        }
+    }
+
+    close(pipe_info->read_fd);
+    close(pipe_info->write_fd);
+}
+
+void fiber_io_uring_ping_func(void* user_data) {
+    const char write_buf[MSG_TEXT_SIZE] = MSG_TEXT;
+    char read_buf[MSG_TEXT_SIZE] = { 0 };
+    auto ping_info = (fiber_io_uring_ping_info_t*)user_data;
+    benchmark::State& state = *ping_info->state;
+
+    // Self test
+    if (fiber_write(ping_info->fds.write_fd, write_buf, MSG_TEXT_SIZE) != MSG_TEXT_SIZE) {
+        perror("write self-test");
+        state.SkipWithError("write self-test");
+    } else if (fiber_read(ping_info->fds.read_fd, read_buf, MSG_TEXT_SIZE) != MSG_TEXT_SIZE) {
+        perror("read self-test");
+        state.SkipWithError("read self-test");
+    } else if (strcmp(read_buf, write_buf) != 0) {
+        fprintf(stderr, "buffers mismatch\n");
+        state.SkipWithError("buffers mismatch");
+    }
+
+    BenchHistogram histogram(state, "BM_ContextSwitching_FiberIoUring");
+    BenchPerfCounters perf_counters(state);
+    // Measure ops, the state loop runs inside the fiber on the scheduler worker thread
+    for (auto _ : state) {
+        histogram.Start();
+        if (fiber_write(ping_info->fds.write_fd, write_buf, MSG_TEXT_SIZE) != MSG_TEXT_SIZE) {
+            perror("write loop");
+            break;
+        }
+
+        if (fiber_read(ping_info->fds.read_fd, read_buf, MSG_TEXT_SIZE) != MSG_TEXT_SIZE) {
+            perror("read loop");
+            break;
+        }
+        histogram.Stop();
+    }
+    perf_counters.Stop();
+
+    // Closing the write end terminates the echo fiber
+    close(ping_info->fds.write_fd);
+    close(ping_info->fds.read_fd);
+}
+
+void BM_ContextSwitching_FiberIoUring(benchmark::State& state) {
+    int main_to_child[2], child_to_main[2];
+
+    if (!fiber_io_uring_is_supported()) {
+        state.SkipWithError("io_uring not supported");
+        return;
+    }
+
+    if (pipe(main_to_child) == -1) {
+        perror("pipe main_to_child");
+        return;
+    }
+
+    if (pipe(child_to_main) == -1) {
+        perror("pipe child_to_main");
+        return;
+    }
+
+    fiber_io_uring_ping_info_t main_info = {
+            .state = &state,
+            .fds = {
+                    .read_fd = child_to_main[0],
+                    .write_fd = main_to_child[1]
+            }
+    };
+
+    pipe_info_t child_fds = {
+            .read_fd = main_to_child[0],
+            .write_fd = child_to_main[1]
+    };
+
+    // A single worker runs both fibers, the same as the two pinned threads of BM_ContextSwitching_OsOverheadPinned
+    fiber_scheduler_t* scheduler = fiber_scheduler_new(1, getpagesize() * 8);
+    fiber_spawn(scheduler, fiber_io_uring_echo_func, &child_fds);
+    fiber_spawn(scheduler, fiber_io_uring_ping_func, &main_info);
+    fiber_scheduler_run(scheduler);
+    fiber_scheduler_free(scheduler);
+}
+
+typedef struct fiber_channel_info fiber_channel_info_t;
+struct fiber_channel_info {
+    benchmark::State* state;
+    const char* name;
+    fiber_channel_t* main_to_child;
+    fiber_channel_t* child_to_main;
+};
+
+void fiber_channel_echo_func(void* user_data) {
+    void* item;
+    auto channel_info = (fiber_channel_info_t*)user_data;
+
+    while (fiber_channel_recv(channel_info->main_to_child, &item)) {
+        if (!fiber_channel_send(channel_info->child_to_main, item)) {
+            break;
+        }
+    }
+}
+
+void fiber_channel_ping_func(void* user_data) {
+    void* item;
+    auto channel_info = (fiber_channel_info_t*)user_data;
+    benchmark::State& state = *channel_info->state;
+
+    BenchHistogram histogram(state, channel_info->name);
+    BenchPerfCounters perf_counters(state);
+    // Measure ops, the state loop runs inside the fiber on the scheduler worker thread
+    for (auto _ : state) {
+        histogram.Start();
+        fiber_channel_send(channel_info->main_to_child, (void*)MSG_TEXT);
+        fiber_channel_recv(channel_info->child_to_main, &item);
+        histogram.Stop();
+    }
+    perf_counters.Stop();
+
+    // Closing the channel terminates the echo fiber
+    fiber_channel_close(channel_info->main_to_child);
+}
+
+void BM_ContextSwitching_FiberChannel(benchmark::State& state) {
+    fiber_channel_info_t channel_info = {
+            .state = &state,
+            .name = __func__,
+            .main_to_child = fiber_channel_new(1),
+            .child_to_main = fiber_channel_new(1),
+    };
+
+    fiber_scheduler_t* scheduler = fiber_scheduler_new(1, getpagesize() * 8);
+    fiber_spawn(scheduler, fiber_channel_echo_func, &channel_info);
+    fiber_spawn(scheduler, fiber_channel_ping_func, &channel_info);
+    fiber_scheduler_run(scheduler);
+    fiber_scheduler_free(scheduler);
+
+    fiber_channel_free(channel_info.main_to_child);
+    fiber_channel_free(channel_info.child_to_main);
+}
+
+void BM_ContextSwitching_FiberRemoteWakeup(benchmark::State& state) {
+    fiber_channel_info_t channel_info = {
+            .state = &state,
+            .name = __func__,
+            .main_to_child = fiber_channel_new(1),
+            .child_to_main = fiber_channel_new(1),
+    };
+
+    // The fibers run on two different workers, every message resumes a fiber parked on the other worker through its
+    // remote queue, compare with BM_ContextSwitching_OsOverheadPinned
+    fiber_scheduler_t* scheduler = fiber_scheduler_new(2, getpagesize() * 8);
+    fiber_spawn_on_worker(scheduler, 1, fiber_channel_echo_func, &channel_info);
+    fiber_spawn_on_worker(scheduler, 0, fiber_channel_ping_func, &channel_info);
+    fiber_scheduler_run(scheduler);
+    fiber_scheduler_free(scheduler);
+
+    fiber_channel_free(channel_info.main_to_child);
+    fiber_channel_free(channel_info.child_to_main);
+}
+
+typedef struct fiber_condvar_info fiber_condvar_info_t;
+struct fiber_condvar_info {
+    benchmark::State* state;
+    fiber_mutex_t mutex;
+    fiber_cond_t main_to_child_cond;
+    fiber_cond_t child_to_main_cond;
+    bool main_to_child;
+    bool child_to_main;
+    bool stop;
+};
+
+void fiber_condvar_echo_func(void* user_data) {
+    auto condvar_info = (fiber_condvar_info_t*)user_data;
+
+    fiber_mutex_lock(&condvar_info->mutex);
+    while (true) {
+        while (!condvar_info->main_to_child && !condvar_info->stop) {
+            fiber_cond_wait(&condvar_info->main_to_child_cond, &condvar_info->mutex);
+        }
+
+        if (condvar_info->stop) {
+            break;
+        }
+
+        condvar_info->main_to_child = false;
+        condvar_info->child_to_main = true;
+        fiber_cond_signal(&condvar_info->child_to_main_cond);
+    }
+    fiber_mutex_unlock(&condvar_info->mutex);
+}
+
+void fiber_condvar_ping_func(void* user_data) {
+    auto condvar_info = (fiber_condvar_info_t*)user_data;
+    benchmark::State& state = *condvar_info->state;
+
+    BenchHistogram histogram(state, "BM_ContextSwitching_FiberCondvar");
+    BenchPerfCounters perf_counters(state);
+    for (auto _ : state) {
+        histogram.Start();
+        fiber_mutex_lock(&condvar_info->mutex);
+        condvar_info->main_to_child = true;
+        fiber_cond_signal(&condvar_info->main_to_child_cond);
+
+        while (!condvar_info->child_to_main) {
+            fiber_cond_wait(&condvar_info->child_to_main_cond, &condvar_info->mutex);
+        }
+        condvar_info->child_to_main = false;
+        fiber_mutex_unlock(&condvar_info->mutex);
+        histogram.Stop();
+    }
+    perf_counters.Stop();
+
+    fiber_mutex_lock(&condvar_info->mutex);
+    condvar_info->stop = true;
+    fiber_cond_signal(&condvar_info->main_to_child_cond);
+    fiber_mutex_unlock(&condvar_info->mutex);
+}
+
+void BM_ContextSwitching_FiberCondvar(benchmark::State& state) {
+    fiber_condvar_info_t condvar_info = { .state = &state };
+    fiber_mutex_init(&condvar_info.mutex);
+    fiber_cond_init(&condvar_info.main_to_child_cond);
+    fiber_cond_init(&condvar_info.child_to_main_cond);
+
+    fiber_scheduler_t* scheduler = fiber_scheduler_new(1, getpagesize() * 8);
+    fiber_spawn(scheduler, fiber_condvar_echo_func, &condvar_info);
+    fiber_spawn(scheduler, fiber_condvar_ping_func, &condvar_info);
+    fiber_scheduler_run(scheduler);
+    fiber_scheduler_free(scheduler);
+}
+
 static void BenchArguments(benchmark::internal::Benchmark* b) {
     b->Iterations(1000000);
 }
@@ -257,5 +716,25 @@ BENCHMARK(BM_ContextSwitching_OsOverheadUnpinned)
         ->Apply(BenchArguments);
 BENCHMARK(BM_ContextSwitching_OsOverheadPinned)
         ->Apply(BenchArguments);
+BENCHMARK(BM_ContextSwitching_CondvarOverheadUnpinned)
+        ->Apply(BenchArguments);
+BENCHMARK(BM_ContextSwitching_CondvarOverheadPinned)
+        ->Apply(BenchArguments);
 BENCHMARK(BM_ContextSwitching_Fiber2XPinnedOverhead)
         ->Apply(BenchArguments);
+BENCHMARK(BM_ContextSwitching_Fiber2XPinnedOverheadStats)
+        ->Apply(BenchArguments);
+BENCHMARK_TEMPLATE(BM_ContextSwitching_Fiber2XPinnedOverheadInline, fiber_context_swap_inline_minimal)
+        ->Apply(BenchArguments);
+BENCHMARK_TEMPLATE(BM_ContextSwitching_Fiber2XPinnedOverheadInline, fiber_context_swap_inline_fpu)
+        ->Apply(BenchArguments);
+BENCHMARK_TEMPLATE(BM_ContextSwitching_Fiber2XPinnedOverheadInline, fiber_context_swap_inline_full)
+        ->Apply(BenchArguments);
+BENCHMARK(BM_ContextSwitching_FiberIoUring)
+        ->Apply(BenchArguments);
+BENCHMARK(BM_ContextSwitching_FiberChannel)
+        ->Apply(BenchArguments);
+BENCHMARK(BM_ContextSwitching_FiberCondvar)
+        ->Apply(BenchArguments);
+BENCHMARK(BM_ContextSwitching_FiberRemoteWakeup)
+        ->Apply(BenchArguments);
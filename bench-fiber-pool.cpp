@@ -0,0 +1,76 @@
+#include <stdint.h>
+#include <unistd.h>
+#include <benchmark/benchmark.h>
+
+#include "libfiber/fiber.h"
+#include "libfiber/fiber_pool.h"
+
+#include "bench-support-perf.h"
+
+typedef struct fiber_allocator_new fiber_allocator_new_t;
+struct fiber_allocator_new {
+    size_t stack_size;
+
+    explicit fiber_allocator_new(size_t stack_size) : stack_size(stack_size) { }
+
+    fiber_t* acquire(fiber_start_fp_t* fiber_start_fp, void* user_data) {
+        return fiber_new(stack_size, fiber_start_fp, user_data);
+    }
+
+    void release(fiber_t* fiber) {
+        fiber_free(fiber);
+    }
+};
+
+typedef struct fiber_allocator_pool fiber_allocator_pool_t;
+struct fiber_allocator_pool {
+    fiber_pool_t* pool;
+
+    explicit fiber_allocator_pool(size_t stack_size) : pool(fiber_pool_new(stack_size, FIBER_STACK_TYPE_ALIGNED_ALLOC, 0)) { }
+    ~fiber_allocator_pool() {
+        fiber_pool_free(pool);
+    }
+
+    fiber_t* acquire(fiber_start_fp_t* fiber_start_fp, void* user_data) {
+        return fiber_pool_acquire(pool, fiber_start_fp, user_data);
+    }
+
+    void release(fiber_t* fiber) {
+        fiber_pool_release(pool, fiber);
+    }
+};
+
+[[noreturn]]
+void fiber_pool_func(fiber_t* fiber_from, fiber_t* fiber_to) {
+    while (true) {
+        fiber_context_swap(fiber_to, fiber_from);
+    }
+}
+
+template <typename T>
+void BM_Fiber_CreateDestroy(benchmark::State& state) {
+    size_t stack_size = getpagesize() * state.range(0);
+    fiber_t main_context = { 0 };
+    T allocator(stack_size);
+
+    BenchPerfCounters perf_counters(state);
+    // Every fiber is switched in once to ensure that a reused fiber starts again from the entrypoint
+    for (auto _ : state) {
+        fiber_t* fiber = allocator.acquire(fiber_pool_func, nullptr);
+        fiber_context_swap(&main_context, fiber);
+        allocator.release(fiber);
+    }
+    perf_counters.Stop();
+}
+
+static void BenchArguments(benchmark::internal::Benchmark* b) {
+    b->Arg(8);
+    b->Arg(64);
+    b->Arg(256);
+    b->Iterations(10000);
+}
+
+BENCHMARK_TEMPLATE(BM_Fiber_CreateDestroy, fiber_allocator_new_t)
+        ->Apply(BenchArguments);
+BENCHMARK_TEMPLATE(BM_Fiber_CreateDestroy, fiber_allocator_pool_t)
+        ->Apply(BenchArguments);
@@ -0,0 +1,106 @@
+#include <stdint.h>
+#include <unistd.h>
+#include <benchmark/benchmark.h>
+
+#include "libfiber/fiber.h"
+#include "libfiber/fiber_scheduler.h"
+
+#include "bench-support-perf.h"
+
+typedef struct benchmark_params benchmark_params_t;
+struct benchmark_params {
+    uint32_t yield_fibers_count;
+    uint32_t yield_per_fiber;
+    uint32_t spawn_root_fibers_count;
+    uint32_t spawn_per_root_fiber;
+};
+static benchmark_params_t benchmark_params = {
+        .yield_fibers_count = 1000,
+        .yield_per_fiber = 1000,
+        .spawn_root_fibers_count = 100,
+        .spawn_per_root_fiber = 1000,
+};
+
+void fiber_scheduler_yield_func(void* user_data) {
+    for(uint32_t yield_index = 0; yield_index < benchmark_params.yield_per_fiber; yield_index++) {
+        fiber_yield();
+    }
+}
+
+void fiber_scheduler_empty_func(void* user_data) {
+    benchmark::ClobberMemory();
+}
+
+void fiber_scheduler_spawn_func(void* user_data) {
+    auto scheduler = (fiber_scheduler_t*)user_data;
+
+    // Yields after every spawn to let the child run, keeps the number of fibers alive at the same time bounded
+    for(uint32_t spawn_index = 0; spawn_index < benchmark_params.spawn_per_root_fiber; spawn_index++) {
+        fiber_spawn(scheduler, fiber_scheduler_empty_func, nullptr);
+        fiber_yield();
+    }
+}
+
+void BM_FiberScheduler_Yield(benchmark::State& state) {
+    uint32_t workers_count = state.range(0);
+    fiber_scheduler_t* scheduler = fiber_scheduler_new(workers_count, getpagesize() * 8);
+
+    BenchPerfCounters perf_counters(state);
+    for (auto _ : state) {
+        for(uint32_t fiber_index = 0; fiber_index < benchmark_params.yield_fibers_count; fiber_index++) {
+            fiber_spawn(scheduler, fiber_scheduler_yield_func, nullptr);
+        }
+
+        fiber_scheduler_run(scheduler);
+    }
+    perf_counters.Stop();
+
+    uint64_t yields = state.iterations() * benchmark_params.yield_fibers_count * benchmark_params.yield_per_fiber;
+    state.SetItemsProcessed((int64_t)yields);
+    state.counters["yield_ns"] = benchmark::Counter(
+            (double)yields,
+            benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+
+    fiber_scheduler_free(scheduler);
+}
+
+void BM_FiberScheduler_Spawn(benchmark::State& state) {
+    uint32_t workers_count = state.range(0);
+    fiber_scheduler_t* scheduler = fiber_scheduler_new(workers_count, getpagesize() * 8);
+
+    BenchPerfCounters perf_counters(state);
+    for (auto _ : state) {
+        for(uint32_t fiber_index = 0; fiber_index < benchmark_params.spawn_root_fibers_count; fiber_index++) {
+            fiber_spawn(scheduler, fiber_scheduler_spawn_func, scheduler);
+        }
+
+        fiber_scheduler_run(scheduler);
+    }
+    perf_counters.Stop();
+
+    uint64_t spawns = state.iterations() * benchmark_params.spawn_root_fibers_count *
+            (benchmark_params.spawn_per_root_fiber + 1);
+    state.SetItemsProcessed((int64_t)spawns);
+    state.counters["spawn_ns"] = benchmark::Counter(
+            (double)spawns,
+            benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+
+    fiber_scheduler_free(scheduler);
+}
+
+static void BenchArguments(benchmark::internal::Benchmark* b) {
+    long cores_count = sysconf(_SC_NPROCESSORS_ONLN);
+
+    for(long workers_count = 1; workers_count < cores_count; workers_count *= 2) {
+        b->Arg(workers_count);
+    }
+    b->Arg(cores_count);
+    b->Iterations(10);
+    b->Unit(benchmark::kMillisecond);
+    b->UseRealTime();
+}
+
+BENCHMARK(BM_FiberScheduler_Yield)
+        ->Apply(BenchArguments);
+BENCHMARK(BM_FiberScheduler_Spawn)
+        ->Apply(BenchArguments);
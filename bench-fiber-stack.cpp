@@ -0,0 +1,112 @@
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <fstream>
+#include <benchmark/benchmark.h>
+#include <unistd.h>
+
+#include "libfiber/fiber.h"
+
+#include "bench-support-perf.h"
+
+#define FIBER_STACK_TOUCH_SIZE 512
+
+static uint64_t GetProcessRss() {
+    uint64_t size = 0, resident = 0;
+    std::ifstream statm("/proc/self/statm");
+
+    statm >> size >> resident;
+
+    return resident * getpagesize();
+}
+
+static uint64_t GetProcfsValue(const char* path, const char* key) {
+    std::string line;
+    std::ifstream file(path);
+
+    while (std::getline(file, line)) {
+        if (key == nullptr) {
+            return std::stoull(line);
+        }
+
+        if (line.starts_with(key)) {
+            return std::stoull(line.substr(line.find(':') + 1)) * 1024;
+        }
+    }
+
+    return 0;
+}
+
+[[noreturn]]
+void fiber_stack_func(fiber_t* fiber_from, fiber_t* fiber_to) {
+    // Touches a bit of stack to simulate a fiber parked in the middle of some work
+    char buffer[FIBER_STACK_TOUCH_SIZE];
+    memset(buffer, 1, FIBER_STACK_TOUCH_SIZE);
+    benchmark::DoNotOptimize(buffer);
+
+    while (true) {
+        fiber_context_swap(fiber_to, fiber_from);
+    }
+}
+
+template <fiber_stack_type_t stack_type>
+void BM_Fiber_Stack_RoundRobin(benchmark::State& state) {
+    uint64_t fibers_count = state.range(0);
+    size_t stack_size = getpagesize() * 8;
+    fiber_t main_context = { 0 };
+
+    // Every stack is split from the surrounding mappings by its guard page, each fiber needs 2 entries
+    if (GetProcfsValue("/proc/sys/vm/max_map_count", nullptr) < fibers_count * 2 + 1024) {
+        state.SkipWithError("vm.max_map_count too low, it has to be at least twice the number of fibers");
+        return;
+    }
+
+    if (stack_type == FIBER_STACK_TYPE_ALIGNED_ALLOC &&
+        GetProcfsValue("/proc/meminfo", "MemAvailable") < fibers_count * stack_size) {
+        state.SkipWithError("Not enough memory available to commit all the stacks upfront");
+        return;
+    }
+
+    uint64_t rss_before = GetProcessRss();
+
+    auto fibers = (fiber_t**)malloc(sizeof(fiber_t*) * fibers_count);
+    for(uint64_t index = 0; index < fibers_count; index++) {
+        fibers[index] = fiber_new_with_stack_type(stack_size, stack_type, fiber_stack_func, nullptr);
+        fiber_context_swap(&main_context, fibers[index]);
+    }
+
+    uint64_t rss_after = GetProcessRss();
+
+    // With this many fibers the stack and the context being switched in are never in cache
+    uint64_t fiber_index = 0;
+    BenchPerfCounters perf_counters(state);
+    for (auto _ : state) {
+        fiber_context_swap(&main_context, fibers[fiber_index]);
+
+        if (++fiber_index == fibers_count) {
+            fiber_index = 0;
+        }
+    }
+    perf_counters.Stop();
+
+    state.counters["rss_mb"] = (double)(rss_after - rss_before) / (1024 * 1024);
+    state.counters["rss_per_fiber"] = (double)(rss_after - rss_before) / (double)fibers_count;
+    state.counters["stack_high_water"] = (double)fiber_stack_get_high_water_mark(fibers[0]);
+
+    for(uint64_t index = 0; index < fibers_count; index++) {
+        fiber_free(fibers[index]);
+    }
+    free(fibers);
+}
+
+static void BenchArguments(benchmark::internal::Benchmark* b) {
+    b->Arg(10000);
+    b->Arg(100000);
+    b->Arg(1000000);
+    b->Iterations(1000000);
+}
+
+BENCHMARK_TEMPLATE(BM_Fiber_Stack_RoundRobin, FIBER_STACK_TYPE_ALIGNED_ALLOC)
+        ->Apply(BenchArguments);
+BENCHMARK_TEMPLATE(BM_Fiber_Stack_RoundRobin, FIBER_STACK_TYPE_MMAP)
+        ->Apply(BenchArguments);
@@ -0,0 +1,239 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <benchmark/benchmark.h>
+
+#include "libfiber/fiber.h"
+#include "libfiber/fiber_scheduler.h"
+#include "libfiber/fiber_timer_wheel.h"
+
+#include "bench-support-perf.h"
+
+// Spread the timers over 10 seconds with 100us ticks, most of them end up in the second and third level of the wheel
+#define BENCH_TIMER_TICK_NS 100000ull
+#define BENCH_TIMER_RANGE_NS 10000000000ull
+
+void fiber_timer_bench_callback(fiber_timer_t* timer, void* user_data) {
+    benchmark::DoNotOptimize(timer);
+}
+
+static uint64_t* GenerateExpirations(uint64_t now_ns, uint32_t timers_count) {
+    auto expirations = (uint64_t*)malloc(sizeof(uint64_t) * timers_count);
+
+    srand(timers_count);
+    for(uint32_t index = 0; index < timers_count; index++) {
+        expirations[index] = now_ns + (((uint64_t)rand() << 16) ^ rand()) % BENCH_TIMER_RANGE_NS;
+    }
+
+    return expirations;
+}
+
+static void ArmAll(
+        fiber_timer_wheel_t* wheel,
+        fiber_timer_t* timers,
+        uint64_t now_ns,
+        uint64_t* expirations,
+        uint32_t timers_count) {
+    for(uint32_t index = 0; index < timers_count; index++) {
+        fiber_timer_arm(wheel, &timers[index], now_ns, expirations[index], fiber_timer_bench_callback, nullptr);
+    }
+}
+
+static void SetTimerCounters(benchmark::State& state, uint32_t timers_count) {
+    uint64_t timers = state.iterations() * timers_count;
+    state.SetItemsProcessed((int64_t)timers);
+    state.counters["timer_ns"] = benchmark::Counter(
+            (double)timers,
+            benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+void BM_FiberTimer_Arm(benchmark::State& state) {
+    uint32_t timers_count = state.range(0);
+    uint64_t now_ns = 0;
+    auto timers = (fiber_timer_t*)calloc(timers_count, sizeof(fiber_timer_t));
+    uint64_t* expirations = GenerateExpirations(now_ns, timers_count);
+
+    BenchPerfCounters perf_counters(state);
+    for (auto _ : state) {
+        state.PauseTiming();
+        fiber_timer_wheel_t* wheel = fiber_timer_wheel_new(BENCH_TIMER_TICK_NS, now_ns);
+        state.ResumeTiming();
+
+        ArmAll(wheel, timers, now_ns, expirations, timers_count);
+
+        state.PauseTiming();
+        for(uint32_t index = 0; index < timers_count; index++) {
+            fiber_timer_cancel(wheel, &timers[index]);
+        }
+        fiber_timer_wheel_free(wheel);
+        state.ResumeTiming();
+    }
+    perf_counters.Stop();
+
+    SetTimerCounters(state, timers_count);
+
+    free(expirations);
+    free(timers);
+}
+
+void BM_FiberTimer_Cancel(benchmark::State& state) {
+    uint32_t timers_count = state.range(0);
+    uint64_t now_ns = 0;
+    auto timers = (fiber_timer_t*)calloc(timers_count, sizeof(fiber_timer_t));
+    uint64_t* expirations = GenerateExpirations(now_ns, timers_count);
+
+    BenchPerfCounters perf_counters(state);
+    for (auto _ : state) {
+        state.PauseTiming();
+        fiber_timer_wheel_t* wheel = fiber_timer_wheel_new(BENCH_TIMER_TICK_NS, now_ns);
+        ArmAll(wheel, timers, now_ns, expirations, timers_count);
+        state.ResumeTiming();
+
+        // Cancelled in the same order they have been armed, the slots are hit in random order
+        for(uint32_t index = 0; index < timers_count; index++) {
+            fiber_timer_cancel(wheel, &timers[index]);
+        }
+
+        state.PauseTiming();
+        fiber_timer_wheel_free(wheel);
+        state.ResumeTiming();
+    }
+    perf_counters.Stop();
+
+    SetTimerCounters(state, timers_count);
+
+    free(expirations);
+    free(timers);
+}
+
+void BM_FiberTimer_Expire(benchmark::State& state) {
+    uint32_t timers_count = state.range(0);
+    uint64_t now_ns = 0;
+    auto timers = (fiber_timer_t*)calloc(timers_count, sizeof(fiber_timer_t));
+    uint64_t* expirations = GenerateExpirations(now_ns, timers_count);
+
+    BenchPerfCounters perf_counters(state);
+    for (auto _ : state) {
+        state.PauseTiming();
+        fiber_timer_wheel_t* wheel = fiber_timer_wheel_new(BENCH_TIMER_TICK_NS, now_ns);
+        ArmAll(wheel, timers, now_ns, expirations, timers_count);
+        state.ResumeTiming();
+
+        // Advances one millisecond at a time, as a busy worker would, including the cascades of the upper levels
+        for(uint64_t advance_ns = 1000000; advance_ns <= BENCH_TIMER_RANGE_NS; advance_ns += 1000000) {
+            fiber_timer_wheel_advance(wheel, now_ns + advance_ns);
+        }
+
+        state.PauseTiming();
+        if (wheel->timers_count != 0) {
+            state.SkipWithError("Not all the timers have expired");
+        }
+        fiber_timer_wheel_free(wheel);
+        state.ResumeTiming();
+    }
+    perf_counters.Stop();
+
+    SetTimerCounters(state, timers_count);
+
+    free(expirations);
+    free(timers);
+}
+
+// A timer armed, and expired, after a period without timers, during which the workers don't advance their wheel. The
+// clock is simulated, every iteration moves it forward of the idle period.
+void BM_FiberTimer_ArmAfterIdle(benchmark::State& state) {
+    uint64_t idle_ns = (uint64_t)state.range(0) * 1000000000ull;
+    uint64_t now_ns = 0;
+    fiber_timer_t timer = { 0 };
+    fiber_timer_wheel_t* wheel = fiber_timer_wheel_new(BENCH_TIMER_TICK_NS, now_ns);
+
+    BenchPerfCounters perf_counters(state);
+    for (auto _ : state) {
+        now_ns += idle_ns;
+
+        fiber_timer_arm(wheel, &timer, now_ns, now_ns + 1000000, fiber_timer_bench_callback, nullptr);
+        now_ns += 1000000;
+        if (fiber_timer_wheel_advance(wheel, now_ns) != 1) {
+            state.SkipWithError("The timer hasn't expired");
+            break;
+        }
+    }
+    perf_counters.Stop();
+
+    fiber_timer_wheel_free(wheel);
+}
+
+typedef struct fiber_timer_wake_latency_info fiber_timer_wake_latency_info_t;
+struct fiber_timer_wake_latency_info {
+    benchmark::State* state;
+    uint64_t sleep_us;
+    uint64_t latency_ns_total;
+    uint64_t latency_ns_max;
+};
+
+void fiber_timer_wake_latency_func(void* user_data) {
+    auto info = (fiber_timer_wake_latency_info_t*)user_data;
+    benchmark::State& state = *info->state;
+
+    BenchPerfCounters perf_counters(state);
+    for (auto _ : state) {
+        uint64_t expected_ns = fiber_timer_wheel_now_ns() + info->sleep_us * 1000;
+        fiber_sleep(info->sleep_us);
+        uint64_t woken_ns = fiber_timer_wheel_now_ns();
+
+        uint64_t latency_ns = woken_ns > expected_ns ? woken_ns - expected_ns : 0;
+        info->latency_ns_total += latency_ns;
+        if (latency_ns > info->latency_ns_max) {
+            info->latency_ns_max = latency_ns;
+        }
+    }
+    perf_counters.Stop();
+}
+
+// The latency is the delay between the requested wake up time and the moment the fiber runs again, it includes the
+// rounding to the tick of the wheel and the wake up of the idle worker
+void BM_FiberTimer_WakeLatency(benchmark::State& state) {
+    fiber_timer_wake_latency_info_t info = {
+            .state = &state,
+            .sleep_us = (uint64_t)state.range(0),
+    };
+
+    fiber_scheduler_t* scheduler = fiber_scheduler_new(1, getpagesize() * 8);
+    fiber_spawn(scheduler, fiber_timer_wake_latency_func, &info);
+    fiber_scheduler_run(scheduler);
+    fiber_scheduler_free(scheduler);
+
+    state.counters["latency_avg_us"] = (double)info.latency_ns_total / (double)state.iterations() / 1000.0;
+    state.counters["latency_max_us"] = (double)info.latency_ns_max / 1000.0;
+}
+
+static void BenchArgumentsTimers(benchmark::internal::Benchmark* b) {
+    b->Arg(1000000);
+    b->Iterations(10);
+    b->Unit(benchmark::kMillisecond);
+}
+
+static void BenchArgumentsArmAfterIdle(benchmark::internal::Benchmark* b) {
+    // Seconds without timers, a minute, ten minutes and an hour
+    b->Arg(60)->Arg(600)->Arg(3600);
+    b->Iterations(100);
+    b->Unit(benchmark::kMicrosecond);
+}
+
+static void BenchArgumentsWakeLatency(benchmark::internal::Benchmark* b) {
+    b->Arg(100)->Arg(1000)->Arg(10000);
+    b->Iterations(200);
+    b->Unit(benchmark::kMicrosecond);
+    b->UseRealTime();
+}
+
+BENCHMARK(BM_FiberTimer_Arm)
+        ->Apply(BenchArgumentsTimers);
+BENCHMARK(BM_FiberTimer_Cancel)
+        ->Apply(BenchArgumentsTimers);
+BENCHMARK(BM_FiberTimer_Expire)
+        ->Apply(BenchArgumentsTimers);
+BENCHMARK(BM_FiberTimer_ArmAfterIdle)
+        ->Apply(BenchArgumentsArmAfterIdle);
+BENCHMARK(BM_FiberTimer_WakeLatency)
+        ->Apply(BenchArgumentsWakeLatency);
@@ -1,8 +1,15 @@
 #include <stdint.h>
 #include <string.h>
 #include <string>
+#include <unistd.h>
 #include <benchmark/benchmark.h>
 
+#include "libhashtable/hashtable_support_alloc.h"
+
+#include "bench-support-cache.h"
+#include "bench-support-perf.h"
+#include "bench-support-histogram.h"
+
 #define HASHTABLE_SEARCH_MAX (16*32)
 #define HASHTABLE_BUCKET_FLAGS_FILLED 0x01
 
@@ -35,48 +42,68 @@ static benchmark_params_t benchmark_params = {
     .iterations = 1000000
 };
 
+typedef struct bench_alloc_policy bench_alloc_policy_t;
+struct bench_alloc_policy {
+    const char* name;
+    hashtable_support_alloc_policy_t policy;
+    bool first_touch_parallel;
+};
+static bench_alloc_policy_t bench_alloc_policies[] = {
+        { "4kb", { HASHTABLE_SUPPORT_ALLOC_PAGES_4KB, HASHTABLE_SUPPORT_ALLOC_NUMA_DEFAULT, 0 }, false },
+        { "thp", { HASHTABLE_SUPPORT_ALLOC_PAGES_THP, HASHTABLE_SUPPORT_ALLOC_NUMA_DEFAULT, 0 }, false },
+        { "hugetlb_2mb", { HASHTABLE_SUPPORT_ALLOC_PAGES_HUGETLB_2MB, HASHTABLE_SUPPORT_ALLOC_NUMA_DEFAULT, 0 }, false },
+        { "hugetlb_1gb", { HASHTABLE_SUPPORT_ALLOC_PAGES_HUGETLB_1GB, HASHTABLE_SUPPORT_ALLOC_NUMA_DEFAULT, 0 }, false },
+        { "4kb_local_parallel", { HASHTABLE_SUPPORT_ALLOC_PAGES_4KB, HASHTABLE_SUPPORT_ALLOC_NUMA_LOCAL, 0 }, true },
+        { "4kb_interleave", { HASHTABLE_SUPPORT_ALLOC_PAGES_4KB, HASHTABLE_SUPPORT_ALLOC_NUMA_INTERLEAVE, 0 }, false },
+        { "thp_interleave_parallel", { HASHTABLE_SUPPORT_ALLOC_PAGES_THP, HASHTABLE_SUPPORT_ALLOC_NUMA_INTERLEAVE, 0 }, true },
+};
+
 template <typename T>
-void BM_Hashtable_DodVsOop(benchmark::State& state) {
+static void BenchHashtableDodVsOopFill(T* ht_buckets, uint32_t buckets_count) {
+    for(uint32_t index = 0; index < buckets_count; index++) {
+        ht_buckets[index].filled = true;
+        ht_buckets[index].hash_quarter = (uint16_t)(index & 0xFFFFu);
+    }
+}
+
+template <typename T>
+static inline bool BenchHashtableDodVsOopSearch(T* ht_buckets, uint16_t hash_quarter) {
+    bool found = false;
+
+    for(uint32_t index = 0; index < HASHTABLE_SEARCH_MAX; index++) {
+        if (!ht_buckets[index].filled) {
+            continue;
+        }
+
+        benchmark::DoNotOptimize((found = ht_buckets[index].hash_quarter == hash_quarter));
+        if (found) {
+            break;
+        }
+    }
+
+    return found;
+}
+
+template <typename T>
+static void BenchHashtableDodVsOop(benchmark::State& state, T* ht_buckets, BenchHistogram& histogram) {
     uint32_t distance = state.range(0);
     uint64_t hash = distance;
     uint32_t buckets_count = benchmark_params.buckets_count;
     uint32_t iterations = benchmark_params.iterations;
 
     uint16_t hash_quarter = hash & 0xFFFFu;
-    size_t ht_buckets_size = buckets_count * sizeof(T);
-
-    auto ht_buckets = (T*)malloc(ht_buckets_size * iterations);
-    memset(ht_buckets, 0, ht_buckets_size * iterations);
 
     for(uint64_t iteration = 0; iteration < iterations; iteration++) {
-        uint64_t iteration_start_index = iteration * buckets_count;
-        for(
-                uint32_t index = iteration_start_index;
-                index < iteration_start_index + buckets_count;
-                index++) {
-            ht_buckets[index].filled = true;
-            ht_buckets[index].hash_quarter = (uint16_t)((index - iteration_start_index) & 0xFFFFu);
-        }
+        BenchHashtableDodVsOopFill<T>(&ht_buckets[iteration * buckets_count], buckets_count);
     }
 
     uint64_t iteration = 0;
+    BenchPerfCounters perf_counters(state);
     for (auto _ : state) {
-        bool found;
-        uint64_t iteration_start_index = iteration * buckets_count;
-
-        for(
-                uint32_t index = iteration_start_index;
-                index < iteration_start_index + HASHTABLE_SEARCH_MAX;
-                index++) {
-            if (!ht_buckets[index].filled) {
-                continue;
-            }
-
-            benchmark::DoNotOptimize((found = ht_buckets[index].hash_quarter == hash_quarter));
-            if (found) {
-                break;
-            }
-        }
+        histogram.Start();
+        bool found = BenchHashtableDodVsOopSearch<T>(&ht_buckets[iteration * buckets_count], hash_quarter);
+        benchmark::DoNotOptimize(found);
+        histogram.Stop();
 
 #ifdef DEBUG
         if (!found) {
@@ -86,6 +113,76 @@ void BM_Hashtable_DodVsOop(benchmark::State& state) {
 
         iteration++;
     }
+    perf_counters.Stop();
+}
+
+template <typename T>
+void BM_Hashtable_DodVsOop(benchmark::State& state) {
+    size_t ht_buckets_size = benchmark_params.buckets_count * sizeof(T);
+    uint32_t iterations = benchmark_params.iterations;
+
+    auto ht_buckets = (T*)malloc(ht_buckets_size * iterations);
+    memset(ht_buckets, 0, ht_buckets_size * iterations);
+
+    BenchHistogram histogram(state, __PRETTY_FUNCTION__, { state.range(0) });
+    BenchHashtableDodVsOop<T>(state, ht_buckets, histogram);
+
+    free(ht_buckets);
+}
+
+// Same as BM_Hashtable_DodVsOop with the buckets allocated with the policy selected by the second argument, the
+// pages are touched by a single thread, as memset does in BM_Hashtable_DodVsOop, unless the policy has the parallel
+// first touch
+template <typename T>
+void BM_Hashtable_DodVsOop_Alloc(benchmark::State& state) {
+    bench_alloc_policy_t* bench_alloc_policy = &bench_alloc_policies[state.range(1)];
+    hashtable_support_alloc_policy_t policy = bench_alloc_policy->policy;
+    size_t ht_buckets_size = benchmark_params.buckets_count * sizeof(T) * benchmark_params.iterations;
+
+    state.SetLabel(bench_alloc_policy->name);
+
+    policy.first_touch_threads = bench_alloc_policy->first_touch_parallel
+            ? sysconf(_SC_NPROCESSORS_ONLN)
+            : 1;
+
+    auto ht_buckets = (T*)hashtable_support_alloc(ht_buckets_size, &policy);
+    if (ht_buckets == NULL) {
+        state.SkipWithError("Unable to allocate the buckets with the requested policy");
+        return;
+    }
+
+    BenchHistogram histogram(state, __PRETTY_FUNCTION__, { state.range(0), state.range(1) });
+    BenchHashtableDodVsOop<T>(state, ht_buckets, histogram);
+
+    hashtable_support_alloc_free(ht_buckets, ht_buckets_size, &policy);
+}
+
+// A single region of buckets is searched at every iteration, evicted from the cache before each iteration in cold mode
+// (the second argument), the memory used doesn't depend on the number of iterations
+template <typename T>
+void BM_Hashtable_DodVsOop_Cache(benchmark::State& state) {
+    uint32_t distance = state.range(0);
+    int64_t cache_mode = state.range(1);
+    uint16_t hash_quarter = distance & 0xFFFFu;
+    uint32_t buckets_count = benchmark_params.buckets_count;
+    size_t ht_buckets_size = buckets_count * sizeof(T);
+
+    state.SetLabel(BenchCacheModeName(cache_mode));
+
+    auto ht_buckets = (T*)aligned_alloc(64, ht_buckets_size);
+    memset(ht_buckets, 0, ht_buckets_size);
+    BenchHashtableDodVsOopFill<T>(ht_buckets, buckets_count);
+
+    BenchHistogram histogram(state, __PRETTY_FUNCTION__, { distance, cache_mode });
+    BenchPerfCounters perf_counters(state);
+    for (auto _ : state) {
+        BenchCacheIteration(state, cache_mode, ht_buckets, ht_buckets_size, [&]() {
+            histogram.Start();
+            benchmark::DoNotOptimize(BenchHashtableDodVsOopSearch<T>(ht_buckets, hash_quarter));
+            histogram.Stop();
+        });
+    }
+    perf_counters.Stop();
 
     free(ht_buckets);
 }
@@ -108,3 +205,34 @@ BENCHMARK_TEMPLATE(BM_Hashtable_DodVsOop, ht_bucket_dod_t)
     ->Apply(BenchArguments);
 BENCHMARK_TEMPLATE(BM_Hashtable_DodVsOop, ht_bucket_oop_t)
     ->Apply(BenchArguments);
+
+static void BenchArgumentsAlloc(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"distance", "policy"});
+    for(int64_t policy = 0; policy < (int64_t)(sizeof(bench_alloc_policies) / sizeof(bench_alloc_policy_t)); policy++) {
+        b->Args({1, policy});
+        b->Args({100, policy});
+        b->Args({500, policy});
+    }
+    b->Iterations(1000000);
+}
+
+BENCHMARK_TEMPLATE(BM_Hashtable_DodVsOop_Alloc, ht_bucket_dod_t)
+    ->Apply(BenchArgumentsAlloc);
+BENCHMARK_TEMPLATE(BM_Hashtable_DodVsOop_Alloc, ht_bucket_oop_t)
+    ->Apply(BenchArgumentsAlloc);
+
+static void BenchArgumentsCache(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"distance", "cache"});
+    for(int64_t cache_mode : { BENCH_CACHE_MODE_COLD, BENCH_CACHE_MODE_WARM }) {
+        for(int64_t distance : { 1, 5, 10, 25, 50, 100, 200, 300, 400, 500 }) {
+            b->Args({distance, cache_mode});
+        }
+    }
+    b->Iterations(1000000);
+    b->UseManualTime();
+}
+
+BENCHMARK_TEMPLATE(BM_Hashtable_DodVsOop_Cache, ht_bucket_dod_t)
+    ->Apply(BenchArgumentsCache);
+BENCHMARK_TEMPLATE(BM_Hashtable_DodVsOop_Cache, ht_bucket_oop_t)
+    ->Apply(BenchArgumentsCache);
@@ -0,0 +1,227 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include <immintrin.h>
+
+#include "libhashtable/hashtable.h"
+#include "libhashtable/hashtable_support_hash.h"
+
+#include "bench-support-perf.h"
+
+#define BENCH_HASH_CASEFOLD_KEY_MAX_LENGTH 64
+#define BENCH_HASH_CASEFOLD_QUALITY_KEYS_COUNT (1u << 20)
+#define BENCH_HASH_CASEFOLD_QUALITY_BUCKETS_COUNT (1u << 16)
+
+static inline char BenchHashCasefoldFold(char c) {
+    return c >= 'A' && c <= 'Z' ? (char)(c | 0x20) : c;
+}
+
+// The key is folded in a separate buffer and then hashed, the way a case insensitive key is hashed without a case
+// folding hash
+static hashtable_hash_t BenchHashCasefoldFoldThenMurmur64A(const char* key, size_t key_length) {
+    char key_folded[BENCH_HASH_CASEFOLD_KEY_MAX_LENGTH];
+
+    for(size_t index = 0; index < key_length; index++) {
+        key_folded[index] = BenchHashCasefoldFold(key[index]);
+    }
+
+    return hashtable_support_hash_calculate(key_folded, key_length);
+}
+
+static hashtable_hash_t BenchHashCasefoldFnv1a(const char* key, size_t key_length) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+
+    for(size_t index = 0; index < key_length; index++) {
+        hash ^= (uint8_t)BenchHashCasefoldFold(key[index]);
+        hash *= 0x100000001B3ull;
+    }
+
+    return hash;
+}
+
+// CRC32C returns only 32 bits, two streams with different seeds are run in parallel to build a 64 bits hash
+__attribute__((__target__("sse4.2")))
+static hashtable_hash_t BenchHashCasefoldCrc32c(const char* key, size_t key_length) {
+    uint64_t crc_low = 0xFFFFFFFFu;
+    uint64_t crc_high = HASHTABLE_SUPPORT_HASH_SEED;
+    size_t index = 0;
+
+    for(; index + 8 <= key_length; index += 8) {
+        char block[8];
+        uint64_t word;
+
+        for(size_t block_index = 0; block_index < 8; block_index++) {
+            block[block_index] = BenchHashCasefoldFold(key[index + block_index]);
+        }
+
+        memcpy(&word, block, sizeof(word));
+        crc_low = _mm_crc32_u64(crc_low, word);
+        crc_high = _mm_crc32_u64(crc_high, word);
+    }
+
+    for(; index < key_length; index++) {
+        uint8_t byte = (uint8_t)BenchHashCasefoldFold(key[index]);
+        crc_low = _mm_crc32_u8((uint32_t)crc_low, byte);
+        crc_high = _mm_crc32_u8((uint32_t)crc_high, byte);
+    }
+
+    return (crc_high << 32) | (uint32_t)crc_low;
+}
+
+static bool BenchHashCasefoldSupported(hashtable_support_hash_casefold_fp_t* hash_fp, benchmark::State& state) {
+    if ((hash_fp == hashtable_support_hash_casefold_sse42 || hash_fp == BenchHashCasefoldCrc32c) &&
+            !__builtin_cpu_supports("sse4.2")) {
+        state.SkipWithError("SSE4.2 not supported");
+        return false;
+    } else if (hash_fp == hashtable_support_hash_casefold_avx2 && !__builtin_cpu_supports("avx2")) {
+        state.SkipWithError("AVX2 not supported");
+        return false;
+    } else if (hash_fp == hashtable_support_hash_casefold_avx512bw && !__builtin_cpu_supports("avx512bw")) {
+        state.SkipWithError("AVX-512BW not supported");
+        return false;
+    }
+
+    return true;
+}
+
+template <hashtable_support_hash_casefold_fp_t* hash_fp>
+void BM_Hashtable_Hash_Casefold_Speed(benchmark::State& state) {
+    size_t key_length = state.range(0);
+    char key[BENCH_HASH_CASEFOLD_KEY_MAX_LENGTH];
+
+    if (!BenchHashCasefoldSupported(hash_fp, state)) {
+        return;
+    }
+
+    for(size_t index = 0; index < key_length; index++) {
+        key[index] = (char)((index & 1 ? 'A' : 'a') + (index % 26));
+    }
+
+    BenchPerfCounters perf_counters(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(key);
+        benchmark::DoNotOptimize(hash_fp(key, key_length));
+    }
+    perf_counters.Stop();
+}
+
+static uint64_t BenchHashCasefoldDuplicates(std::vector<uint64_t>& values) {
+    std::sort(values.begin(), values.end());
+
+    return values.size() - (std::unique(values.begin(), values.end()) - values.begin());
+}
+
+// Chi-squared of the distribution of the values over buckets_count buckets, divided by the degrees of freedom, 1.0 is
+// what a random function would get
+static double BenchHashCasefoldChi2(const std::vector<uint32_t>& buckets, uint64_t values_count) {
+    double expected = (double)values_count / (double)buckets.size();
+    double chi2 = 0;
+
+    for(uint32_t bucket_count : buckets) {
+        chi2 += ((double)bucket_count - expected) * ((double)bucket_count - expected) / expected;
+    }
+
+    return chi2 / (double)(buckets.size() - 1);
+}
+
+// The keys are built from a few templates with a sequential number, the worst case for weak hashes, in random case.
+// Checks the collisions of the half hashes (the upper 32 bits, HASHTABLE_HALF_HASH_FILLED excluded), how evenly the
+// lower bits used to pick the chunk and the upper 16 bits (hash_quarter in ht_bucket_t) are distributed and if the
+// upper case version of the keys hashes to the same value.
+template <hashtable_support_hash_casefold_fp_t* hash_fp>
+void BM_Hashtable_Hash_Casefold_Quality(benchmark::State& state) {
+    static const char* key_formats[] = { "key:%u", "user:%08u:session", "SET_COUNTER_%u_VALUE", "%u" };
+    uint64_t keys_count = BENCH_HASH_CASEFOLD_QUALITY_KEYS_COUNT;
+    char key[BENCH_HASH_CASEFOLD_KEY_MAX_LENGTH];
+    char key_uppercase[BENCH_HASH_CASEFOLD_KEY_MAX_LENGTH];
+
+    if (!BenchHashCasefoldSupported(hash_fp, state)) {
+        return;
+    }
+
+    BenchPerfCounters perf_counters(state);
+    for (auto _ : state) {
+        std::vector<uint64_t> half_hashes(keys_count);
+        std::vector<uint32_t> chunk_buckets(BENCH_HASH_CASEFOLD_QUALITY_BUCKETS_COUNT, 0);
+        std::vector<uint32_t> hash_quarter_buckets(BENCH_HASH_CASEFOLD_QUALITY_BUCKETS_COUNT, 0);
+        uint64_t case_mismatches = 0;
+        uint64_t random_state = 0x9E3779B97F4A7C15ull;
+
+        for(uint64_t key_index = 0; key_index < keys_count; key_index++) {
+            size_t key_length = snprintf(
+                    key,
+                    sizeof(key),
+                    key_formats[key_index % 4],
+                    (uint32_t)(key_index / 4));
+
+            for(size_t index = 0; index < key_length; index++) {
+                random_state = random_state * 6364136223846793005ull + 1442695040888963407ull;
+                if ((random_state >> 63) && key[index] >= 'a' && key[index] <= 'z') {
+                    key[index] = (char)(key[index] - 'a' + 'A');
+                }
+                key_uppercase[index] = key[index] >= 'a' && key[index] <= 'z'
+                        ? (char)(key[index] - 'a' + 'A')
+                        : key[index];
+            }
+
+            hashtable_hash_t hash = hash_fp(key, key_length);
+
+            half_hashes[key_index] = hashtable_half_hash_from_hash(hash);
+            chunk_buckets[hash & (BENCH_HASH_CASEFOLD_QUALITY_BUCKETS_COUNT - 1)]++;
+            hash_quarter_buckets[hash >> 48]++;
+
+            if (hash_fp(key_uppercase, key_length) != hash) {
+                case_mismatches++;
+            }
+        }
+
+        state.counters["half_hash_collisions"] = (double)BenchHashCasefoldDuplicates(half_hashes);
+        state.counters["half_hash_collisions_expected"] =
+                (double)keys_count * (double)(keys_count - 1) / 2.0 / (double)(1ull << 31);
+        state.counters["chunk_index_chi2"] = BenchHashCasefoldChi2(chunk_buckets, keys_count);
+        state.counters["hash_quarter_chi2"] = BenchHashCasefoldChi2(hash_quarter_buckets, keys_count);
+        state.counters["case_mismatches"] = (double)case_mismatches;
+    }
+    perf_counters.Stop();
+}
+
+static void BenchArgumentsSpeed(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"key_length"});
+    b->DenseRange(1, BENCH_HASH_CASEFOLD_KEY_MAX_LENGTH);
+    b->Iterations(1000000);
+}
+
+static void BenchArgumentsQuality(benchmark::internal::Benchmark* b) {
+    b->Iterations(1);
+    b->Unit(benchmark::kMillisecond);
+}
+
+BENCHMARK_TEMPLATE(BM_Hashtable_Hash_Casefold_Speed, hashtable_support_hash_casefold_scalar)
+    ->Apply(BenchArgumentsSpeed);
+BENCHMARK_TEMPLATE(BM_Hashtable_Hash_Casefold_Speed, hashtable_support_hash_casefold_sse42)
+    ->Apply(BenchArgumentsSpeed);
+BENCHMARK_TEMPLATE(BM_Hashtable_Hash_Casefold_Speed, hashtable_support_hash_casefold_avx2)
+    ->Apply(BenchArgumentsSpeed);
+BENCHMARK_TEMPLATE(BM_Hashtable_Hash_Casefold_Speed, hashtable_support_hash_casefold_avx512bw)
+    ->Apply(BenchArgumentsSpeed);
+BENCHMARK_TEMPLATE(BM_Hashtable_Hash_Casefold_Speed, hashtable_support_hash_casefold_calculate)
+    ->Apply(BenchArgumentsSpeed);
+BENCHMARK_TEMPLATE(BM_Hashtable_Hash_Casefold_Speed, BenchHashCasefoldFoldThenMurmur64A)
+    ->Apply(BenchArgumentsSpeed);
+BENCHMARK_TEMPLATE(BM_Hashtable_Hash_Casefold_Speed, BenchHashCasefoldFnv1a)
+    ->Apply(BenchArgumentsSpeed);
+BENCHMARK_TEMPLATE(BM_Hashtable_Hash_Casefold_Speed, BenchHashCasefoldCrc32c)
+    ->Apply(BenchArgumentsSpeed);
+
+BENCHMARK_TEMPLATE(BM_Hashtable_Hash_Casefold_Quality, hashtable_support_hash_casefold_calculate)
+    ->Apply(BenchArgumentsQuality);
+BENCHMARK_TEMPLATE(BM_Hashtable_Hash_Casefold_Quality, BenchHashCasefoldFoldThenMurmur64A)
+    ->Apply(BenchArgumentsQuality);
+BENCHMARK_TEMPLATE(BM_Hashtable_Hash_Casefold_Quality, BenchHashCasefoldFnv1a)
+    ->Apply(BenchArgumentsQuality);
+BENCHMARK_TEMPLATE(BM_Hashtable_Hash_Casefold_Quality, BenchHashCasefoldCrc32c)
+    ->Apply(BenchArgumentsQuality);
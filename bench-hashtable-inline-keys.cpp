@@ -0,0 +1,426 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <benchmark/benchmark.h>
+#include <immintrin.h>
+
+#include "libhashtable/hashtable.h"
+#include "libhashtable/hashtable_support_hash_search.h"
+#include "libhashtable/hashtable_support_string_cmp.h"
+
+#include "bench-support-cache.h"
+#include "bench-support-perf.h"
+#include "bench-support-histogram.h"
+
+#define BENCH_INLINE_KEYS_INLINE_MAX_LENGTH 32
+#define BENCH_INLINE_KEYS_CHUNKS_COUNT 1024
+#define BENCH_INLINE_KEYS_LOOKUP_KEY_STRIDE 128
+#define BENCH_INLINE_KEYS_COLLISIONS_KEY_LENGTH 24
+
+// The keys up to 32 bytes are stored in the slot itself, one cache line next to the chunk of half hashes, and compared
+// with hashtable_casecmp_eq_str_32 without dereferencing any pointer; the longer keys are stored out of line and
+// compared with hashtable_casecmp_eq_str.
+// The slot is padded to 64 bytes so the key, its length and the value never span two cache lines.
+typedef struct ht_key_slot_inline ht_key_slot_inline_t;
+struct ht_key_slot_inline {
+    union {
+        char key_inline[BENCH_INLINE_KEYS_INLINE_MAX_LENGTH];
+        char* key;
+    };
+    uint32_t key_length;
+    uintptr_t value;
+} __attribute__((aligned(64)));
+
+typedef struct ht_chunk_inline ht_chunk_inline_t;
+struct ht_chunk_inline {
+    hashtable_half_hashes_chunk_t half_hashes_chunk;
+    ht_key_slot_inline_t slots[HASHTABLE_HALF_HASHES_CHUNK_SLOTS];
+};
+
+// Same layout of hashtable_key_value_t, the key is always stored out of line and has to be fetched to be compared
+typedef struct ht_key_slot_pointer ht_key_slot_pointer_t;
+struct ht_key_slot_pointer {
+    char* key;
+    uint32_t key_length;
+    uintptr_t value;
+};
+
+typedef struct ht_chunk_pointer ht_chunk_pointer_t;
+struct ht_chunk_pointer {
+    hashtable_half_hashes_chunk_t half_hashes_chunk;
+    ht_key_slot_pointer_t slots[HASHTABLE_HALF_HASHES_CHUNK_SLOTS];
+};
+
+// The keys and their lengths are stored in arrays next to the chunk of half hashes, so all the slots matching the half
+// hash can be compared at once with hashtable_casecmp_eq_str_32_many
+typedef struct ht_chunk_inline_keys ht_chunk_inline_keys_t;
+struct ht_chunk_inline_keys {
+    hashtable_half_hashes_chunk_t half_hashes_chunk;
+    uint8_t keys_length[HASHTABLE_HALF_HASHES_CHUNK_SLOTS] __attribute__((aligned(64)));
+    char keys[HASHTABLE_HALF_HASHES_CHUNK_SLOTS][BENCH_INLINE_KEYS_INLINE_MAX_LENGTH] __attribute__((aligned(64)));
+};
+
+// The out of line keys are padded because the SIMD compare always reads 32 bytes
+static char* BenchInlineKeysKeyDup(const char* key, size_t key_length) {
+    char* key_copy = (char*)calloc(1, key_length + BENCH_INLINE_KEYS_INLINE_MAX_LENGTH);
+    memcpy(key_copy, key, key_length);
+
+    return key_copy;
+}
+
+static inline const char* BenchInlineKeysSlotKey(ht_key_slot_inline_t* slot) {
+    return slot->key_length <= BENCH_INLINE_KEYS_INLINE_MAX_LENGTH
+        ? slot->key_inline
+        : slot->key;
+}
+
+static inline const char* BenchInlineKeysSlotKey(ht_key_slot_pointer_t* slot) {
+    return slot->key;
+}
+
+static void BenchInlineKeysSlotStore(ht_key_slot_inline_t* slot, const char* key, size_t key_length) {
+    if (key_length <= BENCH_INLINE_KEYS_INLINE_MAX_LENGTH) {
+        memset(slot->key_inline, 0, sizeof(slot->key_inline));
+        memcpy(slot->key_inline, key, key_length);
+    } else {
+        slot->key = BenchInlineKeysKeyDup(key, key_length);
+    }
+
+    slot->key_length = key_length;
+}
+
+static void BenchInlineKeysSlotStore(ht_key_slot_pointer_t* slot, const char* key, size_t key_length) {
+    slot->key = BenchInlineKeysKeyDup(key, key_length);
+    slot->key_length = key_length;
+}
+
+static void BenchInlineKeysSlotFree(ht_key_slot_inline_t* slot) {
+    if (slot->key_length > BENCH_INLINE_KEYS_INLINE_MAX_LENGTH) {
+        free(slot->key);
+    }
+}
+
+static void BenchInlineKeysSlotFree(ht_key_slot_pointer_t* slot) {
+    free(slot->key);
+}
+
+static inline bool BenchInlineKeysCompare(
+        const char* slot_key,
+        size_t slot_key_length,
+        const char* key,
+        size_t key_length) {
+    if (slot_key_length != key_length) {
+        return false;
+    }
+
+    if (key_length <= BENCH_INLINE_KEYS_INLINE_MAX_LENGTH) {
+        return hashtable_casecmp_eq_str_32(slot_key, slot_key_length, key, key_length);
+    }
+
+    return hashtable_casecmp_eq_str(slot_key, slot_key_length, key, key_length);
+}
+
+template <typename T>
+static inline bool BenchInlineKeysSearch(
+        T* chunk,
+        hashtable_half_hash_t half_hash,
+        const char* key,
+        size_t key_length,
+        uintptr_t* value) {
+    uint32_t chunk_slot_index;
+    uint32_t skip_indexes_mask = 0;
+
+    while ((chunk_slot_index = hashtable_linear_search_16(
+            half_hash,
+            chunk->half_hashes_chunk.half_hashes,
+            skip_indexes_mask)) != HASHTABLE_MCMP_SUPPORT_HASH_SEARCH_NOT_FOUND) {
+        auto slot = &chunk->slots[chunk_slot_index];
+
+        if (BenchInlineKeysCompare(BenchInlineKeysSlotKey(slot), slot->key_length, key, key_length)) {
+            *value = slot->value;
+            return true;
+        }
+
+        skip_indexes_mask |= 1u << chunk_slot_index;
+    }
+
+    return false;
+}
+
+static inline hashtable_half_hash_t BenchInlineKeysHalfHash(uint32_t chunk_index, uint32_t chunk_slot_index) {
+    return (chunk_index * HASHTABLE_HALF_HASHES_CHUNK_SLOTS + chunk_slot_index) | HASHTABLE_HALF_HASH_FILLED;
+}
+
+// Every chunk holds a key in the slot chunk_index % 16, the lookup key is the lowercase version of the stored one. On
+// the false positive path the half hash matches but the last character of the stored key is different, the compare
+// fails and the rest of the chunk is searched. In cold mode the chunk and the stored key are evicted before each
+// search, the lookup key is left in the cache as it would have just been read by the caller.
+template <typename T>
+static void BenchInlineKeys(benchmark::State& state, bool false_positive, BenchHistogram& histogram) {
+    size_t key_length = state.range(0);
+    int64_t cache_mode = state.range(1);
+    uint32_t chunks_count = BENCH_INLINE_KEYS_CHUNKS_COUNT;
+    uint32_t chunks_mask = chunks_count - 1;
+    char key_stored[BENCH_INLINE_KEYS_LOOKUP_KEY_STRIDE];
+
+    auto chunks = (T*)aligned_alloc(64, sizeof(T) * chunks_count);
+    auto lookup_keys = (char*)calloc(chunks_count, BENCH_INLINE_KEYS_LOOKUP_KEY_STRIDE);
+    memset(chunks, 0, sizeof(T) * chunks_count);
+
+    state.SetLabel(BenchCacheModeName(cache_mode));
+
+    for(uint32_t chunk_index = 0; chunk_index < chunks_count; chunk_index++) {
+        T* chunk = &chunks[chunk_index];
+        uint32_t chunk_slot_index_key = chunk_index % HASHTABLE_HALF_HASHES_CHUNK_SLOTS;
+        char* lookup_key = &lookup_keys[chunk_index * BENCH_INLINE_KEYS_LOOKUP_KEY_STRIDE];
+
+        for(uint32_t chunk_slot_index = 0; chunk_slot_index < HASHTABLE_HALF_HASHES_CHUNK_SLOTS; chunk_slot_index++) {
+            chunk->half_hashes_chunk.half_hashes[chunk_slot_index] =
+                    BenchInlineKeysHalfHash(chunk_index, chunk_slot_index);
+        }
+
+        for(size_t index = 0; index < key_length; index++) {
+            lookup_key[index] = (char)('a' + ((chunk_index + index) % 26));
+            key_stored[index] = (char)(lookup_key[index] - 'a' + 'A');
+        }
+
+        if (false_positive && key_length > 0) {
+            key_stored[key_length - 1] = key_stored[key_length - 1] == 'Z' ? 'A' : key_stored[key_length - 1] + 1;
+        }
+
+        BenchInlineKeysSlotStore(&chunk->slots[chunk_slot_index_key], key_stored, key_length);
+        chunk->slots[chunk_slot_index_key].value = chunk_index;
+    }
+
+    uint64_t iteration = 0;
+    BenchPerfCounters perf_counters(state);
+    for (auto _ : state) {
+        uintptr_t value;
+        bool found;
+        uint32_t chunk_index = (iteration * 7919) & chunks_mask;
+        T* chunk = &chunks[chunk_index];
+
+        if (cache_mode == BENCH_CACHE_MODE_COLD) {
+            BenchCacheFlush(
+                    BenchInlineKeysSlotKey(&chunk->slots[chunk_index % HASHTABLE_HALF_HASHES_CHUNK_SLOTS]),
+                    key_length);
+        }
+
+        BenchCacheIteration(state, cache_mode, chunk, sizeof(T), [&]() {
+            histogram.Start();
+            found = BenchInlineKeysSearch<T>(
+                    chunk,
+                    BenchInlineKeysHalfHash(chunk_index, chunk_index % HASHTABLE_HALF_HASHES_CHUNK_SLOTS),
+                    &lookup_keys[chunk_index * BENCH_INLINE_KEYS_LOOKUP_KEY_STRIDE],
+                    key_length,
+                    &value);
+            benchmark::DoNotOptimize(found);
+            histogram.Stop();
+        });
+
+#ifdef DEBUG
+        if (found == false_positive) {
+            throw std::runtime_error("Unexpected search result, iteration " + std::to_string(iteration));
+        }
+#endif
+
+        iteration++;
+    }
+    perf_counters.Stop();
+
+    for(uint32_t chunk_index = 0; chunk_index < chunks_count; chunk_index++) {
+        BenchInlineKeysSlotFree(&chunks[chunk_index].slots[chunk_index % HASHTABLE_HALF_HASHES_CHUNK_SLOTS]);
+    }
+
+    free(lookup_keys);
+    free(chunks);
+}
+
+// Bitmask of the slots of the chunk matching the half hash
+__attribute__((__target__("avx2")))
+static inline uint32_t BenchInlineKeysHalfHashesMatchMask(
+        hashtable_half_hashes_chunk_t* chunk,
+        hashtable_half_hash_t half_hash) {
+    __m256i half_hash_block = _mm256_set1_epi32((int)half_hash);
+    __m256i eq_low = _mm256_cmpeq_epi32(_mm256_load_si256((__m256i*)&chunk->half_hashes[0]), half_hash_block);
+    __m256i eq_high = _mm256_cmpeq_epi32(_mm256_load_si256((__m256i*)&chunk->half_hashes[8]), half_hash_block);
+
+    return (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(eq_low)) |
+           ((uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(eq_high)) << 8);
+}
+
+static inline bool BenchInlineKeysCollisionsSearchSequential(
+        ht_chunk_inline_keys_t* chunk,
+        hashtable_half_hash_t half_hash,
+        const char* key,
+        size_t key_length) {
+    uint32_t chunk_slot_index;
+    uint32_t skip_indexes_mask = 0;
+
+    while ((chunk_slot_index = hashtable_linear_search_16(
+            half_hash,
+            chunk->half_hashes_chunk.half_hashes,
+            skip_indexes_mask)) != HASHTABLE_MCMP_SUPPORT_HASH_SEARCH_NOT_FOUND) {
+        if (hashtable_casecmp_eq_str_32(
+                chunk->keys[chunk_slot_index],
+                chunk->keys_length[chunk_slot_index],
+                key,
+                key_length)) {
+            return true;
+        }
+
+        skip_indexes_mask |= 1u << chunk_slot_index;
+    }
+
+    return false;
+}
+
+static inline bool BenchInlineKeysCollisionsSearchMany(
+        ht_chunk_inline_keys_t* chunk,
+        hashtable_half_hash_t half_hash,
+        const char* key,
+        size_t key_length) {
+    uint32_t candidates_mask = BenchInlineKeysHalfHashesMatchMask(&chunk->half_hashes_chunk, half_hash);
+
+    return hashtable_casecmp_eq_str_32_many(
+            key,
+            key_length,
+            chunk->keys,
+            chunk->keys_length,
+            candidates_mask) != 0;
+}
+
+// The first slots of every chunk hold the keys colliding with the one searched, same half hash but the last character
+// is different, the key searched is stored right after them. The collision rate is the percentage of the slots of the
+// chunk holding a colliding key.
+static void BenchInlineKeysCollisions(benchmark::State& state, bool many) {
+    int64_t collision_rate = state.range(0);
+    uint32_t colliding_count = (HASHTABLE_HALF_HASHES_CHUNK_SLOTS * collision_rate + 50) / 100;
+    size_t key_length = BENCH_INLINE_KEYS_COLLISIONS_KEY_LENGTH;
+    uint32_t chunks_count = BENCH_INLINE_KEYS_CHUNKS_COUNT;
+    uint32_t chunks_mask = chunks_count - 1;
+
+    if (!__builtin_cpu_supports("avx2")) {
+        state.SkipWithError("AVX2 not supported");
+        return;
+    }
+
+    state.SetLabel("colliding:" + std::to_string(colliding_count));
+
+    auto chunks = (ht_chunk_inline_keys_t*)aligned_alloc(64, sizeof(ht_chunk_inline_keys_t) * chunks_count);
+    auto lookup_keys = (char*)calloc(chunks_count, BENCH_INLINE_KEYS_LOOKUP_KEY_STRIDE);
+    memset(chunks, 0, sizeof(ht_chunk_inline_keys_t) * chunks_count);
+
+    for(uint32_t chunk_index = 0; chunk_index < chunks_count; chunk_index++) {
+        ht_chunk_inline_keys_t* chunk = &chunks[chunk_index];
+        char* lookup_key = &lookup_keys[chunk_index * BENCH_INLINE_KEYS_LOOKUP_KEY_STRIDE];
+        hashtable_half_hash_t half_hash = BenchInlineKeysHalfHash(chunk_index, 0);
+
+        for(size_t index = 0; index < key_length; index++) {
+            lookup_key[index] = (char)('a' + ((chunk_index + index) % 26));
+        }
+
+        for(uint32_t chunk_slot_index = 0; chunk_slot_index < HASHTABLE_HALF_HASHES_CHUNK_SLOTS; chunk_slot_index++) {
+            char* key_stored = chunk->keys[chunk_slot_index];
+
+            chunk->half_hashes_chunk.half_hashes[chunk_slot_index] = chunk_slot_index <= colliding_count
+                    ? half_hash
+                    : BenchInlineKeysHalfHash(chunk_index, chunk_slot_index);
+            chunk->keys_length[chunk_slot_index] = key_length;
+
+            for(size_t index = 0; index < key_length; index++) {
+                key_stored[index] = (char)(lookup_key[index] - 'a' + 'A');
+            }
+
+            if (chunk_slot_index != colliding_count) {
+                key_stored[key_length - 1] = key_stored[key_length - 1] == 'Z' ? 'A' : key_stored[key_length - 1] + 1;
+            }
+        }
+    }
+
+    uint64_t iteration = 0;
+    BenchHistogram histogram(
+            state,
+            many ? "BM_Hashtable_InlineKeys_Collisions_Many" : "BM_Hashtable_InlineKeys_Collisions_Sequential",
+            { collision_rate });
+    BenchPerfCounters perf_counters(state);
+    for (auto _ : state) {
+        uint32_t chunk_index = (iteration * 7919) & chunks_mask;
+        ht_chunk_inline_keys_t* chunk = &chunks[chunk_index];
+        hashtable_half_hash_t half_hash = BenchInlineKeysHalfHash(chunk_index, 0);
+        const char* lookup_key = &lookup_keys[chunk_index * BENCH_INLINE_KEYS_LOOKUP_KEY_STRIDE];
+
+        histogram.Start();
+        bool found = many
+                ? BenchInlineKeysCollisionsSearchMany(chunk, half_hash, lookup_key, key_length)
+                : BenchInlineKeysCollisionsSearchSequential(chunk, half_hash, lookup_key, key_length);
+        benchmark::DoNotOptimize(found);
+        histogram.Stop();
+
+#ifdef DEBUG
+        if (!found) {
+            throw std::runtime_error("Unable to find the key, iteration " + std::to_string(iteration));
+        }
+#endif
+
+        iteration++;
+    }
+    perf_counters.Stop();
+
+    free(lookup_keys);
+    free(chunks);
+}
+
+void BM_Hashtable_InlineKeys_Collisions_Sequential(benchmark::State& state) {
+    BenchInlineKeysCollisions(state, false);
+}
+
+void BM_Hashtable_InlineKeys_Collisions_Many(benchmark::State& state) {
+    BenchInlineKeysCollisions(state, true);
+}
+
+template <typename T>
+void BM_Hashtable_InlineKeys_Hit(benchmark::State& state) {
+    BenchHistogram histogram(state, __PRETTY_FUNCTION__, { state.range(0), state.range(1) });
+    BenchInlineKeys<T>(state, false, histogram);
+}
+
+template <typename T>
+void BM_Hashtable_InlineKeys_FalsePositive(benchmark::State& state) {
+    BenchHistogram histogram(state, __PRETTY_FUNCTION__, { state.range(0), state.range(1) });
+    BenchInlineKeys<T>(state, true, histogram);
+}
+
+static void BenchArguments(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"key_length", "cache"});
+    // The lengths around the 16 bytes boundaries of the compares and around BENCH_INLINE_KEYS_INLINE_MAX_LENGTH, every
+    // length up to 64 would register too many arguments
+    for(int64_t cache_mode : { BENCH_CACHE_MODE_COLD, BENCH_CACHE_MODE_WARM }) {
+        for(int64_t key_length : { 1, 2, 4, 8, 15, 16, 17, 23, 24, 31, 32, 33, 48, 63, 64 }) {
+            b->Args({key_length, cache_mode});
+        }
+    }
+    b->Iterations(100000);
+    b->UseManualTime();
+}
+
+BENCHMARK_TEMPLATE(BM_Hashtable_InlineKeys_Hit, ht_chunk_inline_t)
+    ->Apply(BenchArguments);
+BENCHMARK_TEMPLATE(BM_Hashtable_InlineKeys_Hit, ht_chunk_pointer_t)
+    ->Apply(BenchArguments);
+BENCHMARK_TEMPLATE(BM_Hashtable_InlineKeys_FalsePositive, ht_chunk_inline_t)
+    ->Apply(BenchArguments);
+BENCHMARK_TEMPLATE(BM_Hashtable_InlineKeys_FalsePositive, ht_chunk_pointer_t)
+    ->Apply(BenchArguments);
+
+static void BenchArgumentsCollisions(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"collision_rate"});
+    b->DenseRange(0, 50, 10);
+    b->Iterations(1000000);
+}
+
+BENCHMARK(BM_Hashtable_InlineKeys_Collisions_Sequential)
+    ->Apply(BenchArgumentsCollisions);
+BENCHMARK(BM_Hashtable_InlineKeys_Collisions_Many)
+    ->Apply(BenchArgumentsCollisions);
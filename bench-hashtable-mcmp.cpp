@@ -0,0 +1,168 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <benchmark/benchmark.h>
+
+#include "libhashtable/hashtable_epoch.h"
+#include "libhashtable/hashtable_mcmp.h"
+
+#include "bench-support-perf.h"
+
+#define BENCH_HASHTABLE_MCMP_KEY_MAX_LENGTH 24
+
+typedef struct benchmark_params benchmark_params_t;
+struct benchmark_params {
+    uint64_t buckets_count;
+    uint32_t load_factor;
+};
+static benchmark_params_t benchmark_params = {
+        .buckets_count = 1 << 20,
+        .load_factor = 75,
+};
+
+// Shared by the threads of a benchmark run, set up by the first thread before the benchmark loop starts
+static hashtable_mcmp_t* bench_hashtable_mcmp = NULL;
+static char* bench_hashtable_mcmp_keys = NULL;
+static uint32_t* bench_hashtable_mcmp_keys_length = NULL;
+
+static inline const char* BenchHashtableMcmpKey(uint64_t index) {
+    return bench_hashtable_mcmp_keys + index * BENCH_HASHTABLE_MCMP_KEY_MAX_LENGTH;
+}
+
+static inline uint64_t BenchHashtableMcmpRandom(uint64_t* state) {
+    // xorshift64
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+
+    return *state;
+}
+
+static bool BenchHashtableMcmpSetup(uint64_t keys_count) {
+    bench_hashtable_mcmp = hashtable_mcmp_new(benchmark_params.buckets_count);
+    bench_hashtable_mcmp_keys = (char*)malloc(keys_count * BENCH_HASHTABLE_MCMP_KEY_MAX_LENGTH);
+    bench_hashtable_mcmp_keys_length = (uint32_t*)malloc(keys_count * sizeof(uint32_t));
+
+    for(uint64_t index = 0; index < keys_count; index++) {
+        bench_hashtable_mcmp_keys_length[index] = snprintf(
+                bench_hashtable_mcmp_keys + index * BENCH_HASHTABLE_MCMP_KEY_MAX_LENGTH,
+                BENCH_HASHTABLE_MCMP_KEY_MAX_LENGTH,
+                "key:%lu",
+                index);
+
+        if (!hashtable_mcmp_insert(
+                bench_hashtable_mcmp,
+                BenchHashtableMcmpKey(index),
+                bench_hashtable_mcmp_keys_length[index],
+                index)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void BenchHashtableMcmpTeardown() {
+    hashtable_mcmp_free(bench_hashtable_mcmp);
+    free(bench_hashtable_mcmp_keys);
+    free(bench_hashtable_mcmp_keys_length);
+
+    bench_hashtable_mcmp = NULL;
+    bench_hashtable_mcmp_keys = NULL;
+    bench_hashtable_mcmp_keys_length = NULL;
+}
+
+// All the threads share the same hashtable, the operations are lookups of random keys except for the writes, half
+// updates of random keys and half deletes alternated with the insert of the deleted key. A thread deletes only the
+// keys it owns (index % threads == thread index) so the load factor stays stable.
+void BM_Hashtable_Mcmp_Mixed(benchmark::State& state) {
+    uint32_t write_percentage = state.range(0);
+    uint64_t keys_count = (benchmark_params.buckets_count * benchmark_params.load_factor) / 100;
+    uint64_t random_state = 0x9E3779B97F4A7C15ull * (state.thread_index() + 1);
+    uint64_t deleted_index = UINT64_MAX;
+    uint64_t threads = state.threads();
+
+    if (state.thread_index() == 0) {
+        if (!BenchHashtableMcmpSetup(keys_count)) {
+            state.SkipWithError("Unable to insert the key, the hashtable is full");
+        }
+    }
+
+    BenchPerfCounters perf_counters(state);
+    for (auto _ : state) {
+        uintptr_t value;
+        uint64_t random = BenchHashtableMcmpRandom(&random_state);
+        uint32_t operation = random % 100;
+        uint64_t index = (random >> 8) % keys_count;
+
+        if (operation >= write_percentage) {
+            benchmark::DoNotOptimize(hashtable_mcmp_lookup(
+                    bench_hashtable_mcmp,
+                    BenchHashtableMcmpKey(index),
+                    bench_hashtable_mcmp_keys_length[index],
+                    &value));
+        } else if (operation % 2 == 0) {
+            benchmark::DoNotOptimize(hashtable_mcmp_update(
+                    bench_hashtable_mcmp,
+                    BenchHashtableMcmpKey(index),
+                    bench_hashtable_mcmp_keys_length[index],
+                    random));
+        } else if (deleted_index == UINT64_MAX) {
+            index -= index % threads;
+            index += state.thread_index();
+            if (index >= keys_count) {
+                index = state.thread_index();
+            }
+
+            benchmark::DoNotOptimize(hashtable_mcmp_delete(
+                    bench_hashtable_mcmp,
+                    BenchHashtableMcmpKey(index),
+                    bench_hashtable_mcmp_keys_length[index]));
+            deleted_index = index;
+        } else {
+            benchmark::DoNotOptimize(hashtable_mcmp_insert(
+                    bench_hashtable_mcmp,
+                    BenchHashtableMcmpKey(deleted_index),
+                    bench_hashtable_mcmp_keys_length[deleted_index],
+                    deleted_index));
+            deleted_index = UINT64_MAX;
+        }
+    }
+    perf_counters.Stop();
+
+    state.SetItemsProcessed((int64_t)state.iterations());
+
+    if (state.thread_index() == 0) {
+        // The counters of the threads are summed up, only the first thread reports the hashtable ones
+        state.counters["locks_contended"] = (double)bench_hashtable_mcmp->chunks_locks_contended;
+        state.counters["claims_failed"] = (double)bench_hashtable_mcmp->slots_claims_failed;
+    }
+
+    // Frees the key values retired by this thread, the threads are terminated at the end of the benchmark run
+    hashtable_epoch_thread_free();
+
+    if (state.thread_index() == 0) {
+        BenchHashtableMcmpTeardown();
+    }
+}
+
+static void BenchArguments(benchmark::internal::Benchmark* b) {
+    long cores_count = sysconf(_SC_NPROCESSORS_ONLN);
+
+    b->ArgNames({"write_percentage"});
+    b->Arg(0);
+    b->Arg(5);
+    b->Arg(20);
+    b->Arg(50);
+    for(long threads_count = 1; threads_count < cores_count; threads_count *= 2) {
+        b->Threads(threads_count);
+    }
+    b->Threads(cores_count);
+    b->Iterations(1000000);
+    b->UseRealTime();
+}
+
+BENCHMARK(BM_Hashtable_Mcmp_Mixed)
+    ->Apply(BenchArguments);
@@ -0,0 +1,338 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <benchmark/benchmark.h>
+
+#include "libhashtable/hashtable.h"
+
+#include "bench-support-perf.h"
+#include "bench-support-histogram.h"
+
+#define BENCH_HASHTABLE_KEY_MAX_LENGTH 24
+
+typedef struct benchmark_params benchmark_params_t;
+struct benchmark_params {
+    uint64_t buckets_count;
+    uint64_t buckets_count_batch;
+    uint32_t load_factor_batch;
+};
+static benchmark_params_t benchmark_params = {
+        .buckets_count = 1 << 20,
+        // Large enough to not fit in the LLC, each lookup is a dependent chain of cache misses
+        .buckets_count_batch = 1 << 23,
+        .load_factor_batch = 75,
+};
+
+typedef struct bench_hashtable_keys bench_hashtable_keys_t;
+struct bench_hashtable_keys {
+    uint64_t count;
+    char* keys;
+    uint32_t* keys_length;
+};
+
+static inline const char* BenchHashtableKey(bench_hashtable_keys_t* keys, uint64_t index) {
+    return keys->keys + index * BENCH_HASHTABLE_KEY_MAX_LENGTH;
+}
+
+static inline uint64_t BenchHashtableRandom(uint64_t* state) {
+    // xorshift64
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+
+    return *state;
+}
+
+// The keys in the first half are inserted, the ones in the second half are used for the misses
+static bench_hashtable_keys_t* BenchHashtableKeysNew(uint64_t count) {
+    auto keys = (bench_hashtable_keys_t*)malloc(sizeof(bench_hashtable_keys_t));
+    keys->count = count;
+    keys->keys = (char*)malloc(count * BENCH_HASHTABLE_KEY_MAX_LENGTH);
+    keys->keys_length = (uint32_t*)malloc(count * sizeof(uint32_t));
+
+    for(uint64_t index = 0; index < count; index++) {
+        keys->keys_length[index] = snprintf(
+                keys->keys + index * BENCH_HASHTABLE_KEY_MAX_LENGTH,
+                BENCH_HASHTABLE_KEY_MAX_LENGTH,
+                "key:%lu",
+                index);
+    }
+
+    return keys;
+}
+
+static void BenchHashtableKeysFree(bench_hashtable_keys_t* keys) {
+    free(keys->keys);
+    free(keys->keys_length);
+    free(keys);
+}
+
+static hashtable_t* BenchHashtableFill(
+        benchmark::State& state,
+        bench_hashtable_keys_t* keys,
+        uint64_t keys_to_insert,
+        uint64_t buckets_count = benchmark_params.buckets_count) {
+    hashtable_t* hashtable = hashtable_new(buckets_count);
+
+    for(uint64_t index = 0; index < keys_to_insert; index++) {
+        if (!hashtable_insert(hashtable, BenchHashtableKey(keys, index), keys->keys_length[index], index)) {
+            state.SkipWithError("Unable to insert the key, the hashtable is full");
+            break;
+        }
+    }
+
+    return hashtable;
+}
+
+void BM_Hashtable_Operations_Insert(benchmark::State& state) {
+    double load_factor = (double)state.range(0) / 100.0;
+    uint64_t keys_to_insert = (uint64_t)((double)benchmark_params.buckets_count * load_factor);
+    bench_hashtable_keys_t* keys = BenchHashtableKeysNew(keys_to_insert);
+
+    BenchPerfCounters perf_counters(state);
+    for (auto _ : state) {
+        state.PauseTiming();
+        hashtable_t* hashtable = hashtable_new(benchmark_params.buckets_count);
+        state.ResumeTiming();
+
+        bool inserted = true;
+        for(uint64_t index = 0; index < keys_to_insert && inserted; index++) {
+            inserted = hashtable_insert(hashtable, BenchHashtableKey(keys, index), keys->keys_length[index], index);
+        }
+
+        state.PauseTiming();
+        hashtable_free(hashtable);
+
+        if (!inserted) {
+            state.SkipWithError("Unable to insert the key, the hashtable is full");
+            break;
+        }
+        state.ResumeTiming();
+    }
+    perf_counters.Stop();
+
+    state.SetItemsProcessed((int64_t)(state.iterations() * keys_to_insert));
+    state.counters["insert_ns"] = benchmark::Counter(
+            (double)(state.iterations() * keys_to_insert),
+            benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+
+    BenchHashtableKeysFree(keys);
+}
+
+void BM_Hashtable_Operations_LookupHit(benchmark::State& state) {
+    uint64_t random_state = 0x9E3779B97F4A7C15ull;
+    double load_factor = (double)state.range(0) / 100.0;
+    uint64_t keys_to_insert = (uint64_t)((double)benchmark_params.buckets_count * load_factor);
+    bench_hashtable_keys_t* keys = BenchHashtableKeysNew(keys_to_insert);
+    hashtable_t* hashtable = BenchHashtableFill(state, keys, keys_to_insert);
+
+    BenchHistogram histogram(state, __func__, { state.range(0) });
+    BenchPerfCounters perf_counters(state);
+    for (auto _ : state) {
+        histogram.Start();
+        uintptr_t value;
+        uint64_t index = BenchHashtableRandom(&random_state) % keys_to_insert;
+
+        benchmark::DoNotOptimize(
+                hashtable_lookup(hashtable, BenchHashtableKey(keys, index), keys->keys_length[index], &value));
+        histogram.Stop();
+    }
+    perf_counters.Stop();
+
+    hashtable_free(hashtable);
+    BenchHashtableKeysFree(keys);
+}
+
+void BM_Hashtable_Operations_LookupMiss(benchmark::State& state) {
+    uint64_t random_state = 0x9E3779B97F4A7C15ull;
+    double load_factor = (double)state.range(0) / 100.0;
+    uint64_t keys_to_insert = (uint64_t)((double)benchmark_params.buckets_count * load_factor);
+    bench_hashtable_keys_t* keys = BenchHashtableKeysNew(keys_to_insert * 2);
+    hashtable_t* hashtable = BenchHashtableFill(state, keys, keys_to_insert);
+
+    BenchHistogram histogram(state, __func__, { state.range(0) });
+    BenchPerfCounters perf_counters(state);
+    for (auto _ : state) {
+        histogram.Start();
+        uintptr_t value;
+        uint64_t index = keys_to_insert + BenchHashtableRandom(&random_state) % keys_to_insert;
+
+        benchmark::DoNotOptimize(
+                hashtable_lookup(hashtable, BenchHashtableKey(keys, index), keys->keys_length[index], &value));
+        histogram.Stop();
+    }
+    perf_counters.Stop();
+
+    hashtable_free(hashtable);
+    BenchHashtableKeysFree(keys);
+}
+
+// Looks up batches of random keys, all present, with hashtable_lookup_many when prefetch is set or with a loop of
+// hashtable_lookup otherwise
+void BM_Hashtable_Operations_LookupHitBatch(benchmark::State& state) {
+    uint64_t random_state = 0x9E3779B97F4A7C15ull;
+    uint32_t batch_size = state.range(0);
+    bool prefetch = state.range(1) == 1;
+    uint64_t keys_to_insert =
+            (benchmark_params.buckets_count_batch * benchmark_params.load_factor_batch) / 100;
+    bench_hashtable_keys_t* keys = BenchHashtableKeysNew(keys_to_insert);
+    hashtable_t* hashtable = BenchHashtableFill(state, keys, keys_to_insert, benchmark_params.buckets_count_batch);
+
+    const char* batch_keys[HASHTABLE_LOOKUP_MANY_GROUP_SIZE];
+    size_t batch_keys_length[HASHTABLE_LOOKUP_MANY_GROUP_SIZE];
+    uintptr_t batch_values[HASHTABLE_LOOKUP_MANY_GROUP_SIZE];
+    bool batch_found[HASHTABLE_LOOKUP_MANY_GROUP_SIZE];
+
+    BenchHistogram histogram(state, __func__, { state.range(0), state.range(1) });
+    BenchPerfCounters perf_counters(state);
+    for (auto _ : state) {
+        histogram.Start();
+        for(uint32_t batch_index = 0; batch_index < batch_size; batch_index++) {
+            uint64_t index = BenchHashtableRandom(&random_state) % keys_to_insert;
+            batch_keys[batch_index] = BenchHashtableKey(keys, index);
+            batch_keys_length[batch_index] = keys->keys_length[index];
+        }
+
+        if (prefetch) {
+            benchmark::DoNotOptimize(hashtable_lookup_many(
+                    hashtable,
+                    batch_keys,
+                    batch_keys_length,
+                    batch_size,
+                    batch_values,
+                    batch_found));
+        } else {
+            for(uint32_t batch_index = 0; batch_index < batch_size; batch_index++) {
+                batch_found[batch_index] = hashtable_lookup(
+                        hashtable,
+                        batch_keys[batch_index],
+                        batch_keys_length[batch_index],
+                        &batch_values[batch_index]);
+            }
+        }
+
+        benchmark::DoNotOptimize(batch_found);
+        benchmark::ClobberMemory();
+        histogram.Stop();
+    }
+    perf_counters.Stop();
+
+    state.SetItemsProcessed((int64_t)(state.iterations() * batch_size));
+    state.counters["lookup_ns"] = benchmark::Counter(
+            (double)(state.iterations() * batch_size),
+            benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+
+    hashtable_free(hashtable);
+    BenchHashtableKeysFree(keys);
+}
+
+// 80% lookups (half hits, half misses), 10% updates, 5% deletes and 5% inserts, the deletes and the inserts alternate
+// to keep the load factor stable
+void BM_Hashtable_Operations_Mixed(benchmark::State& state) {
+    uint64_t random_state = 0x9E3779B97F4A7C15ull;
+    double load_factor = (double)state.range(0) / 100.0;
+    uint64_t keys_to_insert = (uint64_t)((double)benchmark_params.buckets_count * load_factor);
+    uint64_t keys_count = keys_to_insert * 2;
+    bench_hashtable_keys_t* keys = BenchHashtableKeysNew(keys_count);
+    hashtable_t* hashtable = BenchHashtableFill(state, keys, keys_to_insert);
+    bool delete_next = true;
+
+    // The first keys_present entries are the keys in the hashtable, the others are the missing ones
+    auto keys_indexes = (uint64_t*)malloc(sizeof(uint64_t) * keys_count);
+    for(uint64_t index = 0; index < keys_count; index++) {
+        keys_indexes[index] = index;
+    }
+    uint64_t keys_present = keys_to_insert;
+
+    BenchPerfCounters perf_counters(state);
+    for (auto _ : state) {
+        uintptr_t value;
+        uint64_t random = BenchHashtableRandom(&random_state);
+        uint32_t operation = random % 100;
+        uint64_t position;
+        uint64_t index;
+
+        random >>= 8;
+        if (operation < 40) {
+            index = keys_indexes[random % keys_present];
+            benchmark::DoNotOptimize(
+                    hashtable_lookup(hashtable, BenchHashtableKey(keys, index), keys->keys_length[index], &value));
+        } else if (operation < 80) {
+            index = keys_indexes[keys_present + random % (keys_count - keys_present)];
+            benchmark::DoNotOptimize(
+                    hashtable_lookup(hashtable, BenchHashtableKey(keys, index), keys->keys_length[index], &value));
+        } else if (operation < 90) {
+            index = keys_indexes[random % keys_present];
+            benchmark::DoNotOptimize(
+                    hashtable_update(hashtable, BenchHashtableKey(keys, index), keys->keys_length[index], random));
+        } else if (delete_next) {
+            position = random % keys_present;
+            index = keys_indexes[position];
+            benchmark::DoNotOptimize(
+                    hashtable_delete(hashtable, BenchHashtableKey(keys, index), keys->keys_length[index]));
+
+            keys_present--;
+            keys_indexes[position] = keys_indexes[keys_present];
+            keys_indexes[keys_present] = index;
+            delete_next = false;
+        } else {
+            position = keys_present + random % (keys_count - keys_present);
+            index = keys_indexes[position];
+            if (!hashtable_insert(hashtable, BenchHashtableKey(keys, index), keys->keys_length[index], index)) {
+                state.SkipWithError("Unable to insert the key, the hashtable is full");
+                break;
+            }
+
+            keys_indexes[position] = keys_indexes[keys_present];
+            keys_indexes[keys_present] = index;
+            keys_present++;
+            delete_next = true;
+        }
+    }
+    perf_counters.Stop();
+
+    free(keys_indexes);
+    hashtable_free(hashtable);
+    BenchHashtableKeysFree(keys);
+}
+
+static void BenchArguments(benchmark::internal::Benchmark* b) {
+    b->Arg(50);
+    b->Arg(75);
+    b->Arg(85);
+    b->Arg(90);
+    b->Arg(95);
+    b->Iterations(1000000);
+}
+
+static void BenchArgumentsInsert(benchmark::internal::Benchmark* b) {
+    b->Arg(50);
+    b->Arg(75);
+    b->Arg(85);
+    b->Arg(90);
+    b->Arg(95);
+    b->Iterations(5);
+    b->Unit(benchmark::kMillisecond);
+}
+
+static void BenchArgumentsBatch(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"batch", "prefetch"});
+    for(int64_t prefetch = 0; prefetch <= 1; prefetch++) {
+        for(int64_t batch_size = 1; batch_size <= HASHTABLE_LOOKUP_MANY_GROUP_SIZE; batch_size *= 2) {
+            b->Args({batch_size, prefetch});
+        }
+    }
+    b->Iterations(100000);
+}
+
+BENCHMARK(BM_Hashtable_Operations_Insert)
+    ->Apply(BenchArgumentsInsert);
+BENCHMARK(BM_Hashtable_Operations_LookupHit)
+    ->Apply(BenchArguments);
+BENCHMARK(BM_Hashtable_Operations_LookupMiss)
+    ->Apply(BenchArguments);
+BENCHMARK(BM_Hashtable_Operations_LookupHitBatch)
+    ->Apply(BenchArgumentsBatch);
+BENCHMARK(BM_Hashtable_Operations_Mixed)
+    ->Apply(BenchArguments);
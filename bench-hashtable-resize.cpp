@@ -0,0 +1,131 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+#include "libhashtable/hashtable.h"
+#include "libhashtable/hashtable_resizable.h"
+
+#include "bench-support-cache.h"
+#include "bench-support-perf.h"
+
+#define BENCH_RESIZE_KEY_MAX_LENGTH 24
+#define BENCH_RESIZE_INITIAL_BUCKETS_COUNT (1u << 16)
+// Enough keys to double the hashtable 5 times, from 64k to 2M buckets
+#define BENCH_RESIZE_KEYS_COUNT (1u << 20)
+
+static inline uint64_t BenchResizeRandom(uint64_t* state) {
+    // xorshift64
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+
+    return *state;
+}
+
+static void BenchResizePercentiles(
+        benchmark::State& state,
+        const char* operation,
+        std::vector<uint64_t>& latencies_ns) {
+    std::sort(latencies_ns.begin(), latencies_ns.end());
+    std::string prefix(operation);
+    size_t count = latencies_ns.size();
+
+    state.counters[prefix + "_p50_ns"] = (double)latencies_ns[count * 50 / 100];
+    state.counters[prefix + "_p99_ns"] = (double)latencies_ns[count * 99 / 100];
+    state.counters[prefix + "_p999_ns"] = (double)latencies_ns[count * 999 / 1000];
+    state.counters[prefix + "_max_ns"] = (double)latencies_ns[count - 1];
+}
+
+// Every key inserted is followed by the lookup of a random key inserted before it, the latency of each operation is
+// measured while the hashtable doubles several times. The argument is the number of chunks migrated by every
+// operation, HASHTABLE_RESIZABLE_MIGRATE_ALL is the stop-the-world rehash.
+void BM_Hashtable_Resize(benchmark::State& state) {
+    uint64_t migrate_chunks_per_op = state.range(0);
+    uint64_t keys_count = BENCH_RESIZE_KEYS_COUNT;
+    uint64_t overhead_ns = BenchCacheClockOverheadNs();
+    uint64_t resizes_count = 0;
+    std::vector<uint64_t> insert_latencies_ns(keys_count);
+    std::vector<uint64_t> lookup_latencies_ns(keys_count);
+
+    state.SetLabel(migrate_chunks_per_op == HASHTABLE_RESIZABLE_MIGRATE_ALL
+            ? "stop-the-world"
+            : "incremental");
+
+    auto keys = (char*)malloc(keys_count * BENCH_RESIZE_KEY_MAX_LENGTH);
+    auto keys_length = (uint32_t*)malloc(keys_count * sizeof(uint32_t));
+
+    for(uint64_t index = 0; index < keys_count; index++) {
+        keys_length[index] = snprintf(
+                keys + index * BENCH_RESIZE_KEY_MAX_LENGTH,
+                BENCH_RESIZE_KEY_MAX_LENGTH,
+                "key:%lu",
+                index);
+    }
+
+    BenchPerfCounters perf_counters(state);
+    for (auto _ : state) {
+        uint64_t random_state = 0x9E3779B97F4A7C15ull;
+        hashtable_resizable_t* hashtable_resizable = hashtable_resizable_new(
+                BENCH_RESIZE_INITIAL_BUCKETS_COUNT,
+                migrate_chunks_per_op);
+
+        for(uint64_t index = 0; index < keys_count; index++) {
+            uintptr_t value;
+            uint64_t lookup_index = BenchResizeRandom(&random_state) % (index + 1);
+
+            uint64_t start = BenchCacheNowNs();
+            bool inserted = hashtable_resizable_insert(
+                    hashtable_resizable,
+                    keys + index * BENCH_RESIZE_KEY_MAX_LENGTH,
+                    keys_length[index],
+                    index) == HASHTABLE_RESIZABLE_INSERT_RESULT_INSERTED;
+            uint64_t middle = BenchCacheNowNs();
+            bool found = hashtable_resizable_lookup(
+                    hashtable_resizable,
+                    keys + lookup_index * BENCH_RESIZE_KEY_MAX_LENGTH,
+                    keys_length[lookup_index],
+                    &value);
+            uint64_t end = BenchCacheNowNs();
+
+            if (!inserted || !found || value != lookup_index) {
+                state.SkipWithError("Unable to insert or to find the key");
+                break;
+            }
+
+            insert_latencies_ns[index] = middle - start > overhead_ns ? middle - start - overhead_ns : 0;
+            lookup_latencies_ns[index] = end - middle > overhead_ns ? end - middle - overhead_ns : 0;
+        }
+
+        state.PauseTiming();
+        resizes_count = hashtable_resizable->resizes_count;
+        hashtable_resizable_free(hashtable_resizable);
+        state.ResumeTiming();
+    }
+    perf_counters.Stop();
+
+    BenchResizePercentiles(state, "insert", insert_latencies_ns);
+    BenchResizePercentiles(state, "lookup", lookup_latencies_ns);
+    state.counters["resizes"] = (double)resizes_count;
+
+    free(keys_length);
+    free(keys);
+}
+
+static void BenchArguments(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"migrate_chunks"});
+    b->Arg(HASHTABLE_RESIZABLE_MIGRATE_ALL);
+    b->Arg(1);
+    b->Arg(4);
+    b->Arg(16);
+    b->Arg(64);
+    b->Iterations(1);
+    b->Unit(benchmark::kMillisecond);
+}
+
+BENCHMARK(BM_Hashtable_Resize)
+    ->Apply(BenchArguments);
@@ -1,74 +1,29 @@
+#include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include <string>
 #include <benchmark/benchmark.h>
 #include <immintrin.h>
 
-__attribute__((__target__("avx2")))
-int avx2_casecmp_eq_str_32(const char a[32], size_t a_len, const char b[32], size_t b_len) {
-    static uint32_t len_mask_table[33] = {
-            0x0000, 0x0001, 0x0003, 0x0007, 0x000f, 0x001f, 0x003f, 0x007f, 0x00ff,
-            0x01ff, 0x03ff, 0x07ff, 0x0fff, 0x1fff, 0x3fff, 0x7fff, 0xffff, 0x1ffff,
-            0x3ffff, 0x7ffff, 0xfffff, 0x1fffff, 0x3fffff, 0x7fffff, 0xffffff,
-            0x1ffffff, 0x3ffffff, 0x7ffffff, 0xfffffff, 0x1fffffff, 0x3fffffff,
-            0x7fffffff, 0xffffffff,
-    };
-    static uint8_t letter_uppercase_range_lower[32] = {
-            0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40,
-            0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40 };
-    static uint8_t letter_uppercase_range_upper[32] = {
-            0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a,
-            0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a };
-    static uint8_t letter_lowercase_bit[32] = {
-            0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-            0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20 };
-
-    assert(a_len <= sizeof(len_mask_table));
-    assert(b_len <= sizeof(len_mask_table));
-
-    if (a_len != b_len) {
-        return false;
-    }
+#include "libhashtable/hashtable_support_string_cmp.h"
 
-    uint32_t eq_masq;
-
-    // Load the strings
-    __m256i a_block = _mm256_castpd_si256(_mm256_loadu_pd((double*)a));
-    __m256i b_block = _mm256_castpd_si256(_mm256_loadu_pd((double*)b));
-    __m256i letter_uppercase_range_lower_block = _mm256_castpd_si256(_mm256_loadu_pd((double*)&letter_uppercase_range_lower));
-    __m256i letter_uppercase_range_upper_block = _mm256_castpd_si256(_mm256_loadu_pd((double*)&letter_uppercase_range_upper));
-    __m256i letter_lowercase_bit_block = _mm256_castpd_si256(_mm256_loadu_pd((double*)&letter_lowercase_bit));
-
-    // First identifies the upper case letters, because AVX2 doesn't provide a _mm256_cmplt_epi8 the _mm256_cmpgt_epi8
-    // is being used in combination with _mm256_andnot_si256 to build 2 masks to identify which bytes are over A and
-    // which ones are over Z and then convert the false of the second mask to true and identify the upper case letters.
-    // Once the letters are identified, a bitmask for the lowercase bit is built for the single bytes and then the
-    // bitmask of the bytes in the mask is applied to the initial string to covert it to lower case.
-    // This process is repeated twice for the two strings.
-    __m256i a_letters_uppercase_lower_mask = _mm256_cmpgt_epi8(a_block, letter_uppercase_range_lower_block);
-    __m256i a_letters_uppercase_upper_mask = _mm256_cmpgt_epi8(a_block, letter_uppercase_range_upper_block);
-    __m256i a_letters_uppercase_mask = _mm256_andnot_si256(a_letters_uppercase_upper_mask, a_letters_uppercase_lower_mask);
-    __m256i a_letters_lowercase_bit_mask = _mm256_and_si256(a_letters_uppercase_mask, letter_lowercase_bit_block);
-    __m256i a_lowercase = _mm256_or_si256(a_block, a_letters_lowercase_bit_mask);
-
-    __m256i b_letters_uppercase_lower_mask = _mm256_cmpgt_epi8(b_block, letter_uppercase_range_lower_block);
-    __m256i b_letters_uppercase_upper_mask = _mm256_cmpgt_epi8(b_block, letter_uppercase_range_upper_block);
-    __m256i b_letters_uppercase_mask = _mm256_andnot_si256(b_letters_uppercase_upper_mask, b_letters_uppercase_lower_mask);
-    __m256i b_letters_lowercase_bit_mask = _mm256_and_si256(b_letters_uppercase_mask, letter_lowercase_bit_block);
-    __m256i b_lowercase = _mm256_or_si256(b_block, b_letters_lowercase_bit_mask);
-
-    // This part of code matches the implementation of cmp_eq_32 but it's repeated as the code sharing wouldn't really
-    // improve the readability.
-    __m256i result_mask_vector = _mm256_cmpeq_epi8(a_lowercase, b_lowercase);
-    eq_masq = (uint32_t)_mm256_movemask_epi8(result_mask_vector);
-
-    return (eq_masq & len_mask_table[a_len]) == len_mask_table[a_len];
-}
+#include "bench-support-perf.h"
 
-__attribute__((__target__("avx2")))
-void BM_Hashtable_ShortStrings_Strncasecmp_Avx2(benchmark::State& state) {
+static void BM_Hashtable_ShortStrings_Strncasecmp_Simd(
+        benchmark::State& state,
+        hashtable_casecmp_eq_str_32_fp_t* casecmp_eq_str_32_fp,
+        bool supported) {
     auto len = state.range(0);
 
+    if (!supported) {
+        state.SkipWithError("Instruction set not supported");
+        return;
+    }
+
     char data[192] = { 0 };
 
     char *a_string = data;
@@ -81,10 +36,48 @@ void BM_Hashtable_ShortStrings_Strncasecmp_Avx2(benchmark::State& state) {
         b_string[i] = '.';
     }
 
+    BenchPerfCounters perf_counters(state);
     for (auto _ : state) {
         benchmark::DoNotOptimize(
-                avx2_casecmp_eq_str_32((const char *)a_string, len, (const char *)b_string, len));
+                casecmp_eq_str_32_fp((const char *)a_string, len, (const char *)b_string, len));
     }
+    perf_counters.Stop();
+}
+
+void BM_Hashtable_ShortStrings_Strncasecmp_Scalar(benchmark::State& state) {
+    BM_Hashtable_ShortStrings_Strncasecmp_Simd(
+            state,
+            hashtable_casecmp_eq_str_scalar_32,
+            true);
+}
+
+void BM_Hashtable_ShortStrings_Strncasecmp_Sse42(benchmark::State& state) {
+    BM_Hashtable_ShortStrings_Strncasecmp_Simd(
+            state,
+            hashtable_casecmp_eq_str_sse42_32,
+            __builtin_cpu_supports("sse4.2"));
+}
+
+void BM_Hashtable_ShortStrings_Strncasecmp_Avx2(benchmark::State& state) {
+    BM_Hashtable_ShortStrings_Strncasecmp_Simd(
+            state,
+            hashtable_casecmp_eq_str_avx2_32,
+            __builtin_cpu_supports("avx2"));
+}
+
+void BM_Hashtable_ShortStrings_Strncasecmp_Avx512(benchmark::State& state) {
+    BM_Hashtable_ShortStrings_Strncasecmp_Simd(
+            state,
+            hashtable_casecmp_eq_str_avx512bw_32,
+            __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl"));
+}
+
+// Goes through the ifunc selected when the binary is loaded
+void BM_Hashtable_ShortStrings_Strncasecmp_Dispatch(benchmark::State& state) {
+    BM_Hashtable_ShortStrings_Strncasecmp_Simd(
+            state,
+            hashtable_casecmp_eq_str_32,
+            true);
 }
 
 __attribute__((__target__("avx2")))
@@ -103,10 +96,12 @@ void BM_Hashtable_ShortStrings_Strncasecmp_Glibc(benchmark::State& state) {
         b_string[i] = '.';
     }
 
+    BenchPerfCounters perf_counters(state);
     for (auto _ : state) {
         benchmark::DoNotOptimize(
                 strncasecmp((const char *)a_string, (const char *)b_string, 32));
     }
+    perf_counters.Stop();
 }
 
 static void BenchArguments(benchmark::internal::Benchmark* b) {
@@ -114,7 +109,195 @@ static void BenchArguments(benchmark::internal::Benchmark* b) {
     b->Iterations(100000);
 }
 
+BENCHMARK(BM_Hashtable_ShortStrings_Strncasecmp_Scalar)
+    ->Apply(BenchArguments);
+BENCHMARK(BM_Hashtable_ShortStrings_Strncasecmp_Sse42)
+    ->Apply(BenchArguments);
 BENCHMARK(BM_Hashtable_ShortStrings_Strncasecmp_Avx2)
     ->Apply(BenchArguments);
+BENCHMARK(BM_Hashtable_ShortStrings_Strncasecmp_Avx512)
+    ->Apply(BenchArguments);
+BENCHMARK(BM_Hashtable_ShortStrings_Strncasecmp_Dispatch)
+    ->Apply(BenchArguments);
 BENCHMARK(BM_Hashtable_ShortStrings_Strncasecmp_Glibc)
     ->Apply(BenchArguments);
+
+#define BENCH_STRINGS_MISMATCH_NONE 0
+#define BENCH_STRINGS_MISMATCH_START 1
+#define BENCH_STRINGS_MISMATCH_MIDDLE 2
+#define BENCH_STRINGS_MISMATCH_END 3
+
+static const char* BenchStringsMismatchName(int64_t mismatch) {
+    switch(mismatch) {
+        case BENCH_STRINGS_MISMATCH_START:
+            return "mismatch_start";
+        case BENCH_STRINGS_MISMATCH_MIDDLE:
+            return "mismatch_middle";
+        case BENCH_STRINGS_MISMATCH_END:
+            return "mismatch_end";
+        default:
+            return "equal";
+    }
+}
+
+// The string ends right before a PROT_NONE page, a compare reading past the end of the string faults
+static char* BenchStringsAllocGuarded(size_t len, void** mapping, size_t* mapping_size) {
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    size_t pages = (len + page_size - 1) / page_size;
+
+    *mapping_size = (pages + 1) * page_size;
+    *mapping = mmap(NULL, *mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (*mapping == MAP_FAILED) {
+        perror("mmap");
+        exit(-1);
+    }
+
+    if (mprotect((char*)*mapping + pages * page_size, page_size, PROT_NONE) != 0) {
+        perror("mprotect");
+        exit(-1);
+    }
+
+    return (char*)*mapping + pages * page_size - len;
+}
+
+static int BenchStringsGlibcCasecmp(const char* a, size_t a_len, const char* b, size_t b_len) {
+    return a_len == b_len && strncasecmp(a, b, a_len) == 0;
+}
+
+static int BenchStringsGlibcCmp(const char* a, size_t a_len, const char* b, size_t b_len) {
+    return a_len == b_len && memcmp(a, b, a_len) == 0;
+}
+
+// In the case insensitive benchmarks b is the upper case version of a
+static void BM_Hashtable_Strings_Cmp(
+        benchmark::State& state,
+        hashtable_cmp_eq_str_fp_t* cmp_eq_str_fp,
+        bool supported,
+        bool case_insensitive) {
+    size_t len = state.range(0);
+    int64_t mismatch = state.range(1);
+    void *a_mapping, *b_mapping;
+    size_t a_mapping_size, b_mapping_size;
+
+    if (!supported) {
+        state.SkipWithError("Instruction set not supported");
+        return;
+    }
+
+    state.SetLabel(BenchStringsMismatchName(mismatch));
+
+    char* a_string = BenchStringsAllocGuarded(len, &a_mapping, &a_mapping_size);
+    char* b_string = BenchStringsAllocGuarded(len, &b_mapping, &b_mapping_size);
+
+    for(size_t index = 0; index < len; index++) {
+        a_string[index] = (char)('a' + (index % 26));
+        b_string[index] = case_insensitive
+                ? (char)('A' + (index % 26))
+                : a_string[index];
+    }
+
+    if (mismatch == BENCH_STRINGS_MISMATCH_START) {
+        b_string[0] = '#';
+    } else if (mismatch == BENCH_STRINGS_MISMATCH_MIDDLE) {
+        b_string[len / 2] = '#';
+    } else if (mismatch == BENCH_STRINGS_MISMATCH_END) {
+        b_string[len - 1] = '#';
+    }
+
+    BenchPerfCounters perf_counters(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(cmp_eq_str_fp(a_string, len, b_string, len));
+    }
+    perf_counters.Stop();
+
+    munmap(a_mapping, a_mapping_size);
+    munmap(b_mapping, b_mapping_size);
+}
+
+void BM_Hashtable_Strings_Casecmp_Scalar(benchmark::State& state) {
+    BM_Hashtable_Strings_Cmp(state, hashtable_casecmp_eq_str_scalar, true, true);
+}
+
+void BM_Hashtable_Strings_Casecmp_Sse42(benchmark::State& state) {
+    BM_Hashtable_Strings_Cmp(state, hashtable_casecmp_eq_str_sse42, __builtin_cpu_supports("sse4.2"), true);
+}
+
+void BM_Hashtable_Strings_Casecmp_Avx2(benchmark::State& state) {
+    BM_Hashtable_Strings_Cmp(state, hashtable_casecmp_eq_str_avx2, __builtin_cpu_supports("avx2"), true);
+}
+
+void BM_Hashtable_Strings_Casecmp_Avx512(benchmark::State& state) {
+    BM_Hashtable_Strings_Cmp(state, hashtable_casecmp_eq_str_avx512bw, __builtin_cpu_supports("avx512bw"), true);
+}
+
+void BM_Hashtable_Strings_Casecmp_Dispatch(benchmark::State& state) {
+    BM_Hashtable_Strings_Cmp(state, hashtable_casecmp_eq_str, true, true);
+}
+
+void BM_Hashtable_Strings_Casecmp_Glibc(benchmark::State& state) {
+    BM_Hashtable_Strings_Cmp(state, BenchStringsGlibcCasecmp, true, true);
+}
+
+void BM_Hashtable_Strings_Cmp_Scalar(benchmark::State& state) {
+    BM_Hashtable_Strings_Cmp(state, hashtable_cmp_eq_str_scalar, true, false);
+}
+
+void BM_Hashtable_Strings_Cmp_Sse42(benchmark::State& state) {
+    BM_Hashtable_Strings_Cmp(state, hashtable_cmp_eq_str_sse42, __builtin_cpu_supports("sse4.2"), false);
+}
+
+void BM_Hashtable_Strings_Cmp_Avx2(benchmark::State& state) {
+    BM_Hashtable_Strings_Cmp(state, hashtable_cmp_eq_str_avx2, __builtin_cpu_supports("avx2"), false);
+}
+
+void BM_Hashtable_Strings_Cmp_Avx512(benchmark::State& state) {
+    BM_Hashtable_Strings_Cmp(state, hashtable_cmp_eq_str_avx512bw, __builtin_cpu_supports("avx512bw"), false);
+}
+
+void BM_Hashtable_Strings_Cmp_Dispatch(benchmark::State& state) {
+    BM_Hashtable_Strings_Cmp(state, hashtable_cmp_eq_str, true, false);
+}
+
+void BM_Hashtable_Strings_Cmp_Glibc(benchmark::State& state) {
+    BM_Hashtable_Strings_Cmp(state, BenchStringsGlibcCmp, true, false);
+}
+
+static void BenchArgumentsStrings(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"len", "mismatch"});
+    for(int64_t mismatch : {
+            BENCH_STRINGS_MISMATCH_NONE,
+            BENCH_STRINGS_MISMATCH_START,
+            BENCH_STRINGS_MISMATCH_MIDDLE,
+            BENCH_STRINGS_MISMATCH_END }) {
+        for(int64_t len : { 1, 7, 15, 16, 31, 32, 33, 63, 64, 65, 127, 128, 255, 256, 512, 1024, 2048, 4095, 4096 }) {
+            b->Args({len, mismatch});
+        }
+    }
+    b->Iterations(100000);
+}
+
+BENCHMARK(BM_Hashtable_Strings_Casecmp_Scalar)
+    ->Apply(BenchArgumentsStrings);
+BENCHMARK(BM_Hashtable_Strings_Casecmp_Sse42)
+    ->Apply(BenchArgumentsStrings);
+BENCHMARK(BM_Hashtable_Strings_Casecmp_Avx2)
+    ->Apply(BenchArgumentsStrings);
+BENCHMARK(BM_Hashtable_Strings_Casecmp_Avx512)
+    ->Apply(BenchArgumentsStrings);
+BENCHMARK(BM_Hashtable_Strings_Casecmp_Dispatch)
+    ->Apply(BenchArgumentsStrings);
+BENCHMARK(BM_Hashtable_Strings_Casecmp_Glibc)
+    ->Apply(BenchArgumentsStrings);
+BENCHMARK(BM_Hashtable_Strings_Cmp_Scalar)
+    ->Apply(BenchArgumentsStrings);
+BENCHMARK(BM_Hashtable_Strings_Cmp_Sse42)
+    ->Apply(BenchArgumentsStrings);
+BENCHMARK(BM_Hashtable_Strings_Cmp_Avx2)
+    ->Apply(BenchArgumentsStrings);
+BENCHMARK(BM_Hashtable_Strings_Cmp_Avx512)
+    ->Apply(BenchArgumentsStrings);
+BENCHMARK(BM_Hashtable_Strings_Cmp_Dispatch)
+    ->Apply(BenchArgumentsStrings);
+BENCHMARK(BM_Hashtable_Strings_Cmp_Glibc)
+    ->Apply(BenchArgumentsStrings);
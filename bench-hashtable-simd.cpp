@@ -4,10 +4,18 @@
 #include <benchmark/benchmark.h>
 #include <immintrin.h>
 
+#include "libhashtable/hashtable_support_hash_search.h"
+
+#include "bench-support-cache.h"
+#include "bench-support-perf.h"
+#include "bench-support-histogram.h"
+
 #define HASHTABLE_SEARCH_MAX (16*32)
 
 #define HASHTABLE_BUCKET_FLAGS_FILLED 0x01
 
+#define BENCH_SIMD_METADATA_REGIONS_COUNT 1024
+
 typedef union ht_bucket ht_bucket_t;
 union ht_bucket {
     uint32_t hash;
@@ -18,6 +26,9 @@ union ht_bucket {
     } data __attribute__((aligned(4)));
 };
 
+// SwissTable style metadata, a 7 bits tag or the empty / deleted states packed in a byte
+typedef uint8_t ht_control_byte_t;
+
 typedef struct benchmark_params benchmark_params_t;
 struct benchmark_params {
     uint32_t buckets_count;
@@ -28,6 +39,84 @@ static benchmark_params_t benchmark_params = {
         .iterations = 1000000
 };
 
+template <typename T>
+static void BenchHashtableSimdFill(T* ht_buckets, uint32_t buckets_count) {
+    for(uint32_t index = 0; index < buckets_count; index++) {
+        ht_buckets[index].data.filled = true;
+        ht_buckets[index].data.hash_quarter = (uint16_t)(index & 0xFFFFu);
+    }
+}
+
+template <typename T>
+static inline bool BenchHashtableSimdWithoutSearch(T* ht_buckets, uint16_t hash_quarter) {
+    bool found = false;
+
+    for(uint32_t index = 0; index < HASHTABLE_SEARCH_MAX; index++) {
+        if (!ht_buckets[index].data.filled) {
+            continue;
+        }
+
+        benchmark::DoNotOptimize((found = ht_buckets[index].data.hash_quarter == hash_quarter));
+        if (found) {
+            break;
+        }
+    }
+
+    return found;
+}
+
+template <typename T, hashtable_linear_search_16_fp_t* linear_search_16_fp>
+static inline bool BenchHashtableSimdWithSearch(T* ht_hashes, uint16_t hash_quarter) {
+    uint32_t skip_indexes_mask;
+    bool found = false;
+    ht_bucket_t bucket_search = { 0 };
+    bucket_search.data.filled = true;
+    bucket_search.data.hash_quarter = hash_quarter;
+
+    for(
+            uint64_t chunk_index = 0;
+            chunk_index <= HASHTABLE_SEARCH_MAX && !found;
+            chunk_index += 16) {
+        ht_bucket_t* ht_bucket_search_start = &ht_hashes[chunk_index];
+
+        // The mask is used in case of collisions, the while loop below updates the mask to exclude
+        // the colliding value and search the one after
+        skip_indexes_mask = 0;
+
+        while (true) {
+            uint32_t chunk_slot_index = linear_search_16_fp(
+                    bucket_search.hash,
+                    (uint32_t*)ht_bucket_search_start,
+                    skip_indexes_mask);
+
+            if (chunk_slot_index == HASHTABLE_MCMP_SUPPORT_HASH_SEARCH_NOT_FOUND) {
+                break;
+            }
+
+            benchmark::DoNotOptimize(found = true);
+            break;
+        }
+    }
+
+    return found;
+}
+
+template <hashtable_linear_search_16_fp_t* linear_search_16_fp>
+static bool BenchHashtableSimdWithSupported(benchmark::State& state) {
+    if (linear_search_16_fp == hashtable_linear_search_sse42_16 && !__builtin_cpu_supports("sse4.2")) {
+        state.SkipWithError("SSE4.2 not supported");
+        return false;
+    } else if (linear_search_16_fp == hashtable_linear_search_avx2_16 && !__builtin_cpu_supports("avx2")) {
+        state.SkipWithError("AVX2 not supported");
+        return false;
+    } else if (linear_search_16_fp == hashtable_linear_search_avx512f_16 && !__builtin_cpu_supports("avx512f")) {
+        state.SkipWithError("AVX-512F not supported");
+        return false;
+    }
+
+    return true;
+}
+
 template <typename T>
 void BM_Hashtable_Simd_without(benchmark::State& state) {
     uint32_t distance = state.range(0);
@@ -42,34 +131,64 @@ void BM_Hashtable_Simd_without(benchmark::State& state) {
     memset(ht_buckets, 0, ht_buckets_size * iterations);
 
     for(uint64_t iteration = 0; iteration < iterations; iteration++) {
-        uint64_t iteration_start_index = iteration * buckets_count;
-        for(
-                uint32_t index = iteration_start_index;
-                index < iteration_start_index + buckets_count;
-                index++) {
-            ht_buckets[index].data.filled = true;
-            ht_buckets[index].data.hash_quarter = (uint16_t)((index - iteration_start_index) & 0xFFFFu);
-        }
+        BenchHashtableSimdFill<T>(&ht_buckets[iteration * buckets_count], buckets_count);
     }
 
     uint64_t iteration = 0;
+    BenchHistogram histogram(state, __PRETTY_FUNCTION__, { distance });
+    BenchPerfCounters perf_counters(state);
     for (auto _ : state) {
-        bool found;
-        uint64_t iteration_start_index = iteration * buckets_count;
+        histogram.Start();
+        bool found = BenchHashtableSimdWithoutSearch<T>(&ht_buckets[iteration * buckets_count], hash_quarter);
+        benchmark::DoNotOptimize(found);
+        histogram.Stop();
 
-        for(
-                uint32_t index = iteration_start_index;
-                index < iteration_start_index + HASHTABLE_SEARCH_MAX;
-                index++) {
-            if (!ht_buckets[index].data.filled) {
-                continue;
-            }
-
-            benchmark::DoNotOptimize((found = ht_buckets[index].data.hash_quarter == hash_quarter));
-            if (found) {
-                break;
-            }
+#ifdef DEBUG
+        if (!found) {
+            throw std::runtime_error("Unable to find requested hash, iteration " + std::to_string(iteration) + ", hash " + std::to_string(hash));
         }
+#endif
+
+        iteration++;
+    }
+    perf_counters.Stop();
+
+    free(ht_buckets);
+}
+
+template <typename T, hashtable_linear_search_16_fp_t* linear_search_16_fp = hashtable_linear_search_avx2_16>
+void BM_Hashtable_Simd_with(benchmark::State& state) {
+    uint32_t distance = state.range(0);
+    uint64_t hash = distance;
+    uint32_t buckets_count = benchmark_params.buckets_count;
+    uint32_t iterations = benchmark_params.iterations;
+
+    if (!BenchHashtableSimdWithSupported<linear_search_16_fp>(state)) {
+        return;
+    }
+
+    buckets_count += (buckets_count % 16) + 16;
+
+    uint16_t hash_quarter = hash & 0xFFFFu;
+    size_t ht_hashes_size = buckets_count * sizeof(T);
+
+    auto ht_hashes = (T*)malloc(ht_hashes_size * iterations);
+    memset(ht_hashes, 0, ht_hashes_size * iterations);
+
+    for(uint64_t iteration = 0; iteration < iterations; iteration++) {
+        BenchHashtableSimdFill<T>(&ht_hashes[iteration * buckets_count], buckets_count);
+    }
+
+    uint64_t iteration = 0;
+    BenchHistogram histogram(state, __PRETTY_FUNCTION__, { distance });
+    BenchPerfCounters perf_counters(state);
+    for (auto _ : state) {
+        histogram.Start();
+        bool found = BenchHashtableSimdWithSearch<T, linear_search_16_fp>(
+                &ht_hashes[iteration * buckets_count],
+                hash_quarter);
+        benchmark::DoNotOptimize(found);
+        histogram.Stop();
 
 #ifdef DEBUG
         if (!found) {
@@ -79,47 +198,96 @@ void BM_Hashtable_Simd_without(benchmark::State& state) {
 
         iteration++;
     }
+    perf_counters.Stop();
+
+    free(ht_hashes);
+}
+
+// A single region of buckets is searched at every iteration, evicted from the cache before each iteration in cold mode
+// (the second argument), the memory used doesn't depend on the number of iterations
+template <typename T>
+void BM_Hashtable_Simd_without_Cache(benchmark::State& state) {
+    uint32_t distance = state.range(0);
+    int64_t cache_mode = state.range(1);
+    uint16_t hash_quarter = distance & 0xFFFFu;
+    uint32_t buckets_count = benchmark_params.buckets_count;
+    size_t ht_buckets_size = buckets_count * sizeof(T);
+
+    state.SetLabel(BenchCacheModeName(cache_mode));
+
+    auto ht_buckets = (T*)aligned_alloc(64, ht_buckets_size);
+    memset(ht_buckets, 0, ht_buckets_size);
+    BenchHashtableSimdFill<T>(ht_buckets, buckets_count);
+
+    BenchHistogram histogram(state, __PRETTY_FUNCTION__, { distance, cache_mode });
+    BenchPerfCounters perf_counters(state);
+    for (auto _ : state) {
+        BenchCacheIteration(state, cache_mode, ht_buckets, ht_buckets_size, [&]() {
+            histogram.Start();
+            benchmark::DoNotOptimize(BenchHashtableSimdWithoutSearch<T>(ht_buckets, hash_quarter));
+            histogram.Stop();
+        });
+    }
+    perf_counters.Stop();
 
     free(ht_buckets);
 }
 
-#define HASHTABLE_MCMP_SUPPORT_HASH_SEARCH_NOT_FOUND     32u
+template <typename T, hashtable_linear_search_16_fp_t* linear_search_16_fp = hashtable_linear_search_avx2_16>
+void BM_Hashtable_Simd_with_Cache(benchmark::State& state) {
+    uint32_t distance = state.range(0);
+    int64_t cache_mode = state.range(1);
+    uint16_t hash_quarter = distance & 0xFFFFu;
+    uint32_t buckets_count = benchmark_params.buckets_count;
 
-__attribute__((__target__("avx2")))
-uint32_t hashtable_linear_search_avx2_16(
-        uint32_t half_hash,
-        uint32_t* half_hashes,
-        uint32_t skip_indexes_mask) {
-    uint32_t compacted_result_mask = 0;
-    uint32_t skip_indexes_mask_inv = ~skip_indexes_mask;
-    __m256i cmp_vector = _mm256_set1_epi32(half_hash);
+    if (!BenchHashtableSimdWithSupported<linear_search_16_fp>(state)) {
+        return;
+    }
 
-    for(uint8_t base_index = 0; base_index < 16; base_index += 8) {
-        __m256i ring_vector = _mm256_loadu_si256((__m256i*) (half_hashes + base_index));
-        __m256i result_mask_vector = _mm256_cmpeq_epi32(ring_vector, cmp_vector);
+    state.SetLabel(BenchCacheModeName(cache_mode));
 
-        // Uses _mm256_movemask_ps to reduce the bandwidth
-        compacted_result_mask |= (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(result_mask_vector)) << (base_index);
+    buckets_count += (buckets_count % 16) + 16;
+    size_t ht_hashes_size = buckets_count * sizeof(T);
+
+    auto ht_hashes = (T*)aligned_alloc(64, ht_hashes_size);
+    memset(ht_hashes, 0, ht_hashes_size);
+    BenchHashtableSimdFill<T>(ht_hashes, buckets_count);
+
+    BenchHistogram histogram(state, __PRETTY_FUNCTION__, { distance, cache_mode });
+    BenchPerfCounters perf_counters(state);
+    for (auto _ : state) {
+        BenchCacheIteration(state, cache_mode, ht_hashes, ht_hashes_size, [&]() {
+            histogram.Start();
+            benchmark::DoNotOptimize(BenchHashtableSimdWithSearch<T, linear_search_16_fp>(ht_hashes, hash_quarter));
+            histogram.Stop();
+        });
     }
+    perf_counters.Stop();
 
-    return _tzcnt_u32(compacted_result_mask & skip_indexes_mask_inv);
+    free(ht_hashes);
 }
 
-template <typename T>
-void BM_Hashtable_Simd_with(benchmark::State& state) {
-    uint32_t skip_indexes_mask;
+// The chunks are made of 16 bits tags, the hash quarters, a chunk of 32 tags is searched with a single compare and a
+// chunk of 64 tags with two
+template <uint32_t chunk_slots>
+void BM_Hashtable_Simd_with_tags(benchmark::State& state) {
     uint32_t distance = state.range(0);
     uint64_t hash = distance;
     uint32_t buckets_count = benchmark_params.buckets_count;
     uint32_t iterations = benchmark_params.iterations;
 
-    buckets_count += (buckets_count % 16) + 16;
+    if (!__builtin_cpu_supports("avx512bw")) {
+        state.SkipWithError("AVX-512BW not supported");
+        return;
+    }
+
+    buckets_count += (buckets_count % chunk_slots) + chunk_slots;
 
     uint16_t hash_quarter = hash & 0xFFFFu;
-    size_t ht_hashes_size = buckets_count * sizeof(T);
+    size_t ht_tags_size = buckets_count * sizeof(uint16_t);
 
-    auto ht_hashes = (T*)malloc(ht_hashes_size * iterations);
-    memset(ht_hashes, 0, ht_hashes_size * iterations);
+    auto ht_tags = (uint16_t*)malloc(ht_tags_size * iterations);
+    memset(ht_tags, 0, ht_tags_size * iterations);
 
     for(uint64_t iteration = 0; iteration < iterations; iteration++) {
         uint64_t iteration_start_index = iteration * buckets_count;
@@ -127,44 +295,35 @@ void BM_Hashtable_Simd_with(benchmark::State& state) {
                 uint32_t index = iteration_start_index;
                 index < iteration_start_index + buckets_count;
                 index++) {
-            ht_hashes[index].data.filled = true;
-            ht_hashes[index].data.hash_quarter = (uint16_t)((index - iteration_start_index) & 0xFFFFu);
+            ht_tags[index] = (uint16_t)((index - iteration_start_index) & 0xFFFFu);
         }
     }
 
     uint64_t iteration = 0;
-    uint32_t chunk_start_index = 0;
+    BenchHistogram histogram(state, __PRETTY_FUNCTION__, { distance });
+    BenchPerfCounters perf_counters(state);
     for (auto _ : state) {
         bool found = false;
         uint64_t iteration_start_index = iteration * buckets_count;
-        ht_bucket_t bucket_search = { 0 };
-        bucket_search.data.filled = true;
-        bucket_search.data.hash_quarter = hash_quarter;
 
+        histogram.Start();
         for(
-                uint64_t chunk_index = iteration_start_index + chunk_start_index;
-                chunk_index <= iteration_start_index + chunk_start_index + HASHTABLE_SEARCH_MAX && !found;
-                chunk_index += 16) {
-            ht_bucket_t* ht_bucket_search_start = &ht_hashes[chunk_index];
-
-            // The mask is used in case of collisions, the while loop below updates the mask to exclude
-            // the colliding value and search the one after
-            skip_indexes_mask = 0;
-
-            while (true) {
-                uint32_t chunk_slot_index = hashtable_linear_search_avx2_16(
-                        bucket_search.hash,
-                        (uint32_t*)ht_bucket_search_start,
-                        skip_indexes_mask);
-
-                if (chunk_slot_index == HASHTABLE_MCMP_SUPPORT_HASH_SEARCH_NOT_FOUND) {
-                    break;
-                }
-
-                benchmark::DoNotOptimize(found = true);
-                break;
+                uint64_t chunk_index = iteration_start_index;
+                chunk_index <= iteration_start_index + HASHTABLE_SEARCH_MAX && !found;
+                chunk_index += chunk_slots) {
+            uint32_t chunk_slot_index;
+
+            if constexpr (chunk_slots == 32) {
+                chunk_slot_index = hashtable_linear_search_avx512bw_32(hash_quarter, &ht_tags[chunk_index], 0);
+                found = chunk_slot_index != HASHTABLE_MCMP_SUPPORT_HASH_SEARCH_NOT_FOUND;
+            } else {
+                chunk_slot_index = hashtable_linear_search_avx512bw_64(hash_quarter, &ht_tags[chunk_index], 0);
+                found = chunk_slot_index != HASHTABLE_MCMP_SUPPORT_HASH_SEARCH_NOT_FOUND_64;
             }
+
+            benchmark::DoNotOptimize(found);
         }
+        histogram.Stop();
 
 #ifdef DEBUG
         if (!found) {
@@ -174,8 +333,167 @@ void BM_Hashtable_Simd_with(benchmark::State& state) {
 
         iteration++;
     }
+    perf_counters.Stop();
 
-    free(ht_hashes);
+    free(ht_tags);
+}
+
+static inline uint64_t BenchHashtableSimdMetadataHash(uint64_t index) {
+    // splitmix64, the metadata has to be derived from well distributed hashes to measure the false positives
+    uint64_t hash = (index + 1) * 0x9E3779B97F4A7C15ull;
+    hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+    hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+
+    return hash ^ (hash >> 31);
+}
+
+static inline void BenchHashtableSimdMetadataSet(ht_bucket_t* bucket, uint64_t hash) {
+    // The padding is part of the value compared
+    bucket->hash = 0;
+    bucket->data.filled = true;
+    bucket->data.hash_quarter = (uint16_t)(hash >> 48);
+}
+
+static inline void BenchHashtableSimdMetadataSet(ht_control_byte_t* control_byte, uint64_t hash) {
+    *control_byte = hashtable_control_byte_from_hash(hash);
+}
+
+static inline void BenchHashtableSimdMetadataSetEmpty(ht_bucket_t* bucket) {
+    bucket->hash = 0;
+}
+
+static inline void BenchHashtableSimdMetadataSetEmpty(ht_control_byte_t* control_byte) {
+    *control_byte = HASHTABLE_CONTROL_BYTE_EMPTY;
+}
+
+static inline uint32_t BenchHashtableSimdMetadataChunkSlots(ht_bucket_t*) {
+    return 16;
+}
+
+static inline uint32_t BenchHashtableSimdMetadataChunkSlots(ht_control_byte_t*) {
+    return HASHTABLE_CONTROL_BYTES_CHUNK_SLOTS;
+}
+
+static inline uint32_t BenchHashtableSimdMetadataChunkSearch(
+        ht_bucket_t* chunk,
+        uint64_t hash,
+        uint32_t skip_indexes_mask) {
+    ht_bucket_t bucket_search = { 0 };
+    BenchHashtableSimdMetadataSet(&bucket_search, hash);
+
+    return hashtable_linear_search_16(bucket_search.hash, (uint32_t*)chunk, skip_indexes_mask);
+}
+
+static inline uint32_t BenchHashtableSimdMetadataChunkSearch(
+        ht_control_byte_t* chunk,
+        uint64_t hash,
+        uint32_t skip_indexes_mask) {
+    return hashtable_control_bytes_search_32(hashtable_control_byte_from_hash(hash), chunk, skip_indexes_mask);
+}
+
+// The chunks are searched in order until the slot holding the hash is found, every match of the metadata is checked
+// against the full hash, the stand-in for the key compare, and counted as a false positive if it's different
+template <typename T>
+static inline bool BenchHashtableSimdMetadataSearch(
+        T* region,
+        uint64_t* region_hashes,
+        uint32_t slots_count,
+        uint64_t hash,
+        uint64_t* chunks_probed,
+        uint64_t* false_positives) {
+    uint32_t chunk_slots = BenchHashtableSimdMetadataChunkSlots(region);
+
+    for(uint32_t chunk_index = 0; chunk_index < slots_count; chunk_index += chunk_slots) {
+        uint32_t chunk_slot_index;
+        uint32_t skip_indexes_mask = 0;
+
+        (*chunks_probed)++;
+
+        while ((chunk_slot_index = BenchHashtableSimdMetadataChunkSearch(
+                &region[chunk_index],
+                hash,
+                skip_indexes_mask)) != HASHTABLE_MCMP_SUPPORT_HASH_SEARCH_NOT_FOUND) {
+            if (region_hashes[chunk_index + chunk_slot_index] == hash) {
+                return true;
+            }
+
+            (*false_positives)++;
+            skip_indexes_mask |= 1u << chunk_slot_index;
+        }
+    }
+
+    return false;
+}
+
+// Compares the 32 bits ht_bucket_t, 16 slots per compare, with the 8 bits control bytes, 32 slots per compare. The
+// regions are filled with the metadata of random hashes, the searched one is at distance slots from the start.
+template <typename T>
+void BM_Hashtable_Simd_Metadata(benchmark::State& state) {
+    uint32_t distance = state.range(0);
+    uint32_t regions_count = BENCH_SIMD_METADATA_REGIONS_COUNT;
+    uint32_t slots_count = benchmark_params.buckets_count;
+    uint64_t chunks_probed = 0;
+    uint64_t false_positives = 0;
+
+    if (!__builtin_cpu_supports("avx2")) {
+        state.SkipWithError("AVX2 not supported");
+        return;
+    }
+
+    // Rounded up to a multiple of the largest chunk, plus one chunk, so both layouts have the same number of slots
+    slots_count = ((slots_count + HASHTABLE_CONTROL_BYTES_CHUNK_SLOTS - 1) & ~(HASHTABLE_CONTROL_BYTES_CHUNK_SLOTS - 1))
+            + HASHTABLE_CONTROL_BYTES_CHUNK_SLOTS;
+
+    auto regions = (T*)aligned_alloc(64, sizeof(T) * slots_count * regions_count);
+    auto regions_hashes = (uint64_t*)malloc(sizeof(uint64_t) * slots_count * regions_count);
+
+    for(uint64_t index = 0; index < (uint64_t)slots_count * regions_count; index++) {
+        regions_hashes[index] = BenchHashtableSimdMetadataHash(index);
+
+        if (index % slots_count < benchmark_params.buckets_count) {
+            BenchHashtableSimdMetadataSet(&regions[index], regions_hashes[index]);
+        } else {
+            BenchHashtableSimdMetadataSetEmpty(&regions[index]);
+        }
+    }
+
+    uint64_t iteration = 0;
+    BenchHistogram histogram(state, __PRETTY_FUNCTION__, { distance });
+    BenchPerfCounters perf_counters(state);
+    for (auto _ : state) {
+        uint64_t region_start_index = (iteration & (regions_count - 1)) * slots_count;
+
+        histogram.Start();
+        bool found = BenchHashtableSimdMetadataSearch<T>(
+                &regions[region_start_index],
+                &regions_hashes[region_start_index],
+                slots_count,
+                regions_hashes[region_start_index + distance],
+                &chunks_probed,
+                &false_positives);
+        benchmark::DoNotOptimize(found);
+        histogram.Stop();
+
+#ifdef DEBUG
+        if (!found) {
+            throw std::runtime_error("Unable to find requested hash, iteration " + std::to_string(iteration));
+        }
+#endif
+
+        iteration++;
+    }
+    perf_counters.Stop();
+
+    state.counters["chunks_probed"] = benchmark::Counter((double)chunks_probed, benchmark::Counter::kAvgIterations);
+    state.counters["bytes_probed"] = benchmark::Counter(
+            (double)(chunks_probed * BenchHashtableSimdMetadataChunkSlots(regions) * sizeof(T)),
+            benchmark::Counter::kAvgIterations);
+    state.counters["false_positives"] = benchmark::Counter(
+            (double)false_positives,
+            benchmark::Counter::kAvgIterations);
+
+    free(regions_hashes);
+    free(regions);
 }
 
 static void BenchArguments(benchmark::internal::Benchmark* b) {
@@ -196,3 +514,35 @@ BENCHMARK_TEMPLATE(BM_Hashtable_Simd_without, ht_bucket_t)
     ->Apply(BenchArguments);
 BENCHMARK_TEMPLATE(BM_Hashtable_Simd_with, ht_bucket_t)
     ->Apply(BenchArguments);
+BENCHMARK_TEMPLATE(BM_Hashtable_Simd_with, ht_bucket_t, hashtable_linear_search_scalar_16)
+    ->Apply(BenchArguments);
+BENCHMARK_TEMPLATE(BM_Hashtable_Simd_with, ht_bucket_t, hashtable_linear_search_sse42_16)
+    ->Apply(BenchArguments);
+BENCHMARK_TEMPLATE(BM_Hashtable_Simd_with, ht_bucket_t, hashtable_linear_search_avx512f_16)
+    ->Apply(BenchArguments);
+BENCHMARK_TEMPLATE(BM_Hashtable_Simd_with, ht_bucket_t, hashtable_linear_search_16)
+    ->Apply(BenchArguments);
+BENCHMARK_TEMPLATE(BM_Hashtable_Simd_with_tags, 32)
+    ->Apply(BenchArguments);
+BENCHMARK_TEMPLATE(BM_Hashtable_Simd_with_tags, 64)
+    ->Apply(BenchArguments);
+BENCHMARK_TEMPLATE(BM_Hashtable_Simd_Metadata, ht_bucket_t)
+    ->Apply(BenchArguments);
+BENCHMARK_TEMPLATE(BM_Hashtable_Simd_Metadata, ht_control_byte_t)
+    ->Apply(BenchArguments);
+
+static void BenchArgumentsCache(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"distance", "cache"});
+    for(int64_t cache_mode : { BENCH_CACHE_MODE_COLD, BENCH_CACHE_MODE_WARM }) {
+        for(int64_t distance : { 1, 5, 10, 25, 50, 100, 200, 300, 400, 500 }) {
+            b->Args({distance, cache_mode});
+        }
+    }
+    b->Iterations(1000000);
+    b->UseManualTime();
+}
+
+BENCHMARK_TEMPLATE(BM_Hashtable_Simd_without_Cache, ht_bucket_t)
+    ->Apply(BenchArgumentsCache);
+BENCHMARK_TEMPLATE(BM_Hashtable_Simd_with_Cache, ht_bucket_t)
+    ->Apply(BenchArgumentsCache);
@@ -0,0 +1,206 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <benchmark/benchmark.h>
+
+#include "libhashtable/hashtable.h"
+#include "libhashtable/hashtable_snapshot.h"
+
+#include "bench-support-cache.h"
+#include "bench-support-perf.h"
+
+#define BENCH_SNAPSHOT_KEY_MAX_LENGTH 24
+#define BENCH_SNAPSHOT_PATH "/tmp/performance-summit-202109-benchmarks-snapshot.bin"
+
+typedef struct benchmark_params benchmark_params_t;
+struct benchmark_params {
+    uint64_t buckets_count;
+    uint32_t load_factor;
+};
+static benchmark_params_t benchmark_params = {
+        .buckets_count = 1 << 21,
+        .load_factor = 75,
+};
+
+typedef struct bench_snapshot_keys bench_snapshot_keys_t;
+struct bench_snapshot_keys {
+    uint64_t count;
+    char* keys;
+    uint32_t* keys_length;
+};
+
+static inline const char* BenchSnapshotKey(bench_snapshot_keys_t* keys, uint64_t index) {
+    return keys->keys + index * BENCH_SNAPSHOT_KEY_MAX_LENGTH;
+}
+
+static bench_snapshot_keys_t* BenchSnapshotKeysNew() {
+    auto keys = (bench_snapshot_keys_t*)malloc(sizeof(bench_snapshot_keys_t));
+    keys->count = benchmark_params.buckets_count * benchmark_params.load_factor / 100;
+    keys->keys = (char*)malloc(keys->count * BENCH_SNAPSHOT_KEY_MAX_LENGTH);
+    keys->keys_length = (uint32_t*)malloc(keys->count * sizeof(uint32_t));
+
+    for(uint64_t index = 0; index < keys->count; index++) {
+        keys->keys_length[index] = snprintf(
+                keys->keys + index * BENCH_SNAPSHOT_KEY_MAX_LENGTH,
+                BENCH_SNAPSHOT_KEY_MAX_LENGTH,
+                "key:%lu",
+                index);
+    }
+
+    return keys;
+}
+
+static void BenchSnapshotKeysFree(bench_snapshot_keys_t* keys) {
+    free(keys->keys);
+    free(keys->keys_length);
+    free(keys);
+}
+
+static hashtable_t* BenchSnapshotFill(benchmark::State& state, bench_snapshot_keys_t* keys) {
+    hashtable_t* hashtable = hashtable_new(benchmark_params.buckets_count);
+
+    for(uint64_t index = 0; index < keys->count; index++) {
+        if (!hashtable_insert(hashtable, BenchSnapshotKey(keys, index), keys->keys_length[index], index)) {
+            state.SkipWithError("Unable to insert the key, the hashtable is full");
+            break;
+        }
+    }
+
+    return hashtable;
+}
+
+// Evicts the snapshot from the page cache, the restart reads it from the disk as after a reboot. Only the clean pages
+// are evicted, the snapshot has to be written with sync.
+static void BenchSnapshotEvict() {
+    int fd = open(BENCH_SNAPSHOT_PATH, O_RDONLY);
+
+    if (fd >= 0) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+void BM_Hashtable_Snapshot_Write(benchmark::State& state) {
+    bool sync = state.range(0) == 1;
+    uint64_t file_size = 0;
+    bench_snapshot_keys_t* keys = BenchSnapshotKeysNew();
+    hashtable_t* hashtable = BenchSnapshotFill(state, keys);
+
+    state.SetLabel(sync ? "sync" : "no-sync");
+
+    BenchPerfCounters perf_counters(state);
+    for (auto _ : state) {
+        if (!hashtable_snapshot_write(hashtable, BENCH_SNAPSHOT_PATH, sync)) {
+            state.SkipWithError("Unable to write the snapshot");
+            break;
+        }
+
+        state.PauseTiming();
+        hashtable_snapshot_t* snapshot = hashtable_snapshot_open(BENCH_SNAPSHOT_PATH, false);
+        file_size = snapshot ? snapshot->header->file_size : 0;
+        if (snapshot) {
+            hashtable_snapshot_close(snapshot);
+        }
+        state.ResumeTiming();
+    }
+    perf_counters.Stop();
+
+    state.SetBytesProcessed((int64_t)(state.iterations() * file_size));
+    state.counters["file_size"] = (double)file_size;
+
+    unlink(BENCH_SNAPSHOT_PATH);
+    hashtable_free(hashtable);
+    BenchSnapshotKeysFree(keys);
+}
+
+// Time from the restart to the first lookup served, opening the snapshot (with or without checking the checksum of the
+// whole file) with the snapshot in the page cache (warm) or read from the disk (cold)
+void BM_Hashtable_Snapshot_Restore(benchmark::State& state) {
+    bool verify_checksum = state.range(0) == 1;
+    int64_t cache_mode = state.range(1);
+    uint64_t random_state = 0x9E3779B97F4A7C15ull;
+    bench_snapshot_keys_t* keys = BenchSnapshotKeysNew();
+    hashtable_t* hashtable = BenchSnapshotFill(state, keys);
+
+    state.SetLabel(std::string(BenchCacheModeName(cache_mode)) + (verify_checksum ? ",checksum" : ""));
+
+    if (!hashtable_snapshot_write(hashtable, BENCH_SNAPSHOT_PATH, true)) {
+        state.SkipWithError("Unable to write the snapshot");
+    }
+    hashtable_free(hashtable);
+
+    BenchPerfCounters perf_counters(state);
+    for (auto _ : state) {
+        uintptr_t value;
+
+        state.PauseTiming();
+        if (cache_mode == BENCH_CACHE_MODE_COLD) {
+            BenchSnapshotEvict();
+        }
+        random_state = random_state * 6364136223846793005ull + 1442695040888963407ull;
+        uint64_t index = (random_state >> 16) % keys->count;
+        state.ResumeTiming();
+
+        hashtable_snapshot_t* snapshot = hashtable_snapshot_open(BENCH_SNAPSHOT_PATH, verify_checksum);
+        bool found = snapshot && hashtable_snapshot_lookup(
+                snapshot,
+                BenchSnapshotKey(keys, index),
+                keys->keys_length[index],
+                &value);
+
+        state.PauseTiming();
+        if (snapshot) {
+            hashtable_snapshot_close(snapshot);
+        }
+        if (!found || value != index) {
+            state.SkipWithError("Unable to open the snapshot or to find the key");
+            break;
+        }
+        state.ResumeTiming();
+    }
+    perf_counters.Stop();
+
+    unlink(BENCH_SNAPSHOT_PATH);
+    BenchSnapshotKeysFree(keys);
+}
+
+// The restart without a snapshot, all the keys are inserted again before the first lookup can be served
+void BM_Hashtable_Snapshot_Reinsert(benchmark::State& state) {
+    bench_snapshot_keys_t* keys = BenchSnapshotKeysNew();
+
+    BenchPerfCounters perf_counters(state);
+    for (auto _ : state) {
+        uintptr_t value;
+        hashtable_t* hashtable = BenchSnapshotFill(state, keys);
+
+        benchmark::DoNotOptimize(hashtable_lookup(hashtable, BenchSnapshotKey(keys, 0), keys->keys_length[0], &value));
+
+        state.PauseTiming();
+        hashtable_free(hashtable);
+        state.ResumeTiming();
+    }
+    perf_counters.Stop();
+
+    BenchSnapshotKeysFree(keys);
+}
+
+BENCHMARK(BM_Hashtable_Snapshot_Write)
+    ->ArgNames({"sync"})
+    ->Arg(0)
+    ->Arg(1)
+    ->Iterations(5)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Hashtable_Snapshot_Restore)
+    ->ArgNames({"checksum", "cache"})
+    ->Args({0, BENCH_CACHE_MODE_COLD})
+    ->Args({0, BENCH_CACHE_MODE_WARM})
+    ->Args({1, BENCH_CACHE_MODE_COLD})
+    ->Args({1, BENCH_CACHE_MODE_WARM})
+    ->Iterations(20)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_Hashtable_Snapshot_Reinsert)
+    ->Iterations(5)
+    ->Unit(benchmark::kMillisecond);
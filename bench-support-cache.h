@@ -0,0 +1,97 @@
+#ifndef BENCH_SUPPORT_CACHE_H
+#define BENCH_SUPPORT_CACHE_H
+
+#include <stdint.h>
+#include <time.h>
+#include <immintrin.h>
+#include <benchmark/benchmark.h>
+
+// Cold and warm cache modes for the benchmarks working on a small working set reused at every iteration, instead of a
+// new region of memory per iteration. In cold mode the working set is evicted from all the cache levels with
+// clflushopt before each iteration, in warm mode it's left in the cache.
+//
+// The eviction must not be measured, the benchmarks using these helpers have to be registered with UseManualTime, the
+// time of each iteration is measured around the code under test and the calibrated overhead of reading the clock is
+// subtracted. PauseTiming / ResumeTiming would add more overhead than a single warm search takes.
+
+#define BENCH_CACHE_MODE_COLD 0
+#define BENCH_CACHE_MODE_WARM 1
+
+static inline const char* BenchCacheModeName(int64_t mode) {
+    return mode == BENCH_CACHE_MODE_COLD ? "cold" : "warm";
+}
+
+__attribute__((__target__("clflushopt")))
+static inline void BenchCacheFlushClflushopt(const void* start, size_t size) {
+    for(uintptr_t line = (uintptr_t)start & ~63ul; line < (uintptr_t)start + size; line += 64) {
+        _mm_clflushopt((void*)line);
+    }
+}
+
+static inline void BenchCacheFlushClflush(const void* start, size_t size) {
+    for(uintptr_t line = (uintptr_t)start & ~63ul; line < (uintptr_t)start + size; line += 64) {
+        _mm_clflush((void*)line);
+    }
+}
+
+static inline void BenchCacheFlush(const void* start, size_t size) {
+    static bool clflushopt_supported = __builtin_cpu_supports("clflushopt");
+
+    if (clflushopt_supported) {
+        BenchCacheFlushClflushopt(start, size);
+    } else {
+        BenchCacheFlushClflush(start, size);
+    }
+
+    // clflushopt is weakly ordered, the fence waits for the evictions to complete before the measured code starts
+    _mm_mfence();
+}
+
+static inline uint64_t BenchCacheNowNs() {
+    struct timespec ts = { 0 };
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// The minimum of many back to back reads, to not subtract more than the real overhead
+static inline uint64_t BenchCacheClockOverheadNs() {
+    static uint64_t overhead_ns = UINT64_MAX;
+
+    if (overhead_ns == UINT64_MAX) {
+        for(int sample = 0; sample < 10000; sample++) {
+            uint64_t start = BenchCacheNowNs();
+            uint64_t end = BenchCacheNowNs();
+
+            if (end - start < overhead_ns) {
+                overhead_ns = end - start;
+            }
+        }
+    }
+
+    return overhead_ns;
+}
+
+// Runs a single iteration of the benchmark loop, evicting the working set first if mode is BENCH_CACHE_MODE_COLD
+template <typename F>
+static inline void BenchCacheIteration(
+        benchmark::State& state,
+        int64_t mode,
+        const void* working_set,
+        size_t working_set_size,
+        F code_under_test) {
+    static uint64_t overhead_ns = BenchCacheClockOverheadNs();
+
+    if (mode == BENCH_CACHE_MODE_COLD) {
+        BenchCacheFlush(working_set, working_set_size);
+    }
+
+    uint64_t start = BenchCacheNowNs();
+    code_under_test();
+    uint64_t end = BenchCacheNowNs();
+
+    uint64_t elapsed_ns = end - start > overhead_ns ? end - start - overhead_ns : 0;
+    state.SetIterationTime((double)elapsed_ns / 1e9);
+}
+
+#endif //BENCH_SUPPORT_CACHE_H
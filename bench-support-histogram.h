@@ -0,0 +1,253 @@
+#ifndef BENCH_SUPPORT_HISTOGRAM_H
+#define BENCH_SUPPORT_HISTOGRAM_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string>
+#include <initializer_list>
+#include <x86intrin.h>
+#include <benchmark/benchmark.h>
+
+// Latency histogram of the single iterations of a benchmark, measured with rdtsc and recorded in HDR style buckets:
+// the values below BENCH_HISTOGRAM_SUB_BUCKETS cycles have a bucket each, every power of two above is split in
+// BENCH_HISTOGRAM_SUB_BUCKETS / 2 buckets, the error is below 1 / (BENCH_HISTOGRAM_SUB_BUCKETS / 2) of the value.
+//
+// Enabled with the --latency_histograms command line flag, the p50, p90, p99, p99.9 and max latencies are reported in
+// state.counters, --latency_histograms_dump=<path> writes the full distribution as csv too. When not enabled Start and
+// Stop are a branch on a global flag, the results of the benchmarks are not affected.
+//
+// The cycles are converted to nanoseconds using the TSC frequency measured at startup, the TSC has to be invariant. The
+// cost of an empty Start and Stop is measured at startup too and subtracted from every sample, it isn't from the time
+// reported by google benchmark, the averages have to be taken from a run without the histograms.
+
+#define BENCH_HISTOGRAM_SUB_BUCKET_BITS 7
+#define BENCH_HISTOGRAM_SUB_BUCKETS (1u << BENCH_HISTOGRAM_SUB_BUCKET_BITS)
+#define BENCH_HISTOGRAM_BUCKETS \
+    (BENCH_HISTOGRAM_SUB_BUCKETS + (64 - BENCH_HISTOGRAM_SUB_BUCKET_BITS) * (BENCH_HISTOGRAM_SUB_BUCKETS / 2))
+
+inline bool bench_histogram_enabled = false;
+inline FILE* bench_histogram_dump_file = nullptr;
+inline uint64_t bench_histogram_overhead_cycles = 0;
+
+static inline uint64_t BenchHistogramCyclesStart() {
+    _mm_lfence();
+    return __rdtsc();
+}
+
+static inline uint64_t BenchHistogramCyclesStop() {
+    uint32_t aux;
+    uint64_t cycles = __rdtscp(&aux);
+    _mm_lfence();
+
+    return cycles;
+}
+
+// The minimum of many empty Start and Stop, to not subtract more than the real overhead
+static inline uint64_t BenchHistogramOverheadCycles() {
+    uint64_t overhead_cycles = UINT64_MAX;
+
+    for(uint32_t index = 0; index < 10000; index++) {
+        uint64_t start = BenchHistogramCyclesStart();
+        uint64_t end = BenchHistogramCyclesStop();
+        overhead_cycles = end - start < overhead_cycles ? end - start : overhead_cycles;
+    }
+
+    return overhead_cycles;
+}
+
+static inline uint64_t BenchHistogramNowNs() {
+    struct timespec ts = { 0 };
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static inline double BenchHistogramTscNsPerCycle() {
+    static double ns_per_cycle = 0;
+
+    if (ns_per_cycle == 0) {
+        uint64_t start_ns = BenchHistogramNowNs();
+        uint64_t start_cycles = __rdtsc();
+
+        while (BenchHistogramNowNs() - start_ns < 20000000ull) {
+            _mm_pause();
+        }
+
+        ns_per_cycle = (double)(BenchHistogramNowNs() - start_ns) / (double)(__rdtsc() - start_cycles);
+    }
+
+    return ns_per_cycle;
+}
+
+// Called once from main, a dump_path not empty enables the dump of the distributions
+static inline std::string BenchHistogramEnable(const std::string& dump_path) {
+    bench_histogram_enabled = true;
+    bench_histogram_overhead_cycles = BenchHistogramOverheadCycles();
+
+    if (!dump_path.empty()) {
+        bench_histogram_dump_file = fopen(dump_path.c_str(), "w");
+
+        if (bench_histogram_dump_file == nullptr) {
+            perror("fopen latency histograms dump");
+            exit(-1);
+        }
+
+        fprintf(bench_histogram_dump_file, "benchmark,value_ns,count\n");
+    }
+
+    return std::to_string(1.0 / BenchHistogramTscNsPerCycle()) + " TSC cycles/ns, " +
+            std::to_string(bench_histogram_overhead_cycles) + " cycles of overhead subtracted";
+}
+
+static inline uint32_t BenchHistogramBucketIndex(uint64_t value) {
+    if (value < BENCH_HISTOGRAM_SUB_BUCKETS) {
+        return (uint32_t)value;
+    }
+
+    uint32_t msb = 63 - __builtin_clzll(value);
+    uint32_t shift = msb - (BENCH_HISTOGRAM_SUB_BUCKET_BITS - 1);
+
+    return BENCH_HISTOGRAM_SUB_BUCKETS +
+           (msb - BENCH_HISTOGRAM_SUB_BUCKET_BITS) * (BENCH_HISTOGRAM_SUB_BUCKETS / 2) +
+           (uint32_t)((value >> shift) - (BENCH_HISTOGRAM_SUB_BUCKETS / 2));
+}
+
+// Highest value falling in the bucket, the percentiles are never underestimated
+static inline uint64_t BenchHistogramBucketValue(uint32_t index) {
+    if (index < BENCH_HISTOGRAM_SUB_BUCKETS) {
+        return index;
+    }
+
+    uint32_t group = (index - BENCH_HISTOGRAM_SUB_BUCKETS) / (BENCH_HISTOGRAM_SUB_BUCKETS / 2);
+    uint64_t sub_bucket =
+            (index - BENCH_HISTOGRAM_SUB_BUCKETS) % (BENCH_HISTOGRAM_SUB_BUCKETS / 2) + BENCH_HISTOGRAM_SUB_BUCKETS / 2;
+    uint32_t shift = group + 1;
+
+    return ((sub_bucket + 1) << shift) - 1;
+}
+
+// The benchmarks are identified in the dump by the name google benchmark reports, State::name is available from 1.8,
+// with the older versions name and args are joined instead
+template<typename State>
+static inline std::string BenchHistogramBenchmarkName(
+        State& state,
+        const char* name,
+        std::initializer_list<int64_t> args) {
+    if constexpr (requires { state.name(); }) {
+        return state.name();
+    } else {
+        std::string benchmark_name(name);
+
+        for(int64_t arg : args) {
+            benchmark_name += '/';
+            benchmark_name += std::to_string(arg);
+        }
+
+        return benchmark_name;
+    }
+}
+
+// Declared before the loop of the benchmark, Start and Stop are called around the code measured in each iteration.
+// name and args, e.g. __PRETTY_FUNCTION__ and the arguments of the benchmark, are used only if State::name isn't
+// available.
+class BenchHistogram {
+public:
+    BenchHistogram(benchmark::State& state, const char* name, std::initializer_list<int64_t> args = {})
+            : state(state), name(BenchHistogramBenchmarkName(state, name, args)) {
+        if (bench_histogram_enabled) {
+            counts = (uint64_t*)calloc(BENCH_HISTOGRAM_BUCKETS, sizeof(uint64_t));
+        }
+    }
+
+    ~BenchHistogram() {
+        if (counts == nullptr) {
+            return;
+        }
+
+        if (total > 0) {
+            Report();
+        }
+
+        free(counts);
+    }
+
+    BenchHistogram(const BenchHistogram&) = delete;
+    BenchHistogram& operator=(const BenchHistogram&) = delete;
+
+    inline void Start() {
+        if (counts) {
+            start_cycles = BenchHistogramCyclesStart();
+        }
+    }
+
+    inline void Stop() {
+        if (counts) {
+            uint64_t cycles = BenchHistogramCyclesStop() - start_cycles;
+            cycles = cycles > bench_histogram_overhead_cycles ? cycles - bench_histogram_overhead_cycles : 0;
+
+            counts[BenchHistogramBucketIndex(cycles)]++;
+            max_cycles = cycles > max_cycles ? cycles : max_cycles;
+            total++;
+        }
+    }
+
+private:
+    uint64_t Percentile(double percentile) {
+        uint64_t target = (uint64_t)((double)total * percentile / 100.0);
+        uint64_t seen = 0;
+
+        for(uint32_t index = 0; index < BENCH_HISTOGRAM_BUCKETS; index++) {
+            seen += counts[index];
+            if (seen > target) {
+                uint64_t value = BenchHistogramBucketValue(index);
+                return value < max_cycles ? value : max_cycles;
+            }
+        }
+
+        return max_cycles;
+    }
+
+    void Report() {
+        double ns_per_cycle = BenchHistogramTscNsPerCycle();
+
+        // Averaged over the threads, summing the percentiles of the threads wouldn't make sense
+        state.counters["p50_ns"] = benchmark::Counter(
+                (double)Percentile(50) * ns_per_cycle, benchmark::Counter::kAvgThreads);
+        state.counters["p90_ns"] = benchmark::Counter(
+                (double)Percentile(90) * ns_per_cycle, benchmark::Counter::kAvgThreads);
+        state.counters["p99_ns"] = benchmark::Counter(
+                (double)Percentile(99) * ns_per_cycle, benchmark::Counter::kAvgThreads);
+        state.counters["p999_ns"] = benchmark::Counter(
+                (double)Percentile(99.9) * ns_per_cycle, benchmark::Counter::kAvgThreads);
+        state.counters["max_ns"] = benchmark::Counter(
+                (double)max_cycles * ns_per_cycle, benchmark::Counter::kAvgThreads);
+
+        if (bench_histogram_dump_file == nullptr) {
+            return;
+        }
+
+        // One block per run of the benchmark, the name is quoted as it may contain commas
+        for(uint32_t index = 0; index < BENCH_HISTOGRAM_BUCKETS; index++) {
+            if (counts[index] > 0) {
+                fprintf(
+                        bench_histogram_dump_file,
+                        "\"%s\",%.1f,%lu\n",
+                        name.c_str(),
+                        (double)BenchHistogramBucketValue(index) * ns_per_cycle,
+                        counts[index]);
+            }
+        }
+        fflush(bench_histogram_dump_file);
+    }
+
+    benchmark::State& state;
+    std::string name;
+    uint64_t* counts = nullptr;
+    uint64_t start_cycles = 0;
+    uint64_t max_cycles = 0;
+    uint64_t total = 0;
+};
+
+#endif //BENCH_SUPPORT_HISTOGRAM_H
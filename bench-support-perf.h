@@ -0,0 +1,167 @@
+#ifndef BENCH_SUPPORT_PERF_H
+#define BENCH_SUPPORT_PERF_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <string>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include <benchmark/benchmark.h>
+
+// Hardware and software counters read via perf_event_open around the loop of a benchmark, enabled with the
+// --perf_counters command line flag, and reported per iteration in state.counters.
+//
+// The counters follow the thread running the benchmark and the threads it creates while they are enabled, the code
+// run while the timing is paused is counted as well. The counters the kernel refuses to open (no PMU in a VM,
+// perf_event_paranoid, missing events) are not reported, if the kernel can't be measured only the user space is.
+
+#define BENCH_PERF_COUNTERS_COUNT 7
+
+typedef struct bench_perf_counter_definition bench_perf_counter_definition_t;
+struct bench_perf_counter_definition {
+    const char* name;
+    uint32_t type;
+    uint64_t config;
+};
+
+#define BENCH_PERF_HW_CACHE_READ_MISS(cache) \
+    ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+static const bench_perf_counter_definition_t bench_perf_counters_definitions[BENCH_PERF_COUNTERS_COUNT] = {
+        { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+        { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        { "l1d_misses", PERF_TYPE_HW_CACHE, BENCH_PERF_HW_CACHE_READ_MISS(PERF_COUNT_HW_CACHE_L1D) },
+        { "llc_misses", PERF_TYPE_HW_CACHE, BENCH_PERF_HW_CACHE_READ_MISS(PERF_COUNT_HW_CACHE_LL) },
+        { "dtlb_misses", PERF_TYPE_HW_CACHE, BENCH_PERF_HW_CACHE_READ_MISS(PERF_COUNT_HW_CACHE_DTLB) },
+        { "branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+        { "context_switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+};
+
+inline bool bench_perf_counters_enabled = false;
+inline bool bench_perf_counters_exclude_kernel = false;
+inline bool bench_perf_counters_available[BENCH_PERF_COUNTERS_COUNT] = { false };
+
+static inline int BenchPerfCounterOpen(const bench_perf_counter_definition_t* definition, bool exclude_kernel) {
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = definition->type;
+    attr.config = definition->config;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = exclude_kernel ? 1 : 0;
+    attr.exclude_hv = 1;
+    // The counters are not grouped, if the PMU has to multiplex them the values are scaled by the time they ran
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+}
+
+// Called once from main when the flag is passed, checks which counters can be opened and returns the description
+// added to the context
+static inline std::string BenchPerfCountersEnable() {
+    std::string available_names;
+
+    // The kernel is measured too if perf_event_paranoid allows it
+    for(bool exclude_kernel : { false, true }) {
+        int fd = BenchPerfCounterOpen(&bench_perf_counters_definitions[0], exclude_kernel);
+        if (fd >= 0) {
+            close(fd);
+            bench_perf_counters_exclude_kernel = exclude_kernel;
+            break;
+        } else if (errno != EACCES && errno != EPERM) {
+            break;
+        }
+    }
+
+    for(uint32_t index = 0; index < BENCH_PERF_COUNTERS_COUNT; index++) {
+        int fd = BenchPerfCounterOpen(&bench_perf_counters_definitions[index], bench_perf_counters_exclude_kernel);
+
+        if (fd < 0) {
+            fprintf(
+                    stderr,
+                    "perf counter %s not available: %s\n",
+                    bench_perf_counters_definitions[index].name,
+                    strerror(errno));
+            continue;
+        }
+
+        close(fd);
+        bench_perf_counters_available[index] = true;
+        bench_perf_counters_enabled = true;
+        available_names += std::string(available_names.empty() ? "" : ",") +
+                bench_perf_counters_definitions[index].name;
+    }
+
+    if (!bench_perf_counters_enabled) {
+        fprintf(stderr, "perf counters not available, check /proc/sys/kernel/perf_event_paranoid\n");
+        return "unavailable";
+    }
+
+    return available_names + (bench_perf_counters_exclude_kernel ? " (user)" : " (user+kernel)");
+}
+
+// Enables the counters when constructed and reports them in state.counters when stopped, has to be declared right
+// before the loop of the benchmark and stopped right after it
+class BenchPerfCounters {
+public:
+    explicit BenchPerfCounters(benchmark::State& state) : state(state) {
+        for(uint32_t index = 0; index < BENCH_PERF_COUNTERS_COUNT; index++) {
+            fds[index] = bench_perf_counters_available[index]
+                    ? BenchPerfCounterOpen(&bench_perf_counters_definitions[index], bench_perf_counters_exclude_kernel)
+                    : -1;
+        }
+
+        for(int fd : fds) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+    }
+
+    ~BenchPerfCounters() {
+        Stop();
+    }
+
+    BenchPerfCounters(const BenchPerfCounters&) = delete;
+    BenchPerfCounters& operator=(const BenchPerfCounters&) = delete;
+
+    // Called right after the loop, the teardown of the benchmark (e.g. freeing the memory) isn't counted. Calling it
+    // more than once, or not at all and leaving it to the destructor, is allowed
+    void Stop() {
+        for(int fd : fds) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            }
+        }
+
+        for(uint32_t index = 0; index < BENCH_PERF_COUNTERS_COUNT; index++) {
+            // value, time enabled, time running
+            uint64_t values[3] = { 0 };
+
+            if (fds[index] < 0) {
+                continue;
+            }
+
+            if (read(fds[index], values, sizeof(values)) == sizeof(values) && values[2] > 0) {
+                state.counters[bench_perf_counters_definitions[index].name] = benchmark::Counter(
+                        (double)values[0] * ((double)values[1] / (double)values[2]),
+                        benchmark::Counter::kAvgIterations);
+            }
+
+            close(fds[index]);
+            fds[index] = -1;
+        }
+    }
+
+private:
+    benchmark::State& state;
+    int fds[BENCH_PERF_COUNTERS_COUNT];
+};
+
+#endif //BENCH_SUPPORT_PERF_H
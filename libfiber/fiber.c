@@ -37,6 +37,26 @@ void* xalloc_alloc_aligned_zero(
     return memptr;
 }
 
+void* xalloc_mmap_alloc(
+        size_t size) {
+    void* memptr;
+
+    // MAP_NORESERVE avoids to account the whole stack upfront, the pages are committed on the first page fault
+    memptr = mmap(
+            NULL,
+            size,
+            PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK,
+            -1,
+            0);
+
+    if (memptr == MAP_FAILED) {
+        fprintf(stderr, "Unable to map the requested memory %lu", size);
+        exit(-1);
+    }
+
+    return memptr;
+}
 
 void fiber_stack_protection(
         fiber_t *fiber,
@@ -55,14 +75,49 @@ void fiber_stack_protection(
     }
 }
 
+void fiber_prepare(
+        fiber_t *fiber,
+        fiber_start_fp_t *fiber_start_fp,
+        void *user_data) {
+    fiber->start_fp = fiber_start_fp;
+    fiber->start_fp_user_data = user_data;
+    memset(&fiber->context, 0, sizeof(fiber->context));
+    memset(&fiber->scheduler, 0, sizeof(fiber->scheduler));
+#if FIBER_STATS_ENABLED == 1
+    memset(&fiber->stats, 0, sizeof(fiber->stats));
+#endif
+
+    // Set the initial fp and rsp of the fiber
+    fiber->context.rip = fiber->start_fp; // this or the stack_base? who knows :|
+    fiber->context.rsp = fiber->stack_pointer;
+
+    // Default floating point environment as set by the ABI at process startup
+    fiber->context.mxcsr = 0x1F80;
+    fiber->context.x87_cw = 0x037F;
+}
+
 fiber_t *fiber_new(
         size_t stack_size,
         fiber_start_fp_t *fiber_start_fp,
         void *user_data) {
+    return fiber_new_with_stack_type(stack_size, FIBER_STACK_TYPE_ALIGNED_ALLOC, fiber_start_fp, user_data);
+}
+
+fiber_t *fiber_new_with_stack_type(
+        size_t stack_size,
+        fiber_stack_type_t stack_type,
+        fiber_start_fp_t *fiber_start_fp,
+        void *user_data) {
+    void *stack_base;
     size_t page_size = getpagesize();
     fiber_t *fiber = malloc(sizeof(fiber_t));
     memset(fiber, 0, sizeof(fiber_t));
-    void *stack_base = xalloc_alloc_aligned_zero(page_size, stack_size);
+
+    if (stack_type == FIBER_STACK_TYPE_MMAP) {
+        stack_base = xalloc_mmap_alloc(stack_size);
+    } else {
+        stack_base = xalloc_alloc_aligned_zero(page_size, stack_size);
+    }
 
     // Align the stack_pointer to 16 bytes and leave the 128 bytes red zone free as per ABI requirements
     void* stack_pointer = (void*)((uintptr_t)(stack_base + stack_size) & -16L) - 128;
@@ -70,25 +125,66 @@ fiber_t *fiber_new(
     // Need room on the stack as we push/pop a return address to jump to our function
     stack_pointer -= sizeof(void*) * 1;
 
-    fiber->start_fp = fiber_start_fp;
-    fiber->start_fp_user_data = user_data;
     fiber->stack_size = stack_size;
+    fiber->stack_type = stack_type;
     fiber->stack_base = stack_base;
     fiber->stack_pointer = stack_pointer;
 
-    // Set the initial fp and rsp of the fiber
-    fiber->context.rip = fiber->start_fp; // this or the stack_base? who knows :|
-    fiber->context.rsp = fiber->stack_pointer;
+    fiber_prepare(fiber, fiber_start_fp, user_data);
 
     fiber_stack_protection(fiber, true);
 
     return fiber;
 }
 
+size_t fiber_stack_get_high_water_mark(
+        fiber_t *fiber) {
+    size_t page_size = getpagesize();
+    void *stack_usable_base = fiber->stack_base + page_size;
+    size_t stack_usable_size = fiber->stack_size - page_size;
+
+    if (fiber->stack_type == FIBER_STACK_TYPE_MMAP) {
+        size_t pages_count = stack_usable_size / page_size;
+        unsigned char *pages_residency = malloc(pages_count);
+        size_t page_index;
+
+        if (mincore(stack_usable_base, stack_usable_size, pages_residency) != 0) {
+            free(pages_residency);
+            return 0;
+        }
+
+        // The stack grows downwards so the lowest committed page is the deepest point reached
+        for(page_index = 0; page_index < pages_count && (pages_residency[page_index] & 1) == 0; page_index++) {
+            // do nothing
+        }
+
+        free(pages_residency);
+
+        return (pages_count - page_index) * page_size;
+    }
+
+    // The stack has been zeroed when allocated, the lowest non zero word is the deepest point reached
+    uint64_t *stack_word = stack_usable_base;
+    uint64_t *stack_word_end = stack_usable_base + stack_usable_size;
+    while (stack_word < stack_word_end && *stack_word == 0) {
+        stack_word++;
+    }
+
+    return (void*)stack_word_end - (void*)stack_word;
+}
+
 void fiber_free(
         fiber_t *fiber) {
-    fiber_stack_protection(fiber, false);
+    if (fiber->stack_type == FIBER_STACK_TYPE_MMAP) {
+        // The guard page is unmapped together with the rest of the stack
+        if (munmap(fiber->stack_base, fiber->stack_size) != 0) {
+            fprintf(stderr, "Unable to unmap the fiber stack");
+            exit(-1);
+        }
+    } else {
+        fiber_stack_protection(fiber, false);
+        free(fiber->stack_base);
+    }
 
-    free(fiber->stack_base);
     free(fiber);
 }
\ No newline at end of file
@@ -1,23 +1,67 @@
 #ifndef FIBER_H
 #define FIBER_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 typedef struct fiber fiber_t;
 typedef void (fiber_start_fp_t)(fiber_t* fiber_from, fiber_t* fiber_to);
+typedef void (fiber_scheduler_entrypoint_fp_t)(void* user_data);
+
+enum fiber_stack_type {
+    // Allocated with aligned_alloc and zeroed upfront, the whole stack is committed straight away
+    FIBER_STACK_TYPE_ALIGNED_ALLOC = 0,
+    // Address space reserved with mmap, the kernel commits the pages only when they are touched
+    FIBER_STACK_TYPE_MMAP,
+};
+typedef enum fiber_stack_type fiber_stack_type_t;
+
+#if FIBER_STATS_ENABLED == 1
+// Updated at the swap points by the hooks in fiber_stats.h, the cycles are measured with rdtsc
+typedef struct fiber_stats fiber_stats_t;
+struct fiber_stats {
+    uint64_t swaps_in;
+    uint64_t swaps_out;
+    uint64_t cycles_on_cpu;
+    uint64_t cycles_longest_run;
+    uint64_t swap_in_tsc;
+    // Filled only by fiber_stats_get
+    size_t stack_used;
+};
+#endif
 
 struct fiber {
     struct {
         void *rip, *rsp;
         void *rbx, *rbp, *r12, *r13, *r14, *r15;
+        // Saved only by fiber_context_swap_inline_fpu, see fiber_context_inline.h
+        uint32_t mxcsr;
+        uint16_t x87_cw;
     } context;
     void* stack_pointer;
     void* stack_base;
     size_t stack_size;
+    fiber_stack_type_t stack_type;
     fiber_start_fp_t* start_fp;
     void* start_fp_user_data;
+
+    // Used only when the fiber is managed by the scheduler, the fibers switched by hand leave these untouched
+    struct {
+        fiber_t* next;
+        fiber_scheduler_entrypoint_fp_t* entrypoint_fp;
+        // The worker the fiber has run on last, a parked fiber is always resumed by it
+        struct fiber_scheduler_worker* worker;
+        uint32_t state;
+    } scheduler;
+
+#if FIBER_STATS_ENABLED == 1
+    fiber_stats_t stats;
+#endif
 };
 
 extern void fiber_context_get(
@@ -34,11 +78,28 @@ void fiber_stack_protection(
         fiber_t* fiber,
         bool enable);
 
+// Resets the context of an already allocated fiber so it starts again from fiber_start_fp, the stack is reused as is
+void fiber_prepare(
+        fiber_t* fiber,
+        fiber_start_fp_t* fiber_start_fp,
+        void* user_data);
+
 fiber_t* fiber_new(
         size_t stack_size,
         fiber_start_fp_t* fiber_start_fp,
         void* user_data);
 
+fiber_t* fiber_new_with_stack_type(
+        size_t stack_size,
+        fiber_stack_type_t stack_type,
+        fiber_start_fp_t* fiber_start_fp,
+        void* user_data);
+
+// Returns the deepest amount of stack used by the fiber since it has been allocated, for the mmap stacks the value is
+// rounded to the page size as it's calculated from the pages committed by the kernel
+size_t fiber_stack_get_high_water_mark(
+        fiber_t* fiber);
+
 void fiber_free(
         fiber_t* fiber);
 
@@ -0,0 +1,131 @@
+#ifndef FIBER_CONTEXT_INLINE_H
+#define FIBER_CONTEXT_INLINE_H
+
+#include <stddef.h>
+
+#include "fiber.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Inline alternatives to fiber_context_swap, the code is emitted at the call site and the compiler can keep in
+// registers whatever isn't listed as clobbered. All the variants start a new fiber in the same way as
+// fiber_context_swap, jumping to fiber_start_fp with the from/to fibers in rdi/rsi.
+//
+// - fiber_context_swap_inline_minimal saves only rip, rsp and rbp, every other register is marked as clobbered so the
+//   compiler spills only the ones actually live at the call site. A fiber switched out with it has to be resumed with
+//   the minimal or the fpu variant.
+// - fiber_context_swap_inline_fpu is the minimal variant plus MXCSR and the x87 control word, for the fibers that
+//   change the rounding mode or the floating point exceptions mask.
+// - fiber_context_swap_inline_full saves the whole callee-saved set in the fiber_t, exactly as fiber_context_swap does,
+//   so the fibers can be switched with both.
+
+#define FIBER_CONTEXT_INLINE_CLOBBERS_SSE \
+    "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7", \
+    "xmm8", "xmm9", "xmm10", "xmm11", "xmm12", "xmm13", "xmm14", "xmm15"
+
+#if defined(__AVX512F__)
+#define FIBER_CONTEXT_INLINE_CLOBBERS_VECTOR \
+    FIBER_CONTEXT_INLINE_CLOBBERS_SSE, \
+    "xmm16", "xmm17", "xmm18", "xmm19", "xmm20", "xmm21", "xmm22", "xmm23", \
+    "xmm24", "xmm25", "xmm26", "xmm27", "xmm28", "xmm29", "xmm30", "xmm31", \
+    "k0", "k1", "k2", "k3", "k4", "k5", "k6", "k7"
+#else
+#define FIBER_CONTEXT_INLINE_CLOBBERS_VECTOR \
+    FIBER_CONTEXT_INLINE_CLOBBERS_SSE
+#endif
+
+#define FIBER_CONTEXT_INLINE_CLOBBERS_X87 \
+    "st", "st(1)", "st(2)", "st(3)", "st(4)", "st(5)", "st(6)", "st(7)"
+
+#define FIBER_CONTEXT_INLINE_OFFSETS \
+    [rip] "i" (offsetof(fiber_t, context.rip)), \
+    [rsp] "i" (offsetof(fiber_t, context.rsp)), \
+    [rbx] "i" (offsetof(fiber_t, context.rbx)), \
+    [rbp] "i" (offsetof(fiber_t, context.rbp)), \
+    [r12] "i" (offsetof(fiber_t, context.r12)), \
+    [r13] "i" (offsetof(fiber_t, context.r13)), \
+    [r14] "i" (offsetof(fiber_t, context.r14)), \
+    [r15] "i" (offsetof(fiber_t, context.r15)), \
+    [mxcsr] "i" (offsetof(fiber_t, context.mxcsr)), \
+    [x87_cw] "i" (offsetof(fiber_t, context.x87_cw))
+
+static inline __attribute__((always_inline)) void fiber_context_swap_inline_minimal(
+        fiber_t* fiber_context_from,
+        fiber_t* fiber_context_to) {
+    // rbp is saved explicitly because it can't be marked as clobbered when used as frame pointer
+    __asm__ __volatile__(
+            "leaq 1f(%%rip), %%rax\n\t"
+            "movq %%rax, %c[rip](%%rdi)\n\t"
+            "movq %%rsp, %c[rsp](%%rdi)\n\t"
+            "movq %%rbp, %c[rbp](%%rdi)\n\t"
+            "movq %c[rsp](%%rsi), %%rsp\n\t"
+            "movq %c[rbp](%%rsi), %%rbp\n\t"
+            "jmpq *%c[rip](%%rsi)\n\t"
+            "1:\n\t"
+            : "+D" (fiber_context_from), "+S" (fiber_context_to)
+            : FIBER_CONTEXT_INLINE_OFFSETS
+            : "rax", "rbx", "rcx", "rdx", "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15",
+              FIBER_CONTEXT_INLINE_CLOBBERS_VECTOR, FIBER_CONTEXT_INLINE_CLOBBERS_X87, "cc", "memory");
+}
+
+static inline __attribute__((always_inline)) void fiber_context_swap_inline_fpu(
+        fiber_t* fiber_context_from,
+        fiber_t* fiber_context_to) {
+    __asm__ __volatile__(
+            "leaq 1f(%%rip), %%rax\n\t"
+            "movq %%rax, %c[rip](%%rdi)\n\t"
+            "movq %%rsp, %c[rsp](%%rdi)\n\t"
+            "movq %%rbp, %c[rbp](%%rdi)\n\t"
+            "stmxcsr %c[mxcsr](%%rdi)\n\t"
+            "fnstcw %c[x87_cw](%%rdi)\n\t"
+            "movq %c[rsp](%%rsi), %%rsp\n\t"
+            "movq %c[rbp](%%rsi), %%rbp\n\t"
+            "ldmxcsr %c[mxcsr](%%rsi)\n\t"
+            "fldcw %c[x87_cw](%%rsi)\n\t"
+            "jmpq *%c[rip](%%rsi)\n\t"
+            "1:\n\t"
+            : "+D" (fiber_context_from), "+S" (fiber_context_to)
+            : FIBER_CONTEXT_INLINE_OFFSETS
+            : "rax", "rbx", "rcx", "rdx", "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15",
+              FIBER_CONTEXT_INLINE_CLOBBERS_VECTOR, FIBER_CONTEXT_INLINE_CLOBBERS_X87, "cc", "memory");
+}
+
+static inline __attribute__((always_inline)) void fiber_context_swap_inline_full(
+        fiber_t* fiber_context_from,
+        fiber_t* fiber_context_to) {
+    // The saved rsp skips the red zone, fiber_context_swap pushes the return address on the stack of the fiber being
+    // resumed and would overwrite it
+    __asm__ __volatile__(
+            "leaq -128(%%rsp), %%rsp\n\t"
+            "leaq 1f(%%rip), %%rax\n\t"
+            "movq %%rax, %c[rip](%%rdi)\n\t"
+            "movq %%rsp, %c[rsp](%%rdi)\n\t"
+            "movq %%rbx, %c[rbx](%%rdi)\n\t"
+            "movq %%rbp, %c[rbp](%%rdi)\n\t"
+            "movq %%r12, %c[r12](%%rdi)\n\t"
+            "movq %%r13, %c[r13](%%rdi)\n\t"
+            "movq %%r14, %c[r14](%%rdi)\n\t"
+            "movq %%r15, %c[r15](%%rdi)\n\t"
+            "movq %c[rsp](%%rsi), %%rsp\n\t"
+            "movq %c[rbx](%%rsi), %%rbx\n\t"
+            "movq %c[rbp](%%rsi), %%rbp\n\t"
+            "movq %c[r12](%%rsi), %%r12\n\t"
+            "movq %c[r13](%%rsi), %%r13\n\t"
+            "movq %c[r14](%%rsi), %%r14\n\t"
+            "movq %c[r15](%%rsi), %%r15\n\t"
+            "jmpq *%c[rip](%%rsi)\n\t"
+            "1:\n\t"
+            "leaq 128(%%rsp), %%rsp\n\t"
+            : "+D" (fiber_context_from), "+S" (fiber_context_to)
+            : FIBER_CONTEXT_INLINE_OFFSETS
+            : "rax", "rcx", "rdx", "r8", "r9", "r10", "r11",
+              FIBER_CONTEXT_INLINE_CLOBBERS_VECTOR, FIBER_CONTEXT_INLINE_CLOBBERS_X87, "cc", "memory");
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //FIBER_CONTEXT_INLINE_H
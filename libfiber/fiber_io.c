@@ -0,0 +1,529 @@
+/**
+ * Copyright (C) 2020-2021 Daniele Salvatore Albano
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license.  See the LICENSE file for details.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <linux/io_uring.h>
+
+#include "fiber.h"
+#include "fiber_scheduler.h"
+#include "fiber_timer_wheel.h"
+#include "fiber_io.h"
+
+// Reserved user_data values for the entries not bound to a request, they are not counted as in flight
+#define FIBER_IO_URING_USER_DATA_WAKEUP 0
+#define FIBER_IO_URING_USER_DATA_CANCEL 1
+
+typedef struct fiber_io_uring fiber_io_uring_t;
+struct fiber_io_uring {
+    int fd;
+    uint32_t sq_entries;
+    uint32_t sq_tail_local;
+    uint32_t sq_tail_submitted;
+    uint32_t inflight;
+    // Without IORING_FEAT_EXT_ARG io_uring_enter can't wait with a timeout
+    bool ext_arg;
+    // The read on the wakeup eventfd is armed only while the worker sleeps and isn't counted as in flight
+    int wakeup_fd;
+    bool wakeup_armed;
+    uint64_t wakeup_value;
+
+    uint32_t* sq_head;
+    uint32_t* sq_tail;
+    uint32_t* sq_ring_mask;
+    uint32_t* sq_array;
+    struct io_uring_sqe* sqes;
+
+    uint32_t* cq_head;
+    uint32_t* cq_tail;
+    uint32_t* cq_ring_mask;
+    struct io_uring_cqe* cqes;
+
+    void* sq_ring_ptr;
+    size_t sq_ring_size;
+    void* cq_ring_ptr;
+    size_t cq_ring_size;
+    void* sqes_ptr;
+    size_t sqes_size;
+};
+
+typedef struct fiber_io_uring_request fiber_io_uring_request_t;
+struct fiber_io_uring_request {
+    fiber_t* fiber;
+    int32_t result;
+    bool timed_out;
+    fiber_timer_t timer;
+    fiber_timer_wheel_t* timer_wheel;
+};
+
+static __thread fiber_io_uring_t* fiber_io_uring_thread = NULL;
+
+// Read once before the fiber is parked, the fiber might be resumed by a different worker
+__attribute__((noinline, noipa))
+static fiber_io_uring_t* fiber_io_uring_get_thread(void) {
+    return fiber_io_uring_thread;
+}
+
+static int fiber_io_uring_setup(
+        uint32_t entries,
+        struct io_uring_params* params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int fiber_io_uring_enter(
+        int fd,
+        uint32_t to_submit,
+        uint32_t min_complete,
+        uint32_t flags,
+        void* arg,
+        size_t arg_size) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, arg_size);
+}
+
+static fiber_io_uring_t* fiber_io_uring_new(
+        uint32_t entries,
+        int wakeup_fd) {
+    struct io_uring_params params = { 0 };
+    fiber_io_uring_t* ring;
+
+    int fd = fiber_io_uring_setup(entries, &params);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    ring = malloc(sizeof(fiber_io_uring_t));
+    memset(ring, 0, sizeof(fiber_io_uring_t));
+    ring->fd = fd;
+    ring->wakeup_fd = wakeup_fd;
+    ring->ext_arg = (params.features & IORING_FEAT_EXT_ARG) != 0;
+    ring->sq_entries = params.sq_entries;
+
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    // With IORING_FEAT_SINGLE_MMAP the two rings share the same mapping
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_ring_size > ring->sq_ring_size) {
+            ring->sq_ring_size = ring->cq_ring_size;
+        }
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+
+    ring->sq_ring_ptr = mmap(
+            NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring_ptr == MAP_FAILED) {
+        fprintf(stderr, "Unable to map the io_uring submission queue\n");
+        exit(-1);
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ring_ptr = ring->sq_ring_ptr;
+    } else {
+        ring->cq_ring_ptr = mmap(
+                NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ring_ptr == MAP_FAILED) {
+            fprintf(stderr, "Unable to map the io_uring completion queue\n");
+            exit(-1);
+        }
+    }
+
+    ring->sqes_ptr = mmap(
+            NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ring->sqes_ptr == MAP_FAILED) {
+        fprintf(stderr, "Unable to map the io_uring submission queue entries\n");
+        exit(-1);
+    }
+
+    ring->sq_head = ring->sq_ring_ptr + params.sq_off.head;
+    ring->sq_tail = ring->sq_ring_ptr + params.sq_off.tail;
+    ring->sq_ring_mask = ring->sq_ring_ptr + params.sq_off.ring_mask;
+    ring->sq_array = ring->sq_ring_ptr + params.sq_off.array;
+    ring->sqes = ring->sqes_ptr;
+
+    ring->cq_head = ring->cq_ring_ptr + params.cq_off.head;
+    ring->cq_tail = ring->cq_ring_ptr + params.cq_off.tail;
+    ring->cq_ring_mask = ring->cq_ring_ptr + params.cq_off.ring_mask;
+    ring->cqes = ring->cq_ring_ptr + params.cq_off.cqes;
+
+    ring->sq_tail_local = ring->sq_tail_submitted = *ring->sq_tail;
+
+    return ring;
+}
+
+static void fiber_io_uring_free(
+        fiber_io_uring_t* ring) {
+    munmap(ring->sqes_ptr, ring->sqes_size);
+    if (ring->cq_ring_ptr != ring->sq_ring_ptr) {
+        munmap(ring->cq_ring_ptr, ring->cq_ring_size);
+    }
+    munmap(ring->sq_ring_ptr, ring->sq_ring_size);
+    close(ring->fd);
+    free(ring);
+}
+
+static uint32_t fiber_io_uring_reap(
+        fiber_io_uring_t* ring) {
+    uint32_t head = *ring->cq_head;
+    uint32_t tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    uint32_t mask = *ring->cq_ring_mask;
+    uint32_t count = tail - head;
+
+    // All the completions available are processed in one go and the head is published only once at the end
+    for(; head != tail; head++) {
+        struct io_uring_cqe* cqe = &ring->cqes[head & mask];
+        fiber_io_uring_request_t* request = (fiber_io_uring_request_t*)(uintptr_t)cqe->user_data;
+
+        if (cqe->user_data == FIBER_IO_URING_USER_DATA_WAKEUP) {
+            ring->wakeup_armed = false;
+            count--;
+            continue;
+        } else if (cqe->user_data == FIBER_IO_URING_USER_DATA_CANCEL) {
+            count--;
+            continue;
+        }
+
+        // The timer has been armed by this same worker, the wheel belongs to the thread
+        if (request->timer_wheel) {
+            fiber_timer_cancel(request->timer_wheel, &request->timer);
+        }
+
+        request->result = cqe->res;
+        fiber_resume(request->fiber);
+    }
+
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    ring->inflight -= count;
+
+    return count;
+}
+
+static uint32_t fiber_io_uring_submit_and_reap(
+        fiber_io_uring_t* ring,
+        bool wait,
+        uint64_t timeout_ns) {
+    struct __kernel_timespec timeout_ts;
+    struct io_uring_getevents_arg getevents_arg = { 0 };
+    void* arg = NULL;
+    size_t arg_size = 0;
+    uint32_t flags = 0;
+    uint32_t to_submit = ring->sq_tail_local - ring->sq_tail_submitted;
+
+    if (to_submit > 0) {
+        __atomic_store_n(ring->sq_tail, ring->sq_tail_local, __ATOMIC_RELEASE);
+    }
+
+    if (wait && timeout_ns != UINT64_MAX) {
+        // Older kernels can't bound the wait, the completions are only polled and the caller has to retry
+        if (ring->ext_arg) {
+            timeout_ts.tv_sec = (int64_t)(timeout_ns / 1000000000ull);
+            timeout_ts.tv_nsec = (long long)(timeout_ns % 1000000000ull);
+            getevents_arg.ts = (uintptr_t)&timeout_ts;
+            arg = &getevents_arg;
+            arg_size = sizeof(getevents_arg);
+            flags |= IORING_ENTER_EXT_ARG;
+        } else {
+            wait = false;
+        }
+    }
+
+    if (wait) {
+        flags |= IORING_ENTER_GETEVENTS;
+    }
+
+    if (to_submit > 0 || wait) {
+        int rc = fiber_io_uring_enter(
+                ring->fd,
+                to_submit,
+                wait ? 1 : 0,
+                flags,
+                arg,
+                arg_size);
+
+        if (rc < 0) {
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY && errno != ETIME) {
+                perror("io_uring_enter");
+                exit(-1);
+            }
+        } else {
+            ring->sq_tail_submitted += rc;
+        }
+    }
+
+    return fiber_io_uring_reap(ring);
+}
+
+static struct io_uring_sqe* fiber_io_uring_get_sqe(
+        fiber_io_uring_t* ring) {
+    // The kernel consumes the submission queue when io_uring_enter is called, if it's full the pending entries are
+    // submitted straight away
+    while (ring->sq_tail_local - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >= ring->sq_entries) {
+        fiber_io_uring_submit_and_reap(ring, false, 0);
+    }
+
+    uint32_t index = ring->sq_tail_local & *ring->sq_ring_mask;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    ring->sq_array[index] = index;
+    ring->sq_tail_local++;
+
+    return sqe;
+}
+
+static void fiber_io_uring_arm_wakeup(
+        fiber_io_uring_t* ring) {
+    if (ring->wakeup_fd < 0 || ring->wakeup_armed) {
+        return;
+    }
+
+    struct io_uring_sqe* sqe = fiber_io_uring_get_sqe(ring);
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = ring->wakeup_fd;
+    sqe->addr = (uintptr_t)&ring->wakeup_value;
+    sqe->len = sizeof(ring->wakeup_value);
+    sqe->off = (uint64_t)-1;
+    sqe->user_data = FIBER_IO_URING_USER_DATA_WAKEUP;
+
+    ring->wakeup_armed = true;
+}
+
+// Invoked by the worker that submitted the request, the cancellation completes the request with -ECANCELED unless it
+// has completed in the meantime
+static void fiber_io_uring_timeout_callback(
+        fiber_timer_t* timer,
+        void* user_data) {
+    fiber_io_uring_request_t* request = user_data;
+    fiber_io_uring_t* ring = fiber_io_uring_thread;
+
+    request->timed_out = true;
+
+    struct io_uring_sqe* sqe = fiber_io_uring_get_sqe(ring);
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->addr = (uintptr_t)request;
+    sqe->user_data = FIBER_IO_URING_USER_DATA_CANCEL;
+}
+
+static int32_t fiber_io_uring_wait(
+        fiber_io_uring_t* ring,
+        fiber_io_uring_request_t* request,
+        uint64_t timeout_us) {
+    if (timeout_us > 0) {
+        uint64_t now_ns = fiber_timer_wheel_now_ns();
+        request->timer_wheel = fiber_scheduler_worker_get_timer_wheel(fiber_scheduler_get_current_worker());
+        fiber_timer_arm(
+                request->timer_wheel,
+                &request->timer,
+                now_ns,
+                now_ns + timeout_us * 1000,
+                fiber_io_uring_timeout_callback,
+                request);
+    }
+
+    ring->inflight++;
+    fiber_park();
+
+    if (request->timed_out && (request->result == -ECANCELED || request->result == -EINTR)) {
+        return -ETIMEDOUT;
+    }
+
+    return request->result;
+}
+
+// Used when the operation can't go through io_uring, returns false if the timeout elapses before the fd is ready
+static bool fiber_io_wait_ready_blocking(
+        int fd,
+        short events,
+        uint64_t timeout_us) {
+    struct pollfd pollfd = { .fd = fd, .events = events };
+
+    if (timeout_us == 0) {
+        return true;
+    }
+
+    int rc = poll(&pollfd, 1, (int)((timeout_us + 999) / 1000));
+    if (rc == 0) {
+        errno = ETIMEDOUT;
+        return false;
+    }
+
+    return true;
+}
+
+bool fiber_io_uring_is_supported(void) {
+    static int supported = -1;
+
+    if (supported == -1) {
+        struct io_uring_params params = { 0 };
+        int fd = fiber_io_uring_setup(1, &params);
+
+        supported = fd >= 0;
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    return supported;
+}
+
+void fiber_io_uring_thread_init(
+        int wakeup_fd) {
+    if (fiber_io_uring_thread == NULL) {
+        fiber_io_uring_thread = fiber_io_uring_new(FIBER_IO_URING_ENTRIES, wakeup_fd);
+    }
+}
+
+void fiber_io_uring_thread_free(void) {
+    if (fiber_io_uring_thread != NULL) {
+        fiber_io_uring_free(fiber_io_uring_thread);
+        fiber_io_uring_thread = NULL;
+    }
+}
+
+bool fiber_io_uring_has_pending(void) {
+    return fiber_io_uring_thread != NULL && fiber_io_uring_thread->inflight > 0;
+}
+
+uint32_t fiber_io_uring_poll(
+        bool wait,
+        uint64_t timeout_ns) {
+    if (fiber_io_uring_thread == NULL || fiber_io_uring_thread->inflight == 0) {
+        return 0;
+    }
+
+    if (wait) {
+        fiber_io_uring_arm_wakeup(fiber_io_uring_thread);
+    }
+
+    return fiber_io_uring_submit_and_reap(fiber_io_uring_thread, wait, timeout_ns);
+}
+
+ssize_t fiber_read(
+        int fd,
+        void* buf,
+        size_t count) {
+    return fiber_read_timeout(fd, buf, count, 0);
+}
+
+ssize_t fiber_read_timeout(
+        int fd,
+        void* buf,
+        size_t count,
+        uint64_t timeout_us) {
+    fiber_io_uring_t* ring = fiber_io_uring_get_thread();
+    fiber_io_uring_request_t request = { .fiber = fiber_scheduler_get_current_fiber() };
+
+    if (ring == NULL || request.fiber == NULL) {
+        if (!fiber_io_wait_ready_blocking(fd, POLLIN, timeout_us)) {
+            return -1;
+        }
+        return read(fd, buf, count);
+    }
+
+    struct io_uring_sqe* sqe = fiber_io_uring_get_sqe(ring);
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = (uintptr_t)buf;
+    sqe->len = count;
+    sqe->off = (uint64_t)-1;
+    sqe->user_data = (uintptr_t)&request;
+
+    int32_t result = fiber_io_uring_wait(ring, &request, timeout_us);
+    if (result < 0) {
+        errno = -result;
+        return -1;
+    }
+
+    return result;
+}
+
+ssize_t fiber_write(
+        int fd,
+        const void* buf,
+        size_t count) {
+    return fiber_write_timeout(fd, buf, count, 0);
+}
+
+ssize_t fiber_write_timeout(
+        int fd,
+        const void* buf,
+        size_t count,
+        uint64_t timeout_us) {
+    fiber_io_uring_t* ring = fiber_io_uring_get_thread();
+    fiber_io_uring_request_t request = { .fiber = fiber_scheduler_get_current_fiber() };
+
+    if (ring == NULL || request.fiber == NULL) {
+        if (!fiber_io_wait_ready_blocking(fd, POLLOUT, timeout_us)) {
+            return -1;
+        }
+        return write(fd, buf, count);
+    }
+
+    struct io_uring_sqe* sqe = fiber_io_uring_get_sqe(ring);
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = fd;
+    sqe->addr = (uintptr_t)buf;
+    sqe->len = count;
+    sqe->off = (uint64_t)-1;
+    sqe->user_data = (uintptr_t)&request;
+
+    int32_t result = fiber_io_uring_wait(ring, &request, timeout_us);
+    if (result < 0) {
+        errno = -result;
+        return -1;
+    }
+
+    return result;
+}
+
+int fiber_accept(
+        int fd,
+        struct sockaddr* addr,
+        socklen_t* addrlen) {
+    return fiber_accept_timeout(fd, addr, addrlen, 0);
+}
+
+int fiber_accept_timeout(
+        int fd,
+        struct sockaddr* addr,
+        socklen_t* addrlen,
+        uint64_t timeout_us) {
+    fiber_io_uring_t* ring = fiber_io_uring_get_thread();
+    fiber_io_uring_request_t request = { .fiber = fiber_scheduler_get_current_fiber() };
+
+    if (ring == NULL || request.fiber == NULL) {
+        if (!fiber_io_wait_ready_blocking(fd, POLLIN, timeout_us)) {
+            return -1;
+        }
+        return accept(fd, addr, addrlen);
+    }
+
+    struct io_uring_sqe* sqe = fiber_io_uring_get_sqe(ring);
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = fd;
+    sqe->addr = (uintptr_t)addr;
+    sqe->addr2 = (uintptr_t)addrlen;
+    sqe->user_data = (uintptr_t)&request;
+
+    int32_t result = fiber_io_uring_wait(ring, &request, timeout_us);
+    if (result < 0) {
+        errno = -result;
+        return -1;
+    }
+
+    return result;
+}
@@ -0,0 +1,74 @@
+#ifndef FIBER_IO_H
+#define FIBER_IO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FIBER_IO_URING_ENTRIES 256
+
+bool fiber_io_uring_is_supported(void);
+
+// Called by the scheduler workers when they start and stop, every worker owns an io_uring instance. While waiting for
+// the completions a read on wakeup_fd, an eventfd, is kept armed so the worker can be woken up by the other threads,
+// -1 disables it
+void fiber_io_uring_thread_init(
+        int wakeup_fd);
+
+void fiber_io_uring_thread_free(void);
+
+bool fiber_io_uring_has_pending(void);
+
+// Submits the queued operations and reaps all the available completions resuming the parked fibers, if wait is true
+// blocks until at least one completion is available or timeout_ns elapses (UINT64_MAX waits without a timeout)
+uint32_t fiber_io_uring_poll(
+        bool wait,
+        uint64_t timeout_ns);
+
+// The calling fiber is parked until the operation completes, outside of the scheduler or when io_uring is not
+// available the plain blocking syscall is used
+ssize_t fiber_read(
+        int fd,
+        void* buf,
+        size_t count);
+
+ssize_t fiber_write(
+        int fd,
+        const void* buf,
+        size_t count);
+
+int fiber_accept(
+        int fd,
+        struct sockaddr* addr,
+        socklen_t* addrlen);
+
+// Same as above but the operation is cancelled if it doesn't complete within timeout_us microseconds, in which case
+// -1 is returned with errno set to ETIMEDOUT. The timeout is tracked by the timer wheel of the worker, 0 disables it.
+ssize_t fiber_read_timeout(
+        int fd,
+        void* buf,
+        size_t count,
+        uint64_t timeout_us);
+
+ssize_t fiber_write_timeout(
+        int fd,
+        const void* buf,
+        size_t count,
+        uint64_t timeout_us);
+
+int fiber_accept_timeout(
+        int fd,
+        struct sockaddr* addr,
+        socklen_t* addrlen,
+        uint64_t timeout_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //FIBER_IO_H
@@ -0,0 +1,191 @@
+/**
+ * Copyright (C) 2020-2021 Daniele Salvatore Albano
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license.  See the LICENSE file for details.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "fiber.h"
+#include "fiber_pool.h"
+
+typedef struct fiber_pool_thread_cache fiber_pool_thread_cache_t;
+struct fiber_pool_thread_cache {
+    fiber_pool_t* pool;
+    uint32_t count;
+    fiber_t* fibers[FIBER_POOL_THREAD_CACHE_SIZE];
+};
+
+struct fiber_pool {
+    size_t stack_size;
+    fiber_stack_type_t stack_type;
+    pthread_key_t thread_cache_key;
+    pthread_mutex_t shared_lock;
+    uint32_t shared_count;
+    uint32_t shared_size;
+    fiber_t** shared_fibers;
+};
+
+static void fiber_pool_shared_put(
+        fiber_pool_t* pool,
+        fiber_t** fibers,
+        uint32_t count) {
+    pthread_mutex_lock(&pool->shared_lock);
+
+    if (pool->shared_count + count > pool->shared_size) {
+        uint32_t shared_size = pool->shared_size == 0 ? FIBER_POOL_THREAD_CACHE_SIZE : pool->shared_size;
+        while (shared_size < pool->shared_count + count) {
+            shared_size *= 2;
+        }
+
+        pool->shared_fibers = realloc(pool->shared_fibers, sizeof(fiber_t*) * shared_size);
+        if (pool->shared_fibers == NULL) {
+            fprintf(stderr, "Unable to grow the fiber pool\n");
+            exit(-1);
+        }
+
+        pool->shared_size = shared_size;
+    }
+
+    memcpy(pool->shared_fibers + pool->shared_count, fibers, sizeof(fiber_t*) * count);
+    pool->shared_count += count;
+
+    pthread_mutex_unlock(&pool->shared_lock);
+}
+
+static uint32_t fiber_pool_shared_take(
+        fiber_pool_t* pool,
+        fiber_t** fibers,
+        uint32_t count) {
+    pthread_mutex_lock(&pool->shared_lock);
+
+    if (count > pool->shared_count) {
+        count = pool->shared_count;
+    }
+
+    pool->shared_count -= count;
+    memcpy(fibers, pool->shared_fibers + pool->shared_count, sizeof(fiber_t*) * count);
+
+    pthread_mutex_unlock(&pool->shared_lock);
+
+    return count;
+}
+
+static void fiber_pool_thread_cache_destructor(
+        void* data) {
+    fiber_pool_thread_cache_t* thread_cache = data;
+
+    if (thread_cache->count > 0) {
+        fiber_pool_shared_put(thread_cache->pool, thread_cache->fibers, thread_cache->count);
+    }
+
+    free(thread_cache);
+}
+
+static fiber_pool_thread_cache_t* fiber_pool_thread_cache_get(
+        fiber_pool_t* pool) {
+    fiber_pool_thread_cache_t* thread_cache = pthread_getspecific(pool->thread_cache_key);
+
+    if (__builtin_expect(thread_cache == NULL, false)) {
+        thread_cache = malloc(sizeof(fiber_pool_thread_cache_t));
+        memset(thread_cache, 0, sizeof(fiber_pool_thread_cache_t));
+        thread_cache->pool = pool;
+
+        pthread_setspecific(pool->thread_cache_key, thread_cache);
+    }
+
+    return thread_cache;
+}
+
+fiber_pool_t* fiber_pool_new(
+        size_t stack_size,
+        fiber_stack_type_t stack_type,
+        uint32_t preallocate_count) {
+    fiber_pool_t* pool = malloc(sizeof(fiber_pool_t));
+    memset(pool, 0, sizeof(fiber_pool_t));
+
+    pool->stack_size = stack_size;
+    pool->stack_type = stack_type;
+    pthread_mutex_init(&pool->shared_lock, NULL);
+
+    if (pthread_key_create(&pool->thread_cache_key, fiber_pool_thread_cache_destructor) != 0) {
+        fprintf(stderr, "Unable to create the fiber pool thread cache key\n");
+        exit(-1);
+    }
+
+    // The stacks are allocated and guard paged upfront, the fibers are prepared again when acquired
+    for(uint32_t index = 0; index < preallocate_count; index++) {
+        fiber_t* fiber = fiber_new_with_stack_type(stack_size, stack_type, NULL, NULL);
+        fiber_pool_shared_put(pool, &fiber, 1);
+    }
+
+    return pool;
+}
+
+void fiber_pool_free(
+        fiber_pool_t* pool) {
+    fiber_pool_thread_cache_t* thread_cache = pthread_getspecific(pool->thread_cache_key);
+
+    if (thread_cache != NULL) {
+        pthread_setspecific(pool->thread_cache_key, NULL);
+        fiber_pool_thread_cache_destructor(thread_cache);
+    }
+
+    pthread_key_delete(pool->thread_cache_key);
+
+    for(uint32_t index = 0; index < pool->shared_count; index++) {
+        fiber_free(pool->shared_fibers[index]);
+    }
+
+    pthread_mutex_destroy(&pool->shared_lock);
+    free(pool->shared_fibers);
+    free(pool);
+}
+
+fiber_t* fiber_pool_acquire(
+        fiber_pool_t* pool,
+        fiber_start_fp_t* fiber_start_fp,
+        void* user_data) {
+    fiber_t* fiber;
+    fiber_pool_thread_cache_t* thread_cache = fiber_pool_thread_cache_get(pool);
+
+    if (__builtin_expect(thread_cache->count == 0, false)) {
+        thread_cache->count = fiber_pool_shared_take(
+                pool,
+                thread_cache->fibers,
+                FIBER_POOL_THREAD_CACHE_BATCH_SIZE);
+    }
+
+    if (__builtin_expect(thread_cache->count == 0, false)) {
+        return fiber_new_with_stack_type(pool->stack_size, pool->stack_type, fiber_start_fp, user_data);
+    }
+
+    // No syscalls and no zeroing, the guard page is still in place from when the fiber has been allocated
+    fiber = thread_cache->fibers[--thread_cache->count];
+    fiber_prepare(fiber, fiber_start_fp, user_data);
+
+    return fiber;
+}
+
+void fiber_pool_release(
+        fiber_pool_t* pool,
+        fiber_t* fiber) {
+    fiber_pool_thread_cache_t* thread_cache = fiber_pool_thread_cache_get(pool);
+
+    if (__builtin_expect(thread_cache->count == FIBER_POOL_THREAD_CACHE_SIZE, false)) {
+        thread_cache->count -= FIBER_POOL_THREAD_CACHE_BATCH_SIZE;
+        fiber_pool_shared_put(
+                pool,
+                thread_cache->fibers + thread_cache->count,
+                FIBER_POOL_THREAD_CACHE_BATCH_SIZE);
+    }
+
+    thread_cache->fibers[thread_cache->count++] = fiber;
+}
@@ -0,0 +1,42 @@
+#ifndef FIBER_POOL_H
+#define FIBER_POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "fiber.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Fibers cached per thread before the pool starts to move them, in batches, to the list shared between the threads
+#define FIBER_POOL_THREAD_CACHE_SIZE 64
+#define FIBER_POOL_THREAD_CACHE_BATCH_SIZE (FIBER_POOL_THREAD_CACHE_SIZE / 2)
+
+typedef struct fiber_pool fiber_pool_t;
+
+fiber_pool_t* fiber_pool_new(
+        size_t stack_size,
+        fiber_stack_type_t stack_type,
+        uint32_t preallocate_count);
+
+// The threads that used the pool return their cached fibers when they terminate, the pool has to be freed only after
+// all of them have terminated
+void fiber_pool_free(
+        fiber_pool_t* pool);
+
+fiber_t* fiber_pool_acquire(
+        fiber_pool_t* pool,
+        fiber_start_fp_t* fiber_start_fp,
+        void* user_data);
+
+void fiber_pool_release(
+        fiber_pool_t* pool,
+        fiber_t* fiber);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //FIBER_POOL_H
@@ -0,0 +1,787 @@
+/**
+ * Copyright (C) 2020-2021 Daniele Salvatore Albano
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license.  See the LICENSE file for details.
+ **/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
+#include <linux/futex.h>
+
+#include "fiber.h"
+#include "fiber_pool.h"
+#include "fiber_io.h"
+#include "fiber_stats.h"
+#include "fiber_timer_wheel.h"
+#include "fiber_scheduler.h"
+
+#define FIBER_SCHEDULER_QUEUE_MASK (FIBER_SCHEDULER_QUEUE_SIZE - 1)
+#define FIBER_SCHEDULER_IDLE_PAUSE_COUNT 64
+#define FIBER_SCHEDULER_IDLE_SPIN_COUNT 128
+#define FIBER_SCHEDULER_WATCHDOG_MIN_INTERVAL_NS 1000000ull
+
+enum fiber_scheduler_worker_sleeping {
+    FIBER_SCHEDULER_WORKER_AWAKE = 0,
+    FIBER_SCHEDULER_WORKER_SLEEPING_FUTEX,
+    FIBER_SCHEDULER_WORKER_SLEEPING_IO,
+};
+
+typedef struct fiber_scheduler_queue fiber_scheduler_queue_t;
+struct fiber_scheduler_queue {
+    // The owner pushes on the tail and pops from the head, the thieves pop from the head as well so the queue is FIFO
+    // for everyone and a yielded fiber is not picked up again straight away. Only the head is contended and it's
+    // advanced with a CAS, the tail is written only by the owner.
+    _Atomic uint64_t head __attribute__((aligned(64)));
+    _Atomic uint64_t tail __attribute__((aligned(64)));
+    fiber_t* _Atomic slots[FIBER_SCHEDULER_QUEUE_SIZE] __attribute__((aligned(64)));
+};
+
+struct fiber_scheduler_worker {
+    fiber_scheduler_queue_t queue;
+    fiber_t context;
+    fiber_t* fiber_current;
+    fiber_scheduler_park_callback_fp_t* park_callback_fp;
+    void* park_callback_user_data;
+    fiber_scheduler_t* scheduler;
+    pthread_t thread;
+    uint32_t index;
+    uint32_t core_index;
+    uint64_t random_state;
+    // Written to wake up the worker when it's sleeping in io_uring_enter
+    int wakeup_fd;
+    // Accessed only by the worker thread, the timers are armed and expire on the worker running the fiber
+    fiber_timer_wheel_t* timer_wheel;
+    // Parked fibers resumed by other threads, it's a lock-free MPSC list emptied at once by the worker
+    fiber_t* _Atomic remote_head __attribute__((aligned(64)));
+    _Atomic uint32_t sleeping __attribute__((aligned(64)));
+#if FIBER_STATS_ENABLED == 1
+    // Published for the watchdog, the tsc is 0 when the worker isn't running a fiber
+    fiber_t* _Atomic watchdog_fiber __attribute__((aligned(64)));
+    _Atomic uint64_t watchdog_swap_in_tsc;
+    // Accessed only by the watchdog thread, a fiber is reported once per run
+    uint64_t watchdog_reported_swap_in_tsc;
+#endif
+} __attribute__((aligned(64)));
+
+struct fiber_scheduler {
+    fiber_scheduler_worker_t* workers;
+    uint32_t workers_count;
+    fiber_pool_t* fiber_pool;
+    // Fibers spawned from outside the workers or not fitting in a local queue, it's a lock-free stack that is always
+    // emptied at once by the workers so it isn't affected by ABA
+    fiber_t* _Atomic injection_head __attribute__((aligned(64)));
+    _Atomic uint64_t fibers_active __attribute__((aligned(64)));
+    _Atomic uint32_t workers_sleeping_count __attribute__((aligned(64)));
+#if FIBER_STATS_ENABLED == 1
+    struct {
+        uint64_t threshold_us;
+        fiber_scheduler_watchdog_callback_fp_t* callback_fp;
+        void* callback_user_data;
+        pthread_t thread;
+        _Atomic bool stop;
+    } watchdog;
+#endif
+};
+
+static __thread fiber_scheduler_worker_t* fiber_scheduler_worker_current = NULL;
+
+// A fiber can be resumed by a different worker, the noipa attribute prevents the compiler from caching the address of
+// the thread local variable across a context switch
+__attribute__((noinline, noipa))
+fiber_scheduler_worker_t* fiber_scheduler_get_current_worker(void) {
+    return fiber_scheduler_worker_current;
+}
+
+fiber_t* fiber_scheduler_get_current_fiber(void) {
+    fiber_scheduler_worker_t* worker = fiber_scheduler_get_current_worker();
+
+    return worker == NULL ? NULL : worker->fiber_current;
+}
+
+fiber_timer_wheel_t* fiber_scheduler_worker_get_timer_wheel(
+        fiber_scheduler_worker_t* worker) {
+    return worker->timer_wheel;
+}
+
+uint32_t fiber_scheduler_worker_get_index(
+        fiber_scheduler_worker_t* worker) {
+    return worker->index;
+}
+
+static bool fiber_scheduler_queue_push(
+        fiber_scheduler_queue_t* queue,
+        fiber_t* fiber) {
+    uint64_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+
+    if (tail - head >= FIBER_SCHEDULER_QUEUE_SIZE) {
+        return false;
+    }
+
+    atomic_store_explicit(&queue->slots[tail & FIBER_SCHEDULER_QUEUE_MASK], fiber, memory_order_relaxed);
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+
+    return true;
+}
+
+// Used by both the owner and the thieves: the slot is read before the CAS on the head, if the CAS succeeds the slot
+// can't have been overwritten by the owner because the push checks the head before reusing a slot
+static fiber_t* fiber_scheduler_queue_pop(
+        fiber_scheduler_queue_t* queue) {
+    uint64_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+
+    while (true) {
+        uint64_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+
+        if (head >= tail) {
+            return NULL;
+        }
+
+        fiber_t* fiber = atomic_load_explicit(&queue->slots[head & FIBER_SCHEDULER_QUEUE_MASK], memory_order_relaxed);
+
+        if (atomic_compare_exchange_weak_explicit(
+                &queue->head,
+                &head,
+                head + 1,
+                memory_order_acq_rel,
+                memory_order_acquire)) {
+            return fiber;
+        }
+    }
+}
+
+// Used for the injection list of the scheduler and for the remote list of the workers, the lists are lock-free stacks
+// always emptied at once so they aren't affected by ABA
+static void fiber_scheduler_list_push(
+        fiber_t* _Atomic* list_head,
+        fiber_t* fiber) {
+    fiber_t* head = atomic_load_explicit(list_head, memory_order_relaxed);
+
+    do {
+        fiber->scheduler.next = head;
+    } while (!atomic_compare_exchange_weak_explicit(
+            list_head,
+            &head,
+            fiber,
+            memory_order_release,
+            memory_order_relaxed));
+}
+
+static fiber_t* fiber_scheduler_list_pop_all(
+        fiber_t* _Atomic* list_head) {
+    fiber_t* fiber;
+    fiber_t* fiber_reversed = NULL;
+
+    // Cheap check to avoid to bounce the cache line when there is nothing to pick up
+    if (atomic_load_explicit(list_head, memory_order_relaxed) == NULL) {
+        return NULL;
+    }
+
+    fiber = atomic_exchange_explicit(list_head, NULL, memory_order_acquire);
+
+    // The list is LIFO, reverse it to run the fibers in the spawn order
+    while (fiber) {
+        fiber_t* fiber_next = fiber->scheduler.next;
+        fiber->scheduler.next = fiber_reversed;
+        fiber_reversed = fiber;
+        fiber = fiber_next;
+    }
+
+    return fiber_reversed;
+}
+
+static void fiber_scheduler_worker_enqueue(
+        fiber_scheduler_worker_t* worker,
+        fiber_t* fiber) {
+    if (!fiber_scheduler_queue_push(&worker->queue, fiber)) {
+        fiber_scheduler_list_push(&worker->scheduler->injection_head, fiber);
+    }
+}
+
+static void fiber_scheduler_worker_wake(
+        fiber_scheduler_worker_t* worker) {
+    // Pairs with the fence in fiber_scheduler_worker_sleep, either the worker sees what has been pushed before the
+    // wake or the waker sees the sleeping flag
+    atomic_thread_fence(memory_order_seq_cst);
+
+    if (atomic_load_explicit(&worker->sleeping, memory_order_relaxed) == FIBER_SCHEDULER_WORKER_AWAKE) {
+        return;
+    }
+
+    uint32_t sleeping = atomic_exchange_explicit(&worker->sleeping, FIBER_SCHEDULER_WORKER_AWAKE, memory_order_seq_cst);
+
+    if (sleeping == FIBER_SCHEDULER_WORKER_SLEEPING_FUTEX) {
+        syscall(SYS_futex, &worker->sleeping, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+    } else if (sleeping == FIBER_SCHEDULER_WORKER_SLEEPING_IO) {
+        uint64_t value = 1;
+        if (write(worker->wakeup_fd, &value, sizeof(value)) != sizeof(value)) {
+            perror("write wakeup_fd");
+        }
+    }
+}
+
+static void fiber_scheduler_wake_one(
+        fiber_scheduler_t* scheduler) {
+    if (atomic_load_explicit(&scheduler->workers_sleeping_count, memory_order_relaxed) == 0) {
+        return;
+    }
+
+    for(uint32_t index = 0; index < scheduler->workers_count; index++) {
+        fiber_scheduler_worker_t* worker = &scheduler->workers[index];
+
+        if (atomic_load_explicit(&worker->sleeping, memory_order_relaxed) != FIBER_SCHEDULER_WORKER_AWAKE) {
+            fiber_scheduler_worker_wake(worker);
+            return;
+        }
+    }
+}
+
+static void fiber_scheduler_wake_all(
+        fiber_scheduler_t* scheduler) {
+    for(uint32_t index = 0; index < scheduler->workers_count; index++) {
+        fiber_scheduler_worker_wake(&scheduler->workers[index]);
+    }
+}
+
+static uint32_t fiber_scheduler_worker_advance_timers(
+        fiber_scheduler_worker_t* worker) {
+    // Avoids to read the clock when there are no timers, fiber_timer_arm brings an empty wheel up to date
+    if (worker->timer_wheel->timers_count == 0) {
+        return 0;
+    }
+
+    return fiber_timer_wheel_advance(worker->timer_wheel, fiber_timer_wheel_now_ns());
+}
+
+static void fiber_scheduler_worker_sleep(
+        fiber_scheduler_worker_t* worker) {
+    fiber_scheduler_t* scheduler = worker->scheduler;
+    bool io_pending = fiber_io_uring_has_pending();
+    uint64_t timeout_ns = UINT64_MAX;
+
+    // The sleep can't go past the next timer
+    if (worker->timer_wheel->timers_count > 0) {
+        timeout_ns = fiber_timer_wheel_next_timeout_ns(worker->timer_wheel, fiber_timer_wheel_now_ns());
+
+        if (timeout_ns == 0) {
+            return;
+        }
+    }
+
+    atomic_store_explicit(
+            &worker->sleeping,
+            io_pending ? FIBER_SCHEDULER_WORKER_SLEEPING_IO : FIBER_SCHEDULER_WORKER_SLEEPING_FUTEX,
+            memory_order_seq_cst);
+    atomic_fetch_add_explicit(&scheduler->workers_sleeping_count, 1, memory_order_seq_cst);
+    atomic_thread_fence(memory_order_seq_cst);
+
+    // The lists are checked again once the sleeping flag is visible to avoid to miss a wake up
+    if (atomic_load_explicit(&worker->remote_head, memory_order_relaxed) == NULL &&
+        atomic_load_explicit(&scheduler->injection_head, memory_order_relaxed) == NULL &&
+        atomic_load_explicit(&scheduler->fibers_active, memory_order_acquire) > 0) {
+        if (io_pending) {
+            // The wakeup eventfd is read through the ring, the worker wakes up either for a completion or for a write
+            // on the eventfd
+            fiber_io_uring_poll(true, timeout_ns);
+        } else {
+            struct timespec timeout_ts = {
+                    .tv_sec = (time_t)(timeout_ns / 1000000000ull),
+                    .tv_nsec = (long)(timeout_ns % 1000000000ull),
+            };
+
+            syscall(
+                    SYS_futex,
+                    &worker->sleeping,
+                    FUTEX_WAIT_PRIVATE,
+                    FIBER_SCHEDULER_WORKER_SLEEPING_FUTEX,
+                    timeout_ns == UINT64_MAX ? NULL : &timeout_ts,
+                    NULL,
+                    0);
+        }
+    }
+
+    atomic_fetch_sub_explicit(&scheduler->workers_sleeping_count, 1, memory_order_relaxed);
+    atomic_store_explicit(&worker->sleeping, FIBER_SCHEDULER_WORKER_AWAKE, memory_order_relaxed);
+}
+
+static fiber_t* fiber_scheduler_worker_steal(
+        fiber_scheduler_worker_t* worker) {
+    fiber_scheduler_t* scheduler = worker->scheduler;
+
+    if (scheduler->workers_count == 1) {
+        return NULL;
+    }
+
+    // xorshift64, start from a random victim to spread the thieves
+    worker->random_state ^= worker->random_state << 13;
+    worker->random_state ^= worker->random_state >> 7;
+    worker->random_state ^= worker->random_state << 17;
+
+    uint32_t victim_index = worker->random_state % scheduler->workers_count;
+    for(uint32_t attempt = 0; attempt < scheduler->workers_count; attempt++) {
+        fiber_scheduler_worker_t* victim = &scheduler->workers[(victim_index + attempt) % scheduler->workers_count];
+
+        if (victim == worker) {
+            continue;
+        }
+
+        fiber_t* fiber = fiber_scheduler_queue_pop(&victim->queue);
+        if (fiber) {
+            return fiber;
+        }
+    }
+
+    return NULL;
+}
+
+static fiber_t* fiber_scheduler_worker_take_list(
+        fiber_scheduler_worker_t* worker,
+        fiber_t* _Atomic* list_head) {
+    fiber_t* fiber;
+
+    if ((fiber = fiber_scheduler_list_pop_all(list_head)) != NULL) {
+        fiber_t* fiber_next = fiber->scheduler.next;
+
+        // Runs the first fiber straight away and moves the others to the local queue, the ones not fitting go to
+        // the injection list where the other workers can pick them up
+        while (fiber_next) {
+            fiber_t* fiber_enqueue = fiber_next;
+            fiber_next = fiber_next->scheduler.next;
+            fiber_scheduler_worker_enqueue(worker, fiber_enqueue);
+        }
+    }
+
+    return fiber;
+}
+
+static fiber_t* fiber_scheduler_worker_next(
+        fiber_scheduler_worker_t* worker) {
+    fiber_t* fiber;
+
+    if ((fiber = fiber_scheduler_queue_pop(&worker->queue)) != NULL) {
+        return fiber;
+    }
+
+    if ((fiber = fiber_scheduler_worker_take_list(worker, &worker->remote_head)) != NULL) {
+        return fiber;
+    }
+
+    if ((fiber = fiber_scheduler_worker_take_list(worker, &worker->scheduler->injection_head)) != NULL) {
+        return fiber;
+    }
+
+    return fiber_scheduler_worker_steal(worker);
+}
+
+static void fiber_scheduler_fiber_entrypoint(
+        fiber_t* fiber_from,
+        fiber_t* fiber_to) {
+    fiber_to->scheduler.entrypoint_fp(fiber_to->start_fp_user_data);
+
+    // The fiber might have been stolen in the meantime, fiber_from is not necessarily the context of the current worker
+    fiber_scheduler_worker_t* worker = fiber_scheduler_get_current_worker();
+    fiber_to->scheduler.state = FIBER_SCHEDULER_FIBER_STATE_TERMINATED;
+    fiber_context_swap(fiber_to, &worker->context);
+
+    // A terminated fiber is never resumed
+    abort();
+}
+
+static void* fiber_scheduler_worker_func(
+        void* user_data) {
+    cpu_set_t cpuset;
+    uint32_t idle_spin_count = 0;
+    uint64_t fibers_run_count = 0;
+    fiber_scheduler_worker_t* worker = user_data;
+    fiber_scheduler_t* scheduler = worker->scheduler;
+
+    CPU_ZERO(&cpuset);
+    CPU_SET(worker->core_index, &cpuset);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+
+    fiber_scheduler_worker_current = worker;
+    fiber_io_uring_thread_init(worker->wakeup_fd);
+
+    while (true) {
+        if (++fibers_run_count % FIBER_SCHEDULER_IO_POLL_INTERVAL == 0) {
+            fiber_io_uring_poll(false, 0);
+            fiber_scheduler_worker_advance_timers(worker);
+        }
+
+        fiber_t* fiber = fiber_scheduler_worker_next(worker);
+
+        if (fiber == NULL) {
+            if (atomic_load_explicit(&scheduler->fibers_active, memory_order_acquire) == 0) {
+                break;
+            }
+
+            // The expired timers resume their fibers on the local queue
+            if (fiber_scheduler_worker_advance_timers(worker) > 0) {
+                continue;
+            }
+
+            // Spins for a while before going to sleep, with I/O operations in flight there is no point in spinning
+            // and the worker sleeps straight away in io_uring_enter
+            if (!fiber_io_uring_has_pending() && ++idle_spin_count < FIBER_SCHEDULER_IDLE_SPIN_COUNT) {
+                if (idle_spin_count < FIBER_SCHEDULER_IDLE_PAUSE_COUNT) {
+                    __builtin_ia32_pause();
+                } else {
+                    sched_yield();
+                }
+
+                continue;
+            }
+
+            fiber_scheduler_worker_sleep(worker);
+            idle_spin_count = 0;
+
+            continue;
+        }
+
+        idle_spin_count = 0;
+
+        worker->fiber_current = fiber;
+        fiber->scheduler.worker = worker;
+        fiber->scheduler.state = FIBER_SCHEDULER_FIBER_STATE_RUNNING;
+
+        fiber_stats_swap_in(fiber);
+#if FIBER_STATS_ENABLED == 1
+        atomic_store_explicit(&worker->watchdog_fiber, fiber, memory_order_relaxed);
+        atomic_store_explicit(&worker->watchdog_swap_in_tsc, fiber->stats.swap_in_tsc, memory_order_release);
+#endif
+
+        fiber_context_swap(&worker->context, fiber);
+
+#if FIBER_STATS_ENABLED == 1
+        atomic_store_explicit(&worker->watchdog_swap_in_tsc, 0, memory_order_relaxed);
+#endif
+        fiber_stats_swap_out(fiber);
+
+        worker->fiber_current = NULL;
+
+        // The state is set by the fiber before switching back, the worker acts on it only once the fiber is not
+        // running anymore on its stack
+        switch (fiber->scheduler.state) {
+            case FIBER_SCHEDULER_FIBER_STATE_YIELDED:
+                fiber->scheduler.state = FIBER_SCHEDULER_FIBER_STATE_RUNNABLE;
+                fiber_scheduler_worker_enqueue(worker, fiber);
+                break;
+
+            case FIBER_SCHEDULER_FIBER_STATE_PARKED:
+                // The fiber is now owned by whoever is going to resume it
+                if (worker->park_callback_fp) {
+                    fiber_scheduler_park_callback_fp_t* park_callback_fp = worker->park_callback_fp;
+                    worker->park_callback_fp = NULL;
+                    park_callback_fp(worker->park_callback_user_data);
+                }
+                break;
+
+            case FIBER_SCHEDULER_FIBER_STATE_TERMINATED:
+                fiber_pool_release(scheduler->fiber_pool, fiber);
+                if (atomic_fetch_sub_explicit(&scheduler->fibers_active, 1, memory_order_release) == 1) {
+                    fiber_scheduler_wake_all(scheduler);
+                }
+                break;
+
+            default:
+                fprintf(stderr, "Fiber switched back to the scheduler with an unexpected state %u\n", fiber->scheduler.state);
+                exit(-1);
+        }
+    }
+
+    fiber_io_uring_thread_free();
+    fiber_scheduler_worker_current = NULL;
+
+    return NULL;
+}
+
+fiber_scheduler_t* fiber_scheduler_new(
+        uint32_t workers_count,
+        size_t stack_size) {
+    long cores_count = sysconf(_SC_NPROCESSORS_ONLN);
+    fiber_scheduler_t* scheduler = malloc(sizeof(fiber_scheduler_t));
+    memset(scheduler, 0, sizeof(fiber_scheduler_t));
+
+    scheduler->workers_count = workers_count;
+    // The stacks are committed lazily by the kernel so the idle fibers parked on the scheduler cost only the pages
+    // they have touched
+    scheduler->fiber_pool = fiber_pool_new(stack_size, FIBER_STACK_TYPE_MMAP, 0);
+    scheduler->workers = aligned_alloc(64, sizeof(fiber_scheduler_worker_t) * workers_count);
+
+    if (scheduler->workers == NULL) {
+        fprintf(stderr, "Unable to allocate the scheduler workers\n");
+        exit(-1);
+    }
+
+    memset(scheduler->workers, 0, sizeof(fiber_scheduler_worker_t) * workers_count);
+
+    for(uint32_t index = 0; index < workers_count; index++) {
+        fiber_scheduler_worker_t* worker = &scheduler->workers[index];
+        worker->scheduler = scheduler;
+        worker->index = index;
+        worker->core_index = index % cores_count;
+        worker->random_state = 0x9E3779B97F4A7C15ull * (index + 1);
+        worker->wakeup_fd = eventfd(0, EFD_CLOEXEC);
+        worker->timer_wheel = fiber_timer_wheel_new(FIBER_SCHEDULER_TIMER_TICK_NS, fiber_timer_wheel_now_ns());
+
+        if (worker->wakeup_fd < 0) {
+            perror("eventfd");
+            exit(-1);
+        }
+    }
+
+    return scheduler;
+}
+
+void fiber_scheduler_free(
+        fiber_scheduler_t* scheduler) {
+    for(uint32_t index = 0; index < scheduler->workers_count; index++) {
+        close(scheduler->workers[index].wakeup_fd);
+        fiber_timer_wheel_free(scheduler->workers[index].timer_wheel);
+    }
+
+    fiber_pool_free(scheduler->fiber_pool);
+    free(scheduler->workers);
+    free(scheduler);
+}
+
+#if FIBER_STATS_ENABLED == 1
+static void fiber_scheduler_watchdog_report(
+        uint32_t worker_index,
+        fiber_t* fiber,
+        uint64_t running_us,
+        void* user_data) {
+    fprintf(
+            stderr,
+            "Fiber %p on worker %u is running for %luus without yielding\n",
+            (void*)fiber,
+            worker_index,
+            running_us);
+}
+
+static void* fiber_scheduler_watchdog_func(
+        void* user_data) {
+    fiber_scheduler_t* scheduler = user_data;
+    uint64_t tsc_cycles_per_us = fiber_stats_tsc_cycles_per_us();
+    uint64_t threshold_cycles = scheduler->watchdog.threshold_us * tsc_cycles_per_us;
+
+    // Checks the workers twice per threshold, a long run is reported at most half a threshold late. With very low
+    // thresholds the watchdog would be spinning, it doesn't wake up more than once per
+    // FIBER_SCHEDULER_WATCHDOG_MIN_INTERVAL_NS
+    uint64_t interval_ns = scheduler->watchdog.threshold_us * 500;
+    if (interval_ns < FIBER_SCHEDULER_WATCHDOG_MIN_INTERVAL_NS) {
+        interval_ns = FIBER_SCHEDULER_WATCHDOG_MIN_INTERVAL_NS;
+    }
+    struct timespec interval = {
+            .tv_sec = (time_t)(interval_ns / 1000000000ull),
+            .tv_nsec = (long)(interval_ns % 1000000000ull),
+    };
+
+    while (!atomic_load_explicit(&scheduler->watchdog.stop, memory_order_acquire)) {
+        nanosleep(&interval, NULL);
+
+        for(uint32_t index = 0; index < scheduler->workers_count; index++) {
+            fiber_scheduler_worker_t* worker = &scheduler->workers[index];
+            uint64_t swap_in_tsc = atomic_load_explicit(&worker->watchdog_swap_in_tsc, memory_order_acquire);
+            fiber_t* fiber = atomic_load_explicit(&worker->watchdog_fiber, memory_order_relaxed);
+            uint64_t now_tsc = __rdtsc();
+
+            if (swap_in_tsc == 0 ||
+                swap_in_tsc == worker->watchdog_reported_swap_in_tsc ||
+                now_tsc - swap_in_tsc < threshold_cycles) {
+                continue;
+            }
+
+            // The fiber pointer is only an identifier, by the time the callback runs the fiber might be terminated
+            worker->watchdog_reported_swap_in_tsc = swap_in_tsc;
+            scheduler->watchdog.callback_fp(
+                    index,
+                    fiber,
+                    (now_tsc - swap_in_tsc) / tsc_cycles_per_us,
+                    scheduler->watchdog.callback_user_data);
+        }
+    }
+
+    return NULL;
+}
+
+void fiber_scheduler_set_watchdog(
+        fiber_scheduler_t* scheduler,
+        uint64_t threshold_us,
+        fiber_scheduler_watchdog_callback_fp_t* callback_fp,
+        void* callback_user_data) {
+    scheduler->watchdog.threshold_us = threshold_us;
+    scheduler->watchdog.callback_fp = callback_fp ? callback_fp : fiber_scheduler_watchdog_report;
+    scheduler->watchdog.callback_user_data = callback_user_data;
+}
+#endif
+
+void fiber_scheduler_run(
+        fiber_scheduler_t* scheduler) {
+    // The calling thread doesn't take part in the scheduling, it only waits for all the fibers to terminate
+    for(uint32_t index = 0; index < scheduler->workers_count; index++) {
+        fiber_scheduler_worker_t* worker = &scheduler->workers[index];
+
+        if (pthread_create(&worker->thread, NULL, fiber_scheduler_worker_func, worker) != 0) {
+            perror("pthread_create");
+            exit(-1);
+        }
+    }
+
+#if FIBER_STATS_ENABLED == 1
+    if (scheduler->watchdog.threshold_us > 0) {
+        atomic_store_explicit(&scheduler->watchdog.stop, false, memory_order_relaxed);
+        if (pthread_create(&scheduler->watchdog.thread, NULL, fiber_scheduler_watchdog_func, scheduler) != 0) {
+            perror("pthread_create");
+            exit(-1);
+        }
+    }
+#endif
+
+    for(uint32_t index = 0; index < scheduler->workers_count; index++) {
+        if (pthread_join(scheduler->workers[index].thread, NULL) != 0) {
+            perror("pthread_join");
+        }
+    }
+
+#if FIBER_STATS_ENABLED == 1
+    if (scheduler->watchdog.threshold_us > 0) {
+        atomic_store_explicit(&scheduler->watchdog.stop, true, memory_order_release);
+        if (pthread_join(scheduler->watchdog.thread, NULL) != 0) {
+            perror("pthread_join");
+        }
+    }
+#endif
+}
+
+void fiber_spawn(
+        fiber_scheduler_t* scheduler,
+        fiber_scheduler_entrypoint_fp_t* entrypoint_fp,
+        void* user_data) {
+    fiber_scheduler_worker_t* worker = fiber_scheduler_get_current_worker();
+    fiber_t* fiber = fiber_pool_acquire(scheduler->fiber_pool, fiber_scheduler_fiber_entrypoint, user_data);
+
+    fiber->scheduler.entrypoint_fp = entrypoint_fp;
+    fiber->scheduler.state = FIBER_SCHEDULER_FIBER_STATE_RUNNABLE;
+
+    atomic_fetch_add_explicit(&scheduler->fibers_active, 1, memory_order_relaxed);
+
+    if (worker != NULL && worker->scheduler == scheduler) {
+        fiber_scheduler_worker_enqueue(worker, fiber);
+    } else {
+        fiber_scheduler_list_push(&scheduler->injection_head, fiber);
+    }
+
+    fiber_scheduler_wake_one(scheduler);
+}
+
+void fiber_spawn_on_worker(
+        fiber_scheduler_t* scheduler,
+        uint32_t worker_index,
+        fiber_scheduler_entrypoint_fp_t* entrypoint_fp,
+        void* user_data) {
+    fiber_scheduler_worker_t* worker = &scheduler->workers[worker_index];
+    fiber_t* fiber = fiber_pool_acquire(scheduler->fiber_pool, fiber_scheduler_fiber_entrypoint, user_data);
+
+    fiber->scheduler.entrypoint_fp = entrypoint_fp;
+    fiber->scheduler.state = FIBER_SCHEDULER_FIBER_STATE_RUNNABLE;
+    fiber->scheduler.worker = worker;
+
+    atomic_fetch_add_explicit(&scheduler->fibers_active, 1, memory_order_relaxed);
+
+    fiber_scheduler_list_push(&worker->remote_head, fiber);
+    fiber_scheduler_worker_wake(worker);
+}
+
+void fiber_yield(void) {
+    fiber_scheduler_worker_t* worker = fiber_scheduler_get_current_worker();
+
+    if (worker == NULL || worker->fiber_current == NULL) {
+        return;
+    }
+
+    fiber_t* fiber = worker->fiber_current;
+    fiber->scheduler.state = FIBER_SCHEDULER_FIBER_STATE_YIELDED;
+    fiber_context_swap(fiber, &worker->context);
+}
+
+void fiber_park(void) {
+    fiber_scheduler_worker_t* worker = fiber_scheduler_get_current_worker();
+    fiber_t* fiber = worker->fiber_current;
+
+    fiber->scheduler.state = FIBER_SCHEDULER_FIBER_STATE_PARKED;
+    fiber_context_swap(fiber, &worker->context);
+}
+
+static void fiber_scheduler_sleep_timer_callback(
+        fiber_timer_t* timer,
+        void* user_data) {
+    fiber_resume(user_data);
+}
+
+void fiber_sleep(
+        uint64_t timeout_us) {
+    fiber_scheduler_worker_t* worker = fiber_scheduler_get_current_worker();
+
+    if (worker == NULL || worker->fiber_current == NULL) {
+        usleep(timeout_us);
+        return;
+    }
+
+    // The timer lives on the stack of the fiber, it's not touched anymore once the callback has been invoked
+    fiber_timer_t timer = { 0 };
+    uint64_t now_ns = fiber_timer_wheel_now_ns();
+    fiber_timer_arm(
+            worker->timer_wheel,
+            &timer,
+            now_ns,
+            now_ns + timeout_us * 1000,
+            fiber_scheduler_sleep_timer_callback,
+            worker->fiber_current);
+
+    fiber_park();
+}
+
+void fiber_park_with_callback(
+        fiber_scheduler_park_callback_fp_t* callback_fp,
+        void* callback_user_data) {
+    fiber_scheduler_worker_t* worker = fiber_scheduler_get_current_worker();
+    fiber_t* fiber = worker->fiber_current;
+
+    worker->park_callback_fp = callback_fp;
+    worker->park_callback_user_data = callback_user_data;
+    fiber->scheduler.state = FIBER_SCHEDULER_FIBER_STATE_PARKED;
+    fiber_context_swap(fiber, &worker->context);
+}
+
+void fiber_resume(
+        fiber_t* fiber) {
+    fiber_scheduler_worker_t* worker = fiber_scheduler_get_current_worker();
+    fiber_scheduler_worker_t* worker_owner = fiber->scheduler.worker;
+
+    fiber->scheduler.state = FIBER_SCHEDULER_FIBER_STATE_RUNNABLE;
+
+    if (worker == worker_owner) {
+        fiber_scheduler_worker_enqueue(worker, fiber);
+        return;
+    }
+
+    // Resumed from another worker or from a thread not managed by the scheduler, the fiber is handed over to the
+    // worker it was parked on through its remote list
+    fiber_scheduler_list_push(&worker_owner->remote_head, fiber);
+    fiber_scheduler_worker_wake(worker_owner);
+}
@@ -0,0 +1,115 @@
+#ifndef FIBER_SCHEDULER_H
+#define FIBER_SCHEDULER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "fiber.h"
+#include "fiber_timer_wheel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The local run queue of each worker is a bounded ring, the fibers that don't fit are moved to the shared injection
+// list of the scheduler
+#define FIBER_SCHEDULER_QUEUE_SIZE 4096
+
+// Number of fibers run by a worker between two non-blocking polls of the I/O completions and of the timers
+#define FIBER_SCHEDULER_IO_POLL_INTERVAL 64
+
+// Resolution of the timer wheel of the workers, fiber_sleep and the I/O timeouts are rounded up to it
+#define FIBER_SCHEDULER_TIMER_TICK_NS 100000
+
+enum fiber_scheduler_fiber_state {
+    FIBER_SCHEDULER_FIBER_STATE_RUNNABLE = 0,
+    FIBER_SCHEDULER_FIBER_STATE_RUNNING,
+    FIBER_SCHEDULER_FIBER_STATE_YIELDED,
+    FIBER_SCHEDULER_FIBER_STATE_PARKED,
+    FIBER_SCHEDULER_FIBER_STATE_TERMINATED,
+};
+
+typedef struct fiber_scheduler fiber_scheduler_t;
+typedef struct fiber_scheduler_worker fiber_scheduler_worker_t;
+
+fiber_scheduler_t* fiber_scheduler_new(
+        uint32_t workers_count,
+        size_t stack_size);
+
+void fiber_scheduler_free(
+        fiber_scheduler_t* scheduler);
+
+void fiber_scheduler_run(
+        fiber_scheduler_t* scheduler);
+
+// The fiber is owned by the scheduler and freed once the entrypoint returns, it can start to run on any worker before
+// fiber_spawn returns
+void fiber_spawn(
+        fiber_scheduler_t* scheduler,
+        fiber_scheduler_entrypoint_fp_t* entrypoint_fp,
+        void* user_data);
+
+// Runs the fiber on the given worker, it's the only fiber that won't be picked up by another worker on the first run
+void fiber_spawn_on_worker(
+        fiber_scheduler_t* scheduler,
+        uint32_t worker_index,
+        fiber_scheduler_entrypoint_fp_t* entrypoint_fp,
+        void* user_data);
+
+void fiber_yield(void);
+
+// Parks the fiber for at least timeout_us microseconds, outside of the scheduler the thread sleeps
+void fiber_sleep(
+        uint64_t timeout_us);
+
+// Switches back to the worker without enqueueing the fiber again, it's up to the caller to hand the fiber over to
+// something that will call fiber_resume
+void fiber_park(void);
+
+typedef void (fiber_scheduler_park_callback_fp_t)(void* user_data);
+
+// Same as fiber_park but the callback is invoked by the worker once the fiber has been switched out, it's used to
+// release a lock protecting a wait queue without risking a resume of a fiber still running on its own stack
+void fiber_park_with_callback(
+        fiber_scheduler_park_callback_fp_t* callback_fp,
+        void* callback_user_data);
+
+// Enqueues a parked fiber on the worker it was parked on, if called from a different worker or from a thread not
+// managed by the scheduler the fiber goes through the lock-free remote list of the worker, which is woken up if it's
+// sleeping
+void fiber_resume(
+        fiber_t* fiber);
+
+#if FIBER_STATS_ENABLED == 1
+typedef void (fiber_scheduler_watchdog_callback_fp_t)(
+        uint32_t worker_index,
+        fiber_t* fiber,
+        uint64_t running_us,
+        void* user_data);
+
+// Has to be called before fiber_scheduler_run, a thread checks the workers and invokes the callback once for every
+// fiber running for longer than threshold_us without switching back to the scheduler. If callback_fp is NULL the
+// fiber is reported on stderr, a threshold of 0 disables the watchdog. The workers are checked at most once per ms, the
+// fibers running for less than 1ms over the threshold might not be reported
+void fiber_scheduler_set_watchdog(
+        fiber_scheduler_t* scheduler,
+        uint64_t threshold_us,
+        fiber_scheduler_watchdog_callback_fp_t* callback_fp,
+        void* callback_user_data);
+#endif
+
+fiber_t* fiber_scheduler_get_current_fiber(void);
+
+fiber_scheduler_worker_t* fiber_scheduler_get_current_worker(void);
+
+fiber_timer_wheel_t* fiber_scheduler_worker_get_timer_wheel(
+        fiber_scheduler_worker_t* worker);
+
+uint32_t fiber_scheduler_worker_get_index(
+        fiber_scheduler_worker_t* worker);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //FIBER_SCHEDULER_H
@@ -0,0 +1,51 @@
+/**
+ * Copyright (C) 2020-2021 Daniele Salvatore Albano
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license.  See the LICENSE file for details.
+ **/
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <x86intrin.h>
+
+#include "fiber.h"
+#include "fiber_stats.h"
+
+#if FIBER_STATS_ENABLED == 1
+static uint64_t fiber_stats_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+uint64_t fiber_stats_tsc_cycles_per_us(void) {
+    static uint64_t tsc_cycles_per_us = 0;
+
+    if (tsc_cycles_per_us == 0) {
+        // 10ms are enough to get an error below 0.1% with an invariant tsc
+        uint64_t clock_start = fiber_stats_clock_ns();
+        uint64_t tsc_start = __rdtsc();
+        while (fiber_stats_clock_ns() - clock_start < 10000000) {
+            _mm_pause();
+        }
+        uint64_t clock_elapsed = fiber_stats_clock_ns() - clock_start;
+        uint64_t tsc_elapsed = __rdtsc() - tsc_start;
+
+        uint64_t value = (tsc_elapsed * 1000) / clock_elapsed;
+        tsc_cycles_per_us = value > 0 ? value : 1;
+    }
+
+    return tsc_cycles_per_us;
+}
+
+void fiber_stats_get(
+        fiber_t* fiber,
+        fiber_stats_t* stats) {
+    memcpy(stats, &fiber->stats, sizeof(fiber_stats_t));
+    stats->stack_used = fiber_stack_get_high_water_mark(fiber);
+}
+#endif
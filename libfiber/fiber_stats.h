@@ -0,0 +1,68 @@
+#ifndef FIBER_STATS_H
+#define FIBER_STATS_H
+
+#include <stdint.h>
+#include <x86intrin.h>
+
+#include "fiber.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Per-fiber instrumentation, enabled building with -DFIBER_STATS=ON (that defines FIBER_STATS_ENABLED). When disabled
+// the stats are not part of fiber_t and the hooks are empty, fiber_stats_context_swap is plain fiber_context_swap.
+
+#if FIBER_STATS_ENABLED == 1
+
+// Measured once with clock_gettime, used to convert the rdtsc deltas
+uint64_t fiber_stats_tsc_cycles_per_us(void);
+
+static inline __attribute__((always_inline)) void fiber_stats_swap_in(
+        fiber_t* fiber) {
+    fiber->stats.swaps_in++;
+    fiber->stats.swap_in_tsc = __rdtsc();
+}
+
+static inline __attribute__((always_inline)) void fiber_stats_swap_out(
+        fiber_t* fiber) {
+    uint64_t cycles_run = __rdtsc() - fiber->stats.swap_in_tsc;
+
+    fiber->stats.swaps_out++;
+    fiber->stats.cycles_on_cpu += cycles_run;
+    if (cycles_run > fiber->stats.cycles_longest_run) {
+        fiber->stats.cycles_longest_run = cycles_run;
+    }
+}
+
+// Copies the stats of the fiber and measures the stack used, it's not cheap for the mmap stacks
+void fiber_stats_get(
+        fiber_t* fiber,
+        fiber_stats_t* stats);
+
+#else
+
+static inline __attribute__((always_inline)) void fiber_stats_swap_in(
+        fiber_t* fiber) {
+}
+
+static inline __attribute__((always_inline)) void fiber_stats_swap_out(
+        fiber_t* fiber) {
+}
+
+#endif
+
+// fiber_context_swap with the stats of both the fibers updated
+static inline __attribute__((always_inline)) void fiber_stats_context_swap(
+        fiber_t* fiber_context_from,
+        fiber_t* fiber_context_to) {
+    fiber_stats_swap_out(fiber_context_from);
+    fiber_stats_swap_in(fiber_context_to);
+    fiber_context_swap(fiber_context_from, fiber_context_to);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //FIBER_STATS_H
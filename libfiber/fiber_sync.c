@@ -0,0 +1,307 @@
+/**
+ * Copyright (C) 2020-2021 Daniele Salvatore Albano
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license.  See the LICENSE file for details.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "fiber.h"
+#include "fiber_scheduler.h"
+#include "fiber_sync.h"
+
+static inline void fiber_sync_spinlock_lock(
+        uint8_t* spinlock) {
+    while (__atomic_exchange_n(spinlock, 1, __ATOMIC_ACQUIRE)) {
+        while (__atomic_load_n(spinlock, __ATOMIC_RELAXED)) {
+            __builtin_ia32_pause();
+        }
+    }
+}
+
+static inline void fiber_sync_spinlock_unlock(
+        uint8_t* spinlock) {
+    __atomic_store_n(spinlock, 0, __ATOMIC_RELEASE);
+}
+
+static void fiber_sync_spinlock_unlock_callback(
+        void* user_data) {
+    fiber_sync_spinlock_unlock(user_data);
+}
+
+static void fiber_sync_wait_queue_push(
+        fiber_sync_wait_queue_t* wait_queue,
+        fiber_sync_waiter_t* waiter) {
+    waiter->next = NULL;
+
+    if (wait_queue->tail) {
+        wait_queue->tail->next = waiter;
+    } else {
+        wait_queue->head = waiter;
+    }
+
+    wait_queue->tail = waiter;
+}
+
+static fiber_sync_waiter_t* fiber_sync_wait_queue_pop(
+        fiber_sync_wait_queue_t* wait_queue) {
+    fiber_sync_waiter_t* waiter = wait_queue->head;
+
+    if (waiter) {
+        wait_queue->head = waiter->next;
+        if (wait_queue->head == NULL) {
+            wait_queue->tail = NULL;
+        }
+    }
+
+    return waiter;
+}
+
+// The waiter lives on the stack of the parked fiber, once the fiber is resumed it's not accessible anymore
+static void fiber_sync_waiter_resume(
+        fiber_sync_waiter_t* waiter) {
+    fiber_resume(waiter->fiber);
+}
+
+static void fiber_sync_wait(
+        fiber_sync_wait_queue_t* wait_queue,
+        fiber_sync_waiter_t* waiter,
+        uint8_t* spinlock) {
+    waiter->fiber = fiber_scheduler_get_current_fiber();
+    fiber_sync_wait_queue_push(wait_queue, waiter);
+    fiber_park_with_callback(fiber_sync_spinlock_unlock_callback, spinlock);
+}
+
+void fiber_mutex_init(
+        fiber_mutex_t* mutex) {
+    memset(mutex, 0, sizeof(fiber_mutex_t));
+}
+
+void fiber_mutex_lock(
+        fiber_mutex_t* mutex) {
+    fiber_sync_waiter_t waiter = { 0 };
+
+    fiber_sync_spinlock_lock(&mutex->spinlock);
+
+    if (!mutex->locked) {
+        mutex->locked = true;
+        fiber_sync_spinlock_unlock(&mutex->spinlock);
+        return;
+    }
+
+    // When resumed the mutex has already been handed over by fiber_mutex_unlock
+    fiber_sync_wait(&mutex->waiters, &waiter, &mutex->spinlock);
+}
+
+bool fiber_mutex_trylock(
+        fiber_mutex_t* mutex) {
+    bool acquired = false;
+
+    fiber_sync_spinlock_lock(&mutex->spinlock);
+
+    if (!mutex->locked) {
+        mutex->locked = acquired = true;
+    }
+
+    fiber_sync_spinlock_unlock(&mutex->spinlock);
+
+    return acquired;
+}
+
+void fiber_mutex_unlock(
+        fiber_mutex_t* mutex) {
+    fiber_sync_spinlock_lock(&mutex->spinlock);
+
+    fiber_sync_waiter_t* waiter = fiber_sync_wait_queue_pop(&mutex->waiters);
+    if (waiter == NULL) {
+        mutex->locked = false;
+    }
+
+    fiber_sync_spinlock_unlock(&mutex->spinlock);
+
+    if (waiter) {
+        fiber_sync_waiter_resume(waiter);
+    }
+}
+
+void fiber_cond_init(
+        fiber_cond_t* cond) {
+    memset(cond, 0, sizeof(fiber_cond_t));
+}
+
+void fiber_cond_wait(
+        fiber_cond_t* cond,
+        fiber_mutex_t* mutex) {
+    fiber_sync_waiter_t waiter = { 0 };
+
+    // The mutex is released while holding the spinlock of the condition variable, a signal sent after the unlock
+    // can't get lost
+    fiber_sync_spinlock_lock(&cond->spinlock);
+    fiber_mutex_unlock(mutex);
+    fiber_sync_wait(&cond->waiters, &waiter, &cond->spinlock);
+
+    fiber_mutex_lock(mutex);
+}
+
+void fiber_cond_signal(
+        fiber_cond_t* cond) {
+    fiber_sync_spinlock_lock(&cond->spinlock);
+    fiber_sync_waiter_t* waiter = fiber_sync_wait_queue_pop(&cond->waiters);
+    fiber_sync_spinlock_unlock(&cond->spinlock);
+
+    if (waiter) {
+        fiber_sync_waiter_resume(waiter);
+    }
+}
+
+void fiber_cond_broadcast(
+        fiber_cond_t* cond) {
+    fiber_sync_spinlock_lock(&cond->spinlock);
+    fiber_sync_waiter_t* waiter = cond->waiters.head;
+    cond->waiters.head = cond->waiters.tail = NULL;
+    fiber_sync_spinlock_unlock(&cond->spinlock);
+
+    while (waiter) {
+        fiber_sync_waiter_t* waiter_next = waiter->next;
+        fiber_sync_waiter_resume(waiter);
+        waiter = waiter_next;
+    }
+}
+
+fiber_channel_t* fiber_channel_new(
+        uint32_t capacity) {
+    fiber_channel_t* channel = malloc(sizeof(fiber_channel_t));
+    memset(channel, 0, sizeof(fiber_channel_t));
+
+    channel->capacity = capacity;
+    channel->items = malloc(sizeof(void*) * (capacity > 0 ? capacity : 1));
+
+    return channel;
+}
+
+void fiber_channel_free(
+        fiber_channel_t* channel) {
+    free(channel->items);
+    free(channel);
+}
+
+bool fiber_channel_send(
+        fiber_channel_t* channel,
+        void* item) {
+    fiber_sync_waiter_t waiter = { 0 };
+
+    fiber_sync_spinlock_lock(&channel->spinlock);
+
+    if (channel->closed) {
+        fiber_sync_spinlock_unlock(&channel->spinlock);
+        return false;
+    }
+
+    // A waiting receiver implies an empty buffer, the item is handed over directly
+    fiber_sync_waiter_t* receiver = fiber_sync_wait_queue_pop(&channel->receivers);
+    if (receiver) {
+        receiver->item = item;
+        fiber_sync_spinlock_unlock(&channel->spinlock);
+        fiber_sync_waiter_resume(receiver);
+        return true;
+    }
+
+    if (channel->count < channel->capacity) {
+        channel->items[(channel->read_index + channel->count) % channel->capacity] = item;
+        channel->count++;
+        fiber_sync_spinlock_unlock(&channel->spinlock);
+        return true;
+    }
+
+    // The buffer is full, the receiver that frees up a slot moves the item in the buffer
+    waiter.item = item;
+    fiber_sync_wait(&channel->senders, &waiter, &channel->spinlock);
+
+    return !waiter.closed;
+}
+
+bool fiber_channel_recv(
+        fiber_channel_t* channel,
+        void** item) {
+    fiber_sync_waiter_t waiter = { 0 };
+
+    fiber_sync_spinlock_lock(&channel->spinlock);
+
+    if (channel->count > 0) {
+        *item = channel->items[channel->read_index];
+        channel->read_index = (channel->read_index + 1) % channel->capacity;
+        channel->count--;
+
+        fiber_sync_waiter_t* sender = fiber_sync_wait_queue_pop(&channel->senders);
+        if (sender) {
+            channel->items[(channel->read_index + channel->count) % channel->capacity] = sender->item;
+            channel->count++;
+        }
+
+        fiber_sync_spinlock_unlock(&channel->spinlock);
+
+        if (sender) {
+            fiber_sync_waiter_resume(sender);
+        }
+
+        return true;
+    }
+
+    // Unbuffered channel, the item is taken directly from the sender
+    fiber_sync_waiter_t* sender = fiber_sync_wait_queue_pop(&channel->senders);
+    if (sender) {
+        *item = sender->item;
+        fiber_sync_spinlock_unlock(&channel->spinlock);
+        fiber_sync_waiter_resume(sender);
+        return true;
+    }
+
+    if (channel->closed) {
+        fiber_sync_spinlock_unlock(&channel->spinlock);
+        return false;
+    }
+
+    fiber_sync_wait(&channel->receivers, &waiter, &channel->spinlock);
+
+    if (waiter.closed) {
+        return false;
+    }
+
+    *item = waiter.item;
+
+    return true;
+}
+
+void fiber_channel_close(
+        fiber_channel_t* channel) {
+    fiber_sync_spinlock_lock(&channel->spinlock);
+
+    channel->closed = true;
+    fiber_sync_waiter_t* receiver = channel->receivers.head;
+    fiber_sync_waiter_t* sender = channel->senders.head;
+    channel->receivers.head = channel->receivers.tail = NULL;
+    channel->senders.head = channel->senders.tail = NULL;
+
+    fiber_sync_spinlock_unlock(&channel->spinlock);
+
+    // The items of the senders still waiting are dropped
+    while (receiver) {
+        fiber_sync_waiter_t* receiver_next = receiver->next;
+        receiver->closed = true;
+        fiber_sync_waiter_resume(receiver);
+        receiver = receiver_next;
+    }
+
+    while (sender) {
+        fiber_sync_waiter_t* sender_next = sender->next;
+        sender->closed = true;
+        fiber_sync_waiter_resume(sender);
+        sender = sender_next;
+    }
+}
@@ -0,0 +1,106 @@
+#ifndef FIBER_SYNC_H
+#define FIBER_SYNC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "fiber.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Synchronization primitives for the fibers run by the scheduler, a fiber that has to wait is parked and the worker
+// moves on to the next fiber instead of blocking the thread. The internal state is protected by a spinlock held only
+// for a handful of instructions, it's released by the worker after the waiting fiber has been switched out.
+
+typedef struct fiber_sync_waiter fiber_sync_waiter_t;
+struct fiber_sync_waiter {
+    fiber_t* fiber;
+    fiber_sync_waiter_t* next;
+    void* item;
+    bool closed;
+};
+
+typedef struct fiber_sync_wait_queue fiber_sync_wait_queue_t;
+struct fiber_sync_wait_queue {
+    fiber_sync_waiter_t* head;
+    fiber_sync_waiter_t* tail;
+};
+
+typedef struct fiber_mutex fiber_mutex_t;
+struct fiber_mutex {
+    uint8_t spinlock;
+    bool locked;
+    fiber_sync_wait_queue_t waiters;
+};
+
+typedef struct fiber_cond fiber_cond_t;
+struct fiber_cond {
+    uint8_t spinlock;
+    fiber_sync_wait_queue_t waiters;
+};
+
+typedef struct fiber_channel fiber_channel_t;
+struct fiber_channel {
+    uint8_t spinlock;
+    bool closed;
+    uint32_t capacity;
+    uint32_t count;
+    uint32_t read_index;
+    void** items;
+    fiber_sync_wait_queue_t senders;
+    fiber_sync_wait_queue_t receivers;
+};
+
+void fiber_mutex_init(
+        fiber_mutex_t* mutex);
+
+void fiber_mutex_lock(
+        fiber_mutex_t* mutex);
+
+bool fiber_mutex_trylock(
+        fiber_mutex_t* mutex);
+
+// The ownership is handed over directly to the first waiter, if any
+void fiber_mutex_unlock(
+        fiber_mutex_t* mutex);
+
+void fiber_cond_init(
+        fiber_cond_t* cond);
+
+void fiber_cond_wait(
+        fiber_cond_t* cond,
+        fiber_mutex_t* mutex);
+
+void fiber_cond_signal(
+        fiber_cond_t* cond);
+
+void fiber_cond_broadcast(
+        fiber_cond_t* cond);
+
+// Bounded channel, safe with any number of producers and consumers
+fiber_channel_t* fiber_channel_new(
+        uint32_t capacity);
+
+void fiber_channel_free(
+        fiber_channel_t* channel);
+
+// Returns false if the channel has been closed
+bool fiber_channel_send(
+        fiber_channel_t* channel,
+        void* item);
+
+// Returns false once the channel has been closed and drained
+bool fiber_channel_recv(
+        fiber_channel_t* channel,
+        void** item);
+
+void fiber_channel_close(
+        fiber_channel_t* channel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //FIBER_SYNC_H
@@ -0,0 +1,215 @@
+/**
+ * Copyright (C) 2020-2021 Daniele Salvatore Albano
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license.  See the LICENSE file for details.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "fiber_timer_wheel.h"
+
+static void fiber_timer_wheel_link(
+        fiber_timer_t** slot,
+        fiber_timer_t* timer) {
+    timer->next = *slot;
+    timer->prev_next = slot;
+
+    if (timer->next) {
+        timer->next->prev_next = &timer->next;
+    }
+
+    *slot = timer;
+}
+
+static void fiber_timer_wheel_unlink(
+        fiber_timer_t* timer) {
+    *timer->prev_next = timer->next;
+
+    if (timer->next) {
+        timer->next->prev_next = timer->prev_next;
+    }
+
+    timer->next = NULL;
+    timer->prev_next = NULL;
+}
+
+static void fiber_timer_wheel_insert(
+        fiber_timer_wheel_t* wheel,
+        fiber_timer_t* timer) {
+    uint64_t delta = timer->expires_tick - wheel->current_tick;
+    uint32_t level = 0;
+
+    // The level is the first one able to hold the distance from the current tick, the slot is picked from the bits
+    // of the expiration tick covered by that level
+    while (level < FIBER_TIMER_WHEEL_LEVELS - 1 &&
+           delta >= (1ull << ((level + 1) * FIBER_TIMER_WHEEL_SLOTS_BITS))) {
+        level++;
+    }
+
+    uint32_t slot = (timer->expires_tick >> (level * FIBER_TIMER_WHEEL_SLOTS_BITS)) & FIBER_TIMER_WHEEL_SLOTS_MASK;
+    fiber_timer_wheel_link(&wheel->slots[level][slot], timer);
+}
+
+static void fiber_timer_wheel_cascade(
+        fiber_timer_wheel_t* wheel,
+        uint32_t level) {
+    uint32_t slot = (wheel->current_tick >> (level * FIBER_TIMER_WHEEL_SLOTS_BITS)) & FIBER_TIMER_WHEEL_SLOTS_MASK;
+    fiber_timer_t* timer = wheel->slots[level][slot];
+    wheel->slots[level][slot] = NULL;
+
+    while (timer) {
+        fiber_timer_t* timer_next = timer->next;
+        fiber_timer_wheel_insert(wheel, timer);
+        timer = timer_next;
+    }
+}
+
+uint64_t fiber_timer_wheel_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+fiber_timer_wheel_t* fiber_timer_wheel_new(
+        uint64_t tick_ns,
+        uint64_t now_ns) {
+    fiber_timer_wheel_t* wheel = malloc(sizeof(fiber_timer_wheel_t));
+
+    if (wheel == NULL) {
+        fprintf(stderr, "Unable to allocate the timer wheel\n");
+        exit(-1);
+    }
+
+    memset(wheel, 0, sizeof(fiber_timer_wheel_t));
+    wheel->tick_ns = tick_ns;
+    wheel->current_tick = now_ns / tick_ns;
+
+    return wheel;
+}
+
+void fiber_timer_wheel_free(
+        fiber_timer_wheel_t* wheel) {
+    free(wheel);
+}
+
+void fiber_timer_arm(
+        fiber_timer_wheel_t* wheel,
+        fiber_timer_t* timer,
+        uint64_t now_ns,
+        uint64_t expires_ns,
+        fiber_timer_callback_fp_t* callback_fp,
+        void* user_data) {
+    uint64_t expires_tick = (expires_ns + wheel->tick_ns - 1) / wheel->tick_ns;
+
+    if (fiber_timer_is_armed(timer)) {
+        fiber_timer_cancel(wheel, timer);
+    }
+
+    // The workers don't advance their wheel while it's empty, the current tick may be far behind: the delay would be
+    // measured from it and the next advance would walk, one tick at a time, all the ticks elapsed in the meantime.
+    // The advance of an empty wheel jumps straight to now.
+    if (wheel->timers_count == 0) {
+        fiber_timer_wheel_advance(wheel, now_ns);
+    }
+
+    // The current tick has already been processed, a timer in the past fires on the next one
+    if (expires_tick <= wheel->current_tick) {
+        expires_tick = wheel->current_tick + 1;
+    } else if (expires_tick - wheel->current_tick > FIBER_TIMER_WHEEL_MAX_TICKS) {
+        expires_tick = wheel->current_tick + FIBER_TIMER_WHEEL_MAX_TICKS;
+    }
+
+    timer->expires_tick = expires_tick;
+    timer->callback_fp = callback_fp;
+    timer->user_data = user_data;
+
+    fiber_timer_wheel_insert(wheel, timer);
+    wheel->timers_count++;
+}
+
+bool fiber_timer_cancel(
+        fiber_timer_wheel_t* wheel,
+        fiber_timer_t* timer) {
+    if (!fiber_timer_is_armed(timer)) {
+        return false;
+    }
+
+    fiber_timer_wheel_unlink(timer);
+    wheel->timers_count--;
+
+    return true;
+}
+
+uint32_t fiber_timer_wheel_advance(
+        fiber_timer_wheel_t* wheel,
+        uint64_t now_ns) {
+    uint64_t now_tick = now_ns / wheel->tick_ns;
+    uint32_t expired_count = 0;
+
+    while (wheel->current_tick < now_tick) {
+        // Without timers there is nothing to cascade or expire, the wheel can jump straight to now
+        if (wheel->timers_count == 0) {
+            wheel->current_tick = now_tick;
+            break;
+        }
+
+        wheel->current_tick++;
+
+        // When a level wraps around the slot of the level above matching the new position is moved down, starting
+        // from the highest level that wrapped
+        uint32_t levels_wrapped = 0;
+        while (levels_wrapped < FIBER_TIMER_WHEEL_LEVELS - 1 &&
+               (wheel->current_tick & ((1ull << ((levels_wrapped + 1) * FIBER_TIMER_WHEEL_SLOTS_BITS)) - 1)) == 0) {
+            levels_wrapped++;
+        }
+
+        for(uint32_t level = levels_wrapped; level > 0; level--) {
+            fiber_timer_wheel_cascade(wheel, level);
+        }
+
+        // The timers are unlinked one by one, a callback can safely cancel the other timers of the same slot
+        fiber_timer_t** slot = &wheel->slots[0][wheel->current_tick & FIBER_TIMER_WHEEL_SLOTS_MASK];
+        fiber_timer_t* timer;
+        while ((timer = *slot) != NULL) {
+            fiber_timer_wheel_unlink(timer);
+            wheel->timers_count--;
+            expired_count++;
+
+            timer->callback_fp(timer, timer->user_data);
+        }
+    }
+
+    return expired_count;
+}
+
+uint64_t fiber_timer_wheel_next_timeout_ns(
+        fiber_timer_wheel_t* wheel,
+        uint64_t now_ns) {
+    uint64_t next_tick;
+
+    if (wheel->timers_count == 0) {
+        return UINT64_MAX;
+    }
+
+    // Looks for the first non-empty slot of the first level up to the next wrap around, where a cascade can bring down
+    // the timers of the upper levels
+    next_tick = (wheel->current_tick | FIBER_TIMER_WHEEL_SLOTS_MASK) + 1;
+    for(uint64_t tick = wheel->current_tick + 1; tick < next_tick; tick++) {
+        if (wheel->slots[0][tick & FIBER_TIMER_WHEEL_SLOTS_MASK] != NULL) {
+            next_tick = tick;
+            break;
+        }
+    }
+
+    uint64_t next_ns = next_tick * wheel->tick_ns;
+
+    return next_ns > now_ns ? next_ns - now_ns : 0;
+}
@@ -0,0 +1,87 @@
+#ifndef FIBER_TIMER_WHEEL_H
+#define FIBER_TIMER_WHEEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Hierarchical timer wheel, every level has 256 slots and covers 256 times the range of the level below. Arming and
+// cancelling a timer are O(1), the timers of the upper levels are moved down (cascaded) when the lower level wraps
+// around. The wheel isn't thread safe, the scheduler gives one to each worker.
+#define FIBER_TIMER_WHEEL_LEVELS 4
+#define FIBER_TIMER_WHEEL_SLOTS_BITS 8
+#define FIBER_TIMER_WHEEL_SLOTS (1u << FIBER_TIMER_WHEEL_SLOTS_BITS)
+#define FIBER_TIMER_WHEEL_SLOTS_MASK (FIBER_TIMER_WHEEL_SLOTS - 1)
+// Timers further away than the range of the wheel are clamped to its end
+#define FIBER_TIMER_WHEEL_MAX_TICKS ((1ull << (FIBER_TIMER_WHEEL_LEVELS * FIBER_TIMER_WHEEL_SLOTS_BITS)) - 1)
+
+typedef struct fiber_timer fiber_timer_t;
+typedef struct fiber_timer_wheel fiber_timer_wheel_t;
+typedef void (fiber_timer_callback_fp_t)(fiber_timer_t* timer, void* user_data);
+
+// Owned by the caller, it has to stay valid until it expires or is cancelled
+struct fiber_timer {
+    fiber_timer_t* next;
+    // Points to the next field of the previous timer or to the slot, unlinking doesn't need to know the slot
+    fiber_timer_t** prev_next;
+    uint64_t expires_tick;
+    fiber_timer_callback_fp_t* callback_fp;
+    void* user_data;
+};
+
+struct fiber_timer_wheel {
+    uint64_t tick_ns;
+    uint64_t current_tick;
+    uint64_t timers_count;
+    fiber_timer_t* slots[FIBER_TIMER_WHEEL_LEVELS][FIBER_TIMER_WHEEL_SLOTS];
+};
+
+// CLOCK_MONOTONIC in nanoseconds, the time base used by the wheel
+uint64_t fiber_timer_wheel_now_ns(void);
+
+fiber_timer_wheel_t* fiber_timer_wheel_new(
+        uint64_t tick_ns,
+        uint64_t now_ns);
+
+void fiber_timer_wheel_free(
+        fiber_timer_wheel_t* wheel);
+
+// The timer fires on the first advance reaching expires_ns, rounded up to the tick, a timer already armed is moved.
+// A wheel without timers isn't necessarily advanced, it's brought to now_ns before arming the timer.
+void fiber_timer_arm(
+        fiber_timer_wheel_t* wheel,
+        fiber_timer_t* timer,
+        uint64_t now_ns,
+        uint64_t expires_ns,
+        fiber_timer_callback_fp_t* callback_fp,
+        void* user_data);
+
+// Returns false if the timer wasn't armed, e.g. because it has already expired
+bool fiber_timer_cancel(
+        fiber_timer_wheel_t* wheel,
+        fiber_timer_t* timer);
+
+static inline bool fiber_timer_is_armed(
+        fiber_timer_t* timer) {
+    return timer->prev_next != NULL;
+}
+
+// Invokes the callbacks of all the timers expired up to now_ns, the callbacks can arm and cancel timers
+uint32_t fiber_timer_wheel_advance(
+        fiber_timer_wheel_t* wheel,
+        uint64_t now_ns);
+
+// Nanoseconds from now_ns to the next advance that may expire a timer, it's exact for the timers due in the current
+// rotation of the first level and a lower bound otherwise. Returns UINT64_MAX if there are no timers armed.
+uint64_t fiber_timer_wheel_next_timeout_ns(
+        fiber_timer_wheel_t* wheel,
+        uint64_t now_ns);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //FIBER_TIMER_WHEEL_H
@@ -0,0 +1,383 @@
+/**
+ * Copyright (C) 2020-2021 Daniele Salvatore Albano
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license.  See the LICENSE file for details.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "hashtable_support_hash.h"
+#include "hashtable_support_hash_search.h"
+#include "hashtable_support_alloc.h"
+#include "hashtable.h"
+
+#define HASHTABLE_BUCKET_INDEX_NOT_FOUND UINT64_MAX
+
+static void* hashtable_alloc_aligned_zero(
+        size_t alignment,
+        size_t size) {
+    void* memptr = aligned_alloc(alignment, size);
+
+    if (memptr == NULL) {
+        fprintf(stderr, "Unable to allocate the requested memory %lu aligned to %lu\n", size, alignment);
+        exit(-1);
+    }
+
+    memset(memptr, 0, size);
+
+    return memptr;
+}
+
+// 4KB pages, the first access of each page costs a fault and the zeroing of 4KB instead of 2MB with the hugepages
+static const hashtable_support_alloc_policy_t hashtable_alloc_lazy_policy = {
+        .pages = HASHTABLE_SUPPORT_ALLOC_PAGES_4KB,
+        .numa = HASHTABLE_SUPPORT_ALLOC_NUMA_DEFAULT,
+        .first_touch_threads = 0,
+};
+
+static void* hashtable_alloc_lazy(
+        size_t size) {
+    void* memptr = hashtable_support_alloc(size, &hashtable_alloc_lazy_policy);
+
+    if (memptr == NULL) {
+        fprintf(stderr, "Unable to map the requested memory %lu\n", size);
+        exit(-1);
+    }
+
+    return memptr;
+}
+
+// Returns the bucket holding the key, if free_bucket_index isn't NULL it's set to the first empty or deleted bucket
+// met while searching, where the key can be inserted
+static uint64_t hashtable_search(
+        hashtable_t* hashtable,
+        hashtable_hash_t hash,
+        const char* key,
+        size_t key_length,
+        uint64_t* free_bucket_index) {
+    hashtable_half_hash_t half_hash = hashtable_half_hash_from_hash(hash);
+    uint64_t chunk_index = hash & hashtable->chunks_mask;
+    uint64_t chunks_to_search = hashtable->chunks_count < HASHTABLE_SEARCH_MAX_CHUNKS
+            ? hashtable->chunks_count
+            : HASHTABLE_SEARCH_MAX_CHUNKS;
+
+    if (free_bucket_index) {
+        *free_bucket_index = HASHTABLE_BUCKET_INDEX_NOT_FOUND;
+    }
+
+    for(uint64_t chunk_searched = 0; chunk_searched < chunks_to_search; chunk_searched++) {
+        hashtable_half_hashes_chunk_t* chunk = &hashtable->half_hashes_chunks[chunk_index];
+        uint64_t chunk_first_bucket_index = chunk_index * HASHTABLE_HALF_HASHES_CHUNK_SLOTS;
+        uint32_t chunk_slot_index;
+
+        // The mask is used in case of collisions, the colliding slots are excluded and the search repeated on the
+        // rest of the chunk
+        uint32_t skip_indexes_mask = 0;
+        while ((chunk_slot_index = hashtable_linear_search_16(
+                half_hash,
+                chunk->half_hashes,
+                skip_indexes_mask)) != HASHTABLE_MCMP_SUPPORT_HASH_SEARCH_NOT_FOUND) {
+            hashtable_key_value_t* key_value = &hashtable->keys_values[chunk_first_bucket_index + chunk_slot_index];
+
+            if (key_value->key_length == key_length && memcmp(key_value->key, key, key_length) == 0) {
+                return chunk_first_bucket_index + chunk_slot_index;
+            }
+
+            skip_indexes_mask |= 1u << chunk_slot_index;
+        }
+
+        uint32_t chunk_slot_index_empty = hashtable_linear_search_16(
+                HASHTABLE_HALF_HASH_EMPTY,
+                chunk->half_hashes,
+                0);
+
+        if (free_bucket_index && *free_bucket_index == HASHTABLE_BUCKET_INDEX_NOT_FOUND) {
+            uint32_t chunk_slot_index_tombstone = hashtable_linear_search_16(
+                    HASHTABLE_HALF_HASH_TOMBSTONE,
+                    chunk->half_hashes,
+                    0);
+            uint32_t chunk_slot_index_free = chunk_slot_index_empty < chunk_slot_index_tombstone
+                    ? chunk_slot_index_empty
+                    : chunk_slot_index_tombstone;
+
+            if (chunk_slot_index_free != HASHTABLE_MCMP_SUPPORT_HASH_SEARCH_NOT_FOUND) {
+                *free_bucket_index = chunk_first_bucket_index + chunk_slot_index_free;
+            }
+        }
+
+        // The keys are always inserted in the first free bucket, if the chunk has never been full the key can't be
+        // in the chunks after it
+        if (chunk_slot_index_empty != HASHTABLE_MCMP_SUPPORT_HASH_SEARCH_NOT_FOUND) {
+            break;
+        }
+
+        // Triangular probing, visits all the chunks when their number is a power of two and avoids the long runs of
+        // full chunks the linear probing builds up at the higher load factors
+        chunk_index = (chunk_index + chunk_searched + 1) & hashtable->chunks_mask;
+    }
+
+    return HASHTABLE_BUCKET_INDEX_NOT_FOUND;
+}
+
+static inline hashtable_half_hash_t* hashtable_bucket_half_hash(
+        hashtable_t* hashtable,
+        uint64_t bucket_index) {
+    return &hashtable->half_hashes_chunks[bucket_index / HASHTABLE_HALF_HASHES_CHUNK_SLOTS]
+            .half_hashes[bucket_index % HASHTABLE_HALF_HASHES_CHUNK_SLOTS];
+}
+
+static hashtable_t* hashtable_new_internal(
+        uint64_t buckets_count,
+        bool alloc_lazy) {
+    hashtable_t* hashtable = malloc(sizeof(hashtable_t));
+
+    if (buckets_count < HASHTABLE_HALF_HASHES_CHUNK_SLOTS) {
+        buckets_count = HASHTABLE_HALF_HASHES_CHUNK_SLOTS;
+    }
+
+    buckets_count = 1ull << (64 - __builtin_clzll(buckets_count - 1));
+
+    size_t half_hashes_chunks_size =
+            sizeof(hashtable_half_hashes_chunk_t) * (buckets_count / HASHTABLE_HALF_HASHES_CHUNK_SLOTS);
+    size_t keys_values_size = sizeof(hashtable_key_value_t) * buckets_count;
+
+    hashtable->buckets_count = buckets_count;
+    hashtable->chunks_count = buckets_count / HASHTABLE_HALF_HASHES_CHUNK_SLOTS;
+    hashtable->chunks_mask = hashtable->chunks_count - 1;
+    hashtable->count = 0;
+    hashtable->alloc_lazy = alloc_lazy;
+    hashtable->half_hashes_chunks = alloc_lazy
+            ? hashtable_alloc_lazy(half_hashes_chunks_size)
+            : hashtable_alloc_aligned_zero(64, half_hashes_chunks_size);
+    hashtable->keys_values = alloc_lazy
+            ? hashtable_alloc_lazy(keys_values_size)
+            : hashtable_alloc_aligned_zero(64, keys_values_size);
+
+    return hashtable;
+}
+
+hashtable_t* hashtable_new(
+        uint64_t buckets_count) {
+    return hashtable_new_internal(buckets_count, false);
+}
+
+hashtable_t* hashtable_new_lazy(
+        uint64_t buckets_count) {
+    return hashtable_new_internal(buckets_count, true);
+}
+
+void hashtable_free(
+        hashtable_t* hashtable) {
+    // The scan is skipped when there are no keys to free, e.g. once a resize has migrated all of them
+    for(uint64_t bucket_index = 0; hashtable->count > 0 && bucket_index < hashtable->buckets_count; bucket_index++) {
+        if (*hashtable_bucket_half_hash(hashtable, bucket_index) & HASHTABLE_HALF_HASH_FILLED) {
+            free(hashtable->keys_values[bucket_index].key);
+        }
+    }
+
+    if (hashtable->alloc_lazy) {
+        hashtable_support_alloc_free(
+                hashtable->half_hashes_chunks,
+                sizeof(hashtable_half_hashes_chunk_t) * hashtable->chunks_count,
+                &hashtable_alloc_lazy_policy);
+        hashtable_support_alloc_free(
+                hashtable->keys_values,
+                sizeof(hashtable_key_value_t) * hashtable->buckets_count,
+                &hashtable_alloc_lazy_policy);
+    } else {
+        free(hashtable->half_hashes_chunks);
+        free(hashtable->keys_values);
+    }
+
+    free(hashtable);
+}
+
+bool hashtable_insert(
+        hashtable_t* hashtable,
+        const char* key,
+        size_t key_length,
+        uintptr_t value) {
+    uint64_t free_bucket_index;
+    hashtable_hash_t hash = hashtable_support_hash_calculate(key, key_length);
+
+    if (hashtable_search(hashtable, hash, key, key_length, &free_bucket_index) != HASHTABLE_BUCKET_INDEX_NOT_FOUND) {
+        return false;
+    }
+
+    if (free_bucket_index == HASHTABLE_BUCKET_INDEX_NOT_FOUND) {
+        return false;
+    }
+
+    hashtable_key_value_t* key_value = &hashtable->keys_values[free_bucket_index];
+    key_value->key = malloc(key_length);
+    memcpy(key_value->key, key, key_length);
+    key_value->key_length = key_length;
+    key_value->value = value;
+
+    *hashtable_bucket_half_hash(hashtable, free_bucket_index) = hashtable_half_hash_from_hash(hash);
+    hashtable->count++;
+
+    return true;
+}
+
+bool hashtable_insert_key_value(
+        hashtable_t* hashtable,
+        hashtable_hash_t hash,
+        hashtable_key_value_t* key_value) {
+    uint64_t free_bucket_index;
+
+    hashtable_search(hashtable, hash, key_value->key, key_value->key_length, &free_bucket_index);
+
+    if (free_bucket_index == HASHTABLE_BUCKET_INDEX_NOT_FOUND) {
+        return false;
+    }
+
+    hashtable->keys_values[free_bucket_index] = *key_value;
+    *hashtable_bucket_half_hash(hashtable, free_bucket_index) = hashtable_half_hash_from_hash(hash);
+    hashtable->count++;
+
+    return true;
+}
+
+bool hashtable_lookup(
+        hashtable_t* hashtable,
+        const char* key,
+        size_t key_length,
+        uintptr_t* value) {
+    hashtable_hash_t hash = hashtable_support_hash_calculate(key, key_length);
+    uint64_t bucket_index = hashtable_search(hashtable, hash, key, key_length, NULL);
+
+    if (bucket_index == HASHTABLE_BUCKET_INDEX_NOT_FOUND) {
+        return false;
+    }
+
+    *value = hashtable->keys_values[bucket_index].value;
+
+    return true;
+}
+
+uint32_t hashtable_lookup_many(
+        hashtable_t* hashtable,
+        const char** keys,
+        const size_t* keys_length,
+        uint32_t count,
+        uintptr_t* values,
+        bool* found) {
+    hashtable_hash_t hashes[HASHTABLE_LOOKUP_MANY_GROUP_SIZE];
+    uint64_t candidate_bucket_indexes[HASHTABLE_LOOKUP_MANY_GROUP_SIZE];
+    uint32_t found_count = 0;
+
+    for(uint32_t group_start = 0; group_start < count; group_start += HASHTABLE_LOOKUP_MANY_GROUP_SIZE) {
+        uint32_t group_size = count - group_start < HASHTABLE_LOOKUP_MANY_GROUP_SIZE
+                ? count - group_start
+                : HASHTABLE_LOOKUP_MANY_GROUP_SIZE;
+        const char** group_keys = keys + group_start;
+        const size_t* group_keys_length = keys_length + group_start;
+
+        // Stage 1, hashes the keys and prefetches the first chunk of each key
+        for(uint32_t index = 0; index < group_size; index++) {
+            hashes[index] = hashtable_support_hash_calculate(group_keys[index], group_keys_length[index]);
+            __builtin_prefetch(&hashtable->half_hashes_chunks[hashes[index] & hashtable->chunks_mask], 0, 3);
+        }
+
+        // With a single key there is nothing to overlap, the stages 2 and 3 would only serialize the cache misses
+        // the search goes through anyway
+        if (group_size > 1) {
+            // Stage 2, searches the first chunk and prefetches the bucket of the first matching half hash, most of the
+            // keys are found there
+            for(uint32_t index = 0; index < group_size; index++) {
+                uint64_t chunk_index = hashes[index] & hashtable->chunks_mask;
+                uint32_t chunk_slot_index = hashtable_linear_search_16(
+                        hashtable_half_hash_from_hash(hashes[index]),
+                        hashtable->half_hashes_chunks[chunk_index].half_hashes,
+                        0);
+
+                candidate_bucket_indexes[index] = HASHTABLE_BUCKET_INDEX_NOT_FOUND;
+                if (chunk_slot_index != HASHTABLE_MCMP_SUPPORT_HASH_SEARCH_NOT_FOUND) {
+                    candidate_bucket_indexes[index] =
+                            chunk_index * HASHTABLE_HALF_HASHES_CHUNK_SLOTS + chunk_slot_index;
+                    __builtin_prefetch(&hashtable->keys_values[candidate_bucket_indexes[index]], 0, 3);
+                }
+            }
+
+            // Stage 3, prefetches the keys stored in the candidate buckets
+            for(uint32_t index = 0; index < group_size; index++) {
+                if (candidate_bucket_indexes[index] != HASHTABLE_BUCKET_INDEX_NOT_FOUND) {
+                    __builtin_prefetch(hashtable->keys_values[candidate_bucket_indexes[index]].key, 0, 3);
+                }
+            }
+        }
+
+        // Stage 4, the actual search, the memory it touches for the common case is already in the cache
+        for(uint32_t index = 0; index < group_size; index++) {
+            uint64_t bucket_index = hashtable_search(
+                    hashtable,
+                    hashes[index],
+                    group_keys[index],
+                    group_keys_length[index],
+                    NULL);
+
+            found[group_start + index] = bucket_index != HASHTABLE_BUCKET_INDEX_NOT_FOUND;
+            if (found[group_start + index]) {
+                values[group_start + index] = hashtable->keys_values[bucket_index].value;
+                found_count++;
+            }
+        }
+    }
+
+    return found_count;
+}
+
+bool hashtable_update(
+        hashtable_t* hashtable,
+        const char* key,
+        size_t key_length,
+        uintptr_t value) {
+    hashtable_hash_t hash = hashtable_support_hash_calculate(key, key_length);
+    uint64_t bucket_index = hashtable_search(hashtable, hash, key, key_length, NULL);
+
+    if (bucket_index == HASHTABLE_BUCKET_INDEX_NOT_FOUND) {
+        return false;
+    }
+
+    hashtable->keys_values[bucket_index].value = value;
+
+    return true;
+}
+
+bool hashtable_delete(
+        hashtable_t* hashtable,
+        const char* key,
+        size_t key_length) {
+    hashtable_hash_t hash = hashtable_support_hash_calculate(key, key_length);
+    uint64_t bucket_index = hashtable_search(hashtable, hash, key, key_length, NULL);
+
+    if (bucket_index == HASHTABLE_BUCKET_INDEX_NOT_FOUND) {
+        return false;
+    }
+
+    hashtable_key_value_t* key_value = &hashtable->keys_values[bucket_index];
+    free(key_value->key);
+    memset(key_value, 0, sizeof(hashtable_key_value_t));
+
+    // The bucket can be marked as empty only if the chunk has never been full, otherwise a key inserted after it might
+    // have been pushed to the following chunks and the search has to go on
+    hashtable_half_hashes_chunk_t* chunk = &hashtable->half_hashes_chunks[bucket_index / HASHTABLE_HALF_HASHES_CHUNK_SLOTS];
+    bool chunk_has_empty = hashtable_linear_search_16(
+            HASHTABLE_HALF_HASH_EMPTY,
+            chunk->half_hashes,
+            0) != HASHTABLE_MCMP_SUPPORT_HASH_SEARCH_NOT_FOUND;
+
+    *hashtable_bucket_half_hash(hashtable, bucket_index) = chunk_has_empty
+            ? HASHTABLE_HALF_HASH_EMPTY
+            : HASHTABLE_HALF_HASH_TOMBSTONE;
+    hashtable->count--;
+
+    return true;
+}
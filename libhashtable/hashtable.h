@@ -0,0 +1,117 @@
+#ifndef HASHTABLE_H
+#define HASHTABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "hashtable_support_hash.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The half hashes are grouped in chunks of 16, one cache line, searched at once by hashtable_linear_search_16.
+// A key is looked for in the chunk selected by the lower bits of the hash and then in the chunks picked by triangular
+// probing, up to HASHTABLE_SEARCH_MAX_CHUNKS, the search stops at the first chunk having an empty slot.
+#define HASHTABLE_HALF_HASHES_CHUNK_SLOTS 16
+#define HASHTABLE_SEARCH_MAX_CHUNKS 64
+
+// The filled bit is always set in the half hash of a key so 0 and the tombstone never match a key
+#define HASHTABLE_HALF_HASH_EMPTY 0u
+#define HASHTABLE_HALF_HASH_TOMBSTONE 1u
+#define HASHTABLE_HALF_HASH_FILLED 0x80000000u
+
+typedef struct hashtable_half_hashes_chunk hashtable_half_hashes_chunk_t;
+struct hashtable_half_hashes_chunk {
+    hashtable_half_hash_t half_hashes[HASHTABLE_HALF_HASHES_CHUNK_SLOTS];
+} __attribute__((aligned(64)));
+
+// The key is copied on insert and freed on delete
+typedef struct hashtable_key_value hashtable_key_value_t;
+struct hashtable_key_value {
+    char* key;
+    uint32_t key_length;
+    uintptr_t value;
+};
+
+typedef struct hashtable hashtable_t;
+struct hashtable {
+    uint64_t buckets_count;
+    uint64_t chunks_count;
+    uint64_t chunks_mask;
+    uint64_t count;
+    hashtable_half_hashes_chunk_t* half_hashes_chunks;
+    hashtable_key_value_t* keys_values;
+    bool alloc_lazy;
+};
+
+static inline hashtable_half_hash_t hashtable_half_hash_from_hash(
+        hashtable_hash_t hash) {
+    return (hashtable_half_hash_t)(hash >> 32) | HASHTABLE_HALF_HASH_FILLED;
+}
+
+// buckets_count is rounded up to a power of two, with at least one chunk
+hashtable_t* hashtable_new(
+        uint64_t buckets_count);
+
+// Same as hashtable_new but the arrays are mapped with hashtable_support_alloc and zeroed by the kernel page by page on
+// the first access instead of upfront, the cost of allocating a large hashtable is spread over the operations
+hashtable_t* hashtable_new_lazy(
+        uint64_t buckets_count);
+
+void hashtable_free(
+        hashtable_t* hashtable);
+
+// Returns false if the key already exists or if there are no free buckets in the chunks it can be stored in
+bool hashtable_insert(
+        hashtable_t* hashtable,
+        const char* key,
+        size_t key_length,
+        uintptr_t value);
+
+// Stores a key value taken from another hashtable, used to migrate the keys when resizing. The key isn't copied, the
+// hashtable takes the ownership of it, and must not be already in the hashtable. Returns false if there are no free
+// buckets in the chunks the key can be stored in.
+bool hashtable_insert_key_value(
+        hashtable_t* hashtable,
+        hashtable_hash_t hash,
+        hashtable_key_value_t* key_value);
+
+bool hashtable_lookup(
+        hashtable_t* hashtable,
+        const char* key,
+        size_t key_length,
+        uintptr_t* value);
+
+// Looks up count keys at once, found and values are set for each key as hashtable_lookup would do, returns the number
+// of keys found. The keys are processed in groups of HASHTABLE_LOOKUP_MANY_GROUP_SIZE, the memory accessed by each
+// stage of the search (the chunk, the bucket and the key) is prefetched for the whole group before being used so the
+// cache misses of the different keys overlap instead of being paid one after the other.
+#define HASHTABLE_LOOKUP_MANY_GROUP_SIZE 64
+
+uint32_t hashtable_lookup_many(
+        hashtable_t* hashtable,
+        const char** keys,
+        const size_t* keys_length,
+        uint32_t count,
+        uintptr_t* values,
+        bool* found);
+
+// Returns false if the key doesn't exist
+bool hashtable_update(
+        hashtable_t* hashtable,
+        const char* key,
+        size_t key_length,
+        uintptr_t value);
+
+bool hashtable_delete(
+        hashtable_t* hashtable,
+        const char* key,
+        size_t key_length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //HASHTABLE_H
@@ -0,0 +1,165 @@
+/**
+ * Copyright (C) 2020-2021 Daniele Salvatore Albano
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license.  See the LICENSE file for details.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sched.h>
+
+#include "hashtable_epoch.h"
+
+#define HASHTABLE_EPOCH_INACTIVE 0
+
+typedef struct hashtable_epoch_thread hashtable_epoch_thread_t;
+struct hashtable_epoch_thread {
+    uint64_t epoch;
+    bool used;
+    uint32_t nesting;
+    uint32_t retired_since_collect;
+    hashtable_epoch_retired_t* retired_head;
+    hashtable_epoch_retired_t* retired_tail;
+} __attribute__((aligned(64)));
+
+// The epochs start from 1, 0 marks the threads outside of a critical section
+static uint64_t hashtable_epoch_global __attribute__((aligned(64))) = 1;
+static hashtable_epoch_thread_t hashtable_epoch_threads[HASHTABLE_EPOCH_THREADS_MAX];
+static __thread hashtable_epoch_thread_t* hashtable_epoch_thread_current = NULL;
+
+static hashtable_epoch_thread_t* hashtable_epoch_thread_register(void) {
+    for(uint32_t index = 0; index < HASHTABLE_EPOCH_THREADS_MAX; index++) {
+        bool expected = false;
+        if (__atomic_compare_exchange_n(
+                &hashtable_epoch_threads[index].used,
+                &expected,
+                true,
+                false,
+                __ATOMIC_ACQ_REL,
+                __ATOMIC_RELAXED)) {
+            hashtable_epoch_thread_current = &hashtable_epoch_threads[index];
+            return hashtable_epoch_thread_current;
+        }
+    }
+
+    fprintf(stderr, "Unable to register the thread, more than %d threads are using the hashtable\n",
+            HASHTABLE_EPOCH_THREADS_MAX);
+    exit(-1);
+}
+
+static bool hashtable_epoch_try_advance(void) {
+    uint64_t epoch = __atomic_load_n(&hashtable_epoch_global, __ATOMIC_SEQ_CST);
+
+    for(uint32_t index = 0; index < HASHTABLE_EPOCH_THREADS_MAX; index++) {
+        hashtable_epoch_thread_t* thread = &hashtable_epoch_threads[index];
+        if (!__atomic_load_n(&thread->used, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+
+        uint64_t thread_epoch = __atomic_load_n(&thread->epoch, __ATOMIC_SEQ_CST);
+        if (thread_epoch != HASHTABLE_EPOCH_INACTIVE && thread_epoch != epoch) {
+            return false;
+        }
+    }
+
+    // Fails if another thread has already advanced it, which is as good
+    __atomic_compare_exchange_n(
+            &hashtable_epoch_global,
+            &epoch,
+            epoch + 1,
+            false,
+            __ATOMIC_SEQ_CST,
+            __ATOMIC_SEQ_CST);
+
+    return true;
+}
+
+static void hashtable_epoch_collect(
+        hashtable_epoch_thread_t* thread) {
+    hashtable_epoch_try_advance();
+    uint64_t epoch = __atomic_load_n(&hashtable_epoch_global, __ATOMIC_SEQ_CST);
+
+    // The list is ordered by epoch, the oldest are at the head
+    while (thread->retired_head && thread->retired_head->epoch + 2 <= epoch) {
+        hashtable_epoch_retired_t* retired = thread->retired_head;
+        thread->retired_head = retired->next;
+        free(retired);
+    }
+
+    if (thread->retired_head == NULL) {
+        thread->retired_tail = NULL;
+    }
+
+    thread->retired_since_collect = 0;
+}
+
+void hashtable_epoch_thread_free(void) {
+    hashtable_epoch_thread_t* thread = hashtable_epoch_thread_current;
+
+    if (thread == NULL) {
+        return;
+    }
+
+    while (thread->retired_head) {
+        hashtable_epoch_collect(thread);
+        if (thread->retired_head) {
+            sched_yield();
+        }
+    }
+
+    thread->nesting = 0;
+    __atomic_store_n(&thread->epoch, HASHTABLE_EPOCH_INACTIVE, __ATOMIC_RELEASE);
+    __atomic_store_n(&thread->used, false, __ATOMIC_RELEASE);
+    hashtable_epoch_thread_current = NULL;
+}
+
+void hashtable_epoch_enter(void) {
+    hashtable_epoch_thread_t* thread = hashtable_epoch_thread_current;
+
+    if (__builtin_expect(thread == NULL, false)) {
+        thread = hashtable_epoch_thread_register();
+    }
+
+    if (thread->nesting++ > 0) {
+        return;
+    }
+
+    // The store has to be visible before any access to the shared memory, a plain release store could be reordered
+    // after the following loads
+    __atomic_store_n(&thread->epoch, __atomic_load_n(&hashtable_epoch_global, __ATOMIC_RELAXED), __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+void hashtable_epoch_exit(void) {
+    hashtable_epoch_thread_t* thread = hashtable_epoch_thread_current;
+
+    if (--thread->nesting > 0) {
+        return;
+    }
+
+    __atomic_store_n(&thread->epoch, HASHTABLE_EPOCH_INACTIVE, __ATOMIC_RELEASE);
+
+    if (thread->retired_since_collect >= HASHTABLE_EPOCH_COLLECT_INTERVAL) {
+        hashtable_epoch_collect(thread);
+    }
+}
+
+void hashtable_epoch_retire(
+        hashtable_epoch_retired_t* retired) {
+    hashtable_epoch_thread_t* thread = hashtable_epoch_thread_current;
+
+    retired->next = NULL;
+    retired->epoch = __atomic_load_n(&hashtable_epoch_global, __ATOMIC_SEQ_CST);
+
+    if (thread->retired_tail) {
+        thread->retired_tail->next = retired;
+    } else {
+        thread->retired_head = retired;
+    }
+    thread->retired_tail = retired;
+    thread->retired_since_collect++;
+}
@@ -0,0 +1,44 @@
+#ifndef HASHTABLE_EPOCH_H
+#define HASHTABLE_EPOCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Epoch based memory reclamation for the lock-free readers of hashtable_mcmp. A thread enters a critical section
+// before touching the shared memory and exits it when done, the memory unlinked by the writers is retired and freed
+// only once every thread that was in a critical section when it was retired has exited it.
+//
+// The global epoch advances when all the threads in a critical section have observed the current one, the memory
+// retired in the epoch e can be freed once the global epoch reaches e + 2.
+
+#define HASHTABLE_EPOCH_THREADS_MAX 1024
+#define HASHTABLE_EPOCH_COLLECT_INTERVAL 64
+
+// Has to be the first member of the retired structs, they are released with free
+typedef struct hashtable_epoch_retired hashtable_epoch_retired_t;
+struct hashtable_epoch_retired {
+    hashtable_epoch_retired_t* next;
+    uint64_t epoch;
+};
+
+// The threads are registered on their first critical section, hashtable_epoch_thread_free has to be called before a
+// thread terminates, it waits until all the memory it retired can be freed
+void hashtable_epoch_thread_free(void);
+
+void hashtable_epoch_enter(void);
+
+void hashtable_epoch_exit(void);
+
+// Has to be called from within a critical section
+void hashtable_epoch_retire(
+        hashtable_epoch_retired_t* retired);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //HASHTABLE_EPOCH_H
@@ -0,0 +1,338 @@
+/**
+ * Copyright (C) 2020-2021 Daniele Salvatore Albano
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license.  See the LICENSE file for details.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "hashtable_support_hash.h"
+#include "hashtable_support_hash_search.h"
+#include "hashtable_epoch.h"
+#include "hashtable.h"
+#include "hashtable_mcmp.h"
+
+#define HASHTABLE_MCMP_BUCKET_INDEX_NOT_FOUND UINT64_MAX
+
+static void* hashtable_mcmp_alloc_aligned_zero(
+        size_t alignment,
+        size_t size) {
+    void* memptr = aligned_alloc(alignment, size);
+
+    if (memptr == NULL) {
+        fprintf(stderr, "Unable to allocate the requested memory %lu aligned to %lu\n", size, alignment);
+        exit(-1);
+    }
+
+    memset(memptr, 0, size);
+
+    return memptr;
+}
+
+static inline void hashtable_mcmp_chunk_lock(
+        hashtable_mcmp_t* hashtable,
+        uint64_t chunk_index) {
+    uint8_t* spinlock = &hashtable->chunks_locks[chunk_index];
+
+    if (__builtin_expect(!__atomic_exchange_n(spinlock, 1, __ATOMIC_ACQUIRE), true)) {
+        return;
+    }
+
+    __atomic_fetch_add(&hashtable->chunks_locks_contended, 1, __ATOMIC_RELAXED);
+
+    do {
+        while (__atomic_load_n(spinlock, __ATOMIC_RELAXED)) {
+            __builtin_ia32_pause();
+        }
+    } while (__atomic_exchange_n(spinlock, 1, __ATOMIC_ACQUIRE));
+}
+
+static inline void hashtable_mcmp_chunk_unlock(
+        hashtable_mcmp_t* hashtable,
+        uint64_t chunk_index) {
+    __atomic_store_n(&hashtable->chunks_locks[chunk_index], 0, __ATOMIC_RELEASE);
+}
+
+static inline hashtable_half_hash_t* hashtable_mcmp_bucket_half_hash(
+        hashtable_mcmp_t* hashtable,
+        uint64_t bucket_index) {
+    return &hashtable->half_hashes_chunks[bucket_index / HASHTABLE_HALF_HASHES_CHUNK_SLOTS]
+            .half_hashes[bucket_index % HASHTABLE_HALF_HASHES_CHUNK_SLOTS];
+}
+
+// Same search of hashtable_t, the half hashes and the key values can change under its feet: a matching half hash can
+// point to a key value being deleted, already gone or belonging to a key inserted in the meantime, the key is always
+// compared. Has to be called from within an epoch critical section.
+static uint64_t hashtable_mcmp_search(
+        hashtable_mcmp_t* hashtable,
+        hashtable_hash_t hash,
+        const char* key,
+        size_t key_length,
+        hashtable_mcmp_key_value_t** key_value_found,
+        uint64_t* free_bucket_index) {
+    hashtable_half_hash_t half_hash = hashtable_half_hash_from_hash(hash);
+    uint64_t chunk_index = hash & hashtable->chunks_mask;
+    uint64_t chunks_to_search = hashtable->chunks_count < HASHTABLE_SEARCH_MAX_CHUNKS
+            ? hashtable->chunks_count
+            : HASHTABLE_SEARCH_MAX_CHUNKS;
+
+    if (free_bucket_index) {
+        *free_bucket_index = HASHTABLE_MCMP_BUCKET_INDEX_NOT_FOUND;
+    }
+
+    for(uint64_t chunk_searched = 0; chunk_searched < chunks_to_search; chunk_searched++) {
+        hashtable_half_hashes_chunk_t* chunk = &hashtable->half_hashes_chunks[chunk_index];
+        uint64_t chunk_first_bucket_index = chunk_index * HASHTABLE_HALF_HASHES_CHUNK_SLOTS;
+        uint32_t chunk_slot_index;
+
+        uint32_t skip_indexes_mask = 0;
+        while ((chunk_slot_index = hashtable_linear_search_16(
+                half_hash,
+                chunk->half_hashes,
+                skip_indexes_mask)) != HASHTABLE_MCMP_SUPPORT_HASH_SEARCH_NOT_FOUND) {
+            hashtable_mcmp_key_value_t* key_value = __atomic_load_n(
+                    &hashtable->keys_values[chunk_first_bucket_index + chunk_slot_index],
+                    __ATOMIC_ACQUIRE);
+
+            if (key_value && key_value->key_length == key_length && memcmp(key_value->key, key, key_length) == 0) {
+                *key_value_found = key_value;
+                return chunk_first_bucket_index + chunk_slot_index;
+            }
+
+            skip_indexes_mask |= 1u << chunk_slot_index;
+        }
+
+        uint32_t chunk_slot_index_empty = hashtable_linear_search_16(
+                HASHTABLE_HALF_HASH_EMPTY,
+                chunk->half_hashes,
+                0);
+
+        if (free_bucket_index && *free_bucket_index == HASHTABLE_MCMP_BUCKET_INDEX_NOT_FOUND) {
+            uint32_t chunk_slot_index_tombstone = hashtable_linear_search_16(
+                    HASHTABLE_HALF_HASH_TOMBSTONE,
+                    chunk->half_hashes,
+                    0);
+            uint32_t chunk_slot_index_free = chunk_slot_index_empty < chunk_slot_index_tombstone
+                    ? chunk_slot_index_empty
+                    : chunk_slot_index_tombstone;
+
+            if (chunk_slot_index_free != HASHTABLE_MCMP_SUPPORT_HASH_SEARCH_NOT_FOUND) {
+                *free_bucket_index = chunk_first_bucket_index + chunk_slot_index_free;
+            }
+        }
+
+        if (chunk_slot_index_empty != HASHTABLE_MCMP_SUPPORT_HASH_SEARCH_NOT_FOUND) {
+            break;
+        }
+
+        chunk_index = (chunk_index + chunk_searched + 1) & hashtable->chunks_mask;
+    }
+
+    return HASHTABLE_MCMP_BUCKET_INDEX_NOT_FOUND;
+}
+
+hashtable_mcmp_t* hashtable_mcmp_new(
+        uint64_t buckets_count) {
+    hashtable_mcmp_t* hashtable = hashtable_mcmp_alloc_aligned_zero(64, sizeof(hashtable_mcmp_t));
+
+    if (buckets_count < HASHTABLE_HALF_HASHES_CHUNK_SLOTS) {
+        buckets_count = HASHTABLE_HALF_HASHES_CHUNK_SLOTS;
+    }
+
+    buckets_count = 1ull << (64 - __builtin_clzll(buckets_count - 1));
+
+    hashtable->buckets_count = buckets_count;
+    hashtable->chunks_count = buckets_count / HASHTABLE_HALF_HASHES_CHUNK_SLOTS;
+    hashtable->chunks_mask = hashtable->chunks_count - 1;
+    hashtable->half_hashes_chunks = hashtable_mcmp_alloc_aligned_zero(
+            64,
+            sizeof(hashtable_half_hashes_chunk_t) * hashtable->chunks_count);
+    hashtable->keys_values = hashtable_mcmp_alloc_aligned_zero(
+            64,
+            sizeof(hashtable_mcmp_key_value_t*) * buckets_count);
+    hashtable->chunks_locks = hashtable_mcmp_alloc_aligned_zero(
+            64,
+            sizeof(uint8_t) * hashtable->chunks_count);
+
+    return hashtable;
+}
+
+void hashtable_mcmp_free(
+        hashtable_mcmp_t* hashtable) {
+    for(uint64_t bucket_index = 0; bucket_index < hashtable->buckets_count; bucket_index++) {
+        free(hashtable->keys_values[bucket_index]);
+    }
+
+    free(hashtable->half_hashes_chunks);
+    free(hashtable->keys_values);
+    free(hashtable->chunks_locks);
+    free(hashtable);
+}
+
+bool hashtable_mcmp_insert(
+        hashtable_mcmp_t* hashtable,
+        const char* key,
+        size_t key_length,
+        uintptr_t value) {
+    bool inserted = false;
+    uint64_t free_bucket_index;
+    hashtable_mcmp_key_value_t* key_value_found;
+    hashtable_hash_t hash = hashtable_support_hash_calculate(key, key_length);
+    uint64_t home_chunk_index = hash & hashtable->chunks_mask;
+
+    // Allocated before taking the lock to keep the critical section short
+    hashtable_mcmp_key_value_t* key_value = malloc(sizeof(hashtable_mcmp_key_value_t) + key_length);
+    key_value->value = value;
+    key_value->key_length = key_length;
+    memcpy(key_value->key, key, key_length);
+
+    hashtable_epoch_enter();
+    hashtable_mcmp_chunk_lock(hashtable, home_chunk_index);
+
+    // The free slot can be claimed by an insert of a key with a different home chunk, in which case the search is
+    // repeated
+    while (hashtable_mcmp_search(
+            hashtable,
+            hash,
+            key,
+            key_length,
+            &key_value_found,
+            &free_bucket_index) == HASHTABLE_MCMP_BUCKET_INDEX_NOT_FOUND &&
+           free_bucket_index != HASHTABLE_MCMP_BUCKET_INDEX_NOT_FOUND) {
+        hashtable_half_hash_t* half_hash = hashtable_mcmp_bucket_half_hash(hashtable, free_bucket_index);
+        hashtable_half_hash_t half_hash_expected = __atomic_load_n(half_hash, __ATOMIC_RELAXED);
+
+        if ((half_hash_expected == HASHTABLE_HALF_HASH_EMPTY || half_hash_expected == HASHTABLE_HALF_HASH_TOMBSTONE) &&
+            __atomic_compare_exchange_n(
+                    half_hash,
+                    &half_hash_expected,
+                    HASHTABLE_MCMP_HALF_HASH_RESERVED,
+                    false,
+                    __ATOMIC_ACQ_REL,
+                    __ATOMIC_RELAXED)) {
+            // The key value has to be visible before the half hash that makes the lookups read it
+            __atomic_store_n(&hashtable->keys_values[free_bucket_index], key_value, __ATOMIC_RELEASE);
+            __atomic_store_n(half_hash, hashtable_half_hash_from_hash(hash), __ATOMIC_RELEASE);
+            __atomic_fetch_add(&hashtable->count, 1, __ATOMIC_RELAXED);
+
+            inserted = true;
+            break;
+        }
+
+        __atomic_fetch_add(&hashtable->slots_claims_failed, 1, __ATOMIC_RELAXED);
+    }
+
+    hashtable_mcmp_chunk_unlock(hashtable, home_chunk_index);
+    hashtable_epoch_exit();
+
+    if (!inserted) {
+        free(key_value);
+    }
+
+    return inserted;
+}
+
+bool hashtable_mcmp_lookup(
+        hashtable_mcmp_t* hashtable,
+        const char* key,
+        size_t key_length,
+        uintptr_t* value) {
+    hashtable_mcmp_key_value_t* key_value;
+    hashtable_hash_t hash = hashtable_support_hash_calculate(key, key_length);
+
+    hashtable_epoch_enter();
+
+    bool found = hashtable_mcmp_search(
+            hashtable,
+            hash,
+            key,
+            key_length,
+            &key_value,
+            NULL) != HASHTABLE_MCMP_BUCKET_INDEX_NOT_FOUND;
+
+    if (found) {
+        *value = __atomic_load_n(&key_value->value, __ATOMIC_ACQUIRE);
+    }
+
+    hashtable_epoch_exit();
+
+    return found;
+}
+
+bool hashtable_mcmp_update(
+        hashtable_mcmp_t* hashtable,
+        const char* key,
+        size_t key_length,
+        uintptr_t value) {
+    hashtable_mcmp_key_value_t* key_value;
+    hashtable_hash_t hash = hashtable_support_hash_calculate(key, key_length);
+    uint64_t home_chunk_index = hash & hashtable->chunks_mask;
+
+    hashtable_epoch_enter();
+    hashtable_mcmp_chunk_lock(hashtable, home_chunk_index);
+
+    bool found = hashtable_mcmp_search(
+            hashtable,
+            hash,
+            key,
+            key_length,
+            &key_value,
+            NULL) != HASHTABLE_MCMP_BUCKET_INDEX_NOT_FOUND;
+
+    if (found) {
+        __atomic_store_n(&key_value->value, value, __ATOMIC_RELEASE);
+    }
+
+    hashtable_mcmp_chunk_unlock(hashtable, home_chunk_index);
+    hashtable_epoch_exit();
+
+    return found;
+}
+
+bool hashtable_mcmp_delete(
+        hashtable_mcmp_t* hashtable,
+        const char* key,
+        size_t key_length) {
+    hashtable_mcmp_key_value_t* key_value;
+    hashtable_hash_t hash = hashtable_support_hash_calculate(key, key_length);
+    uint64_t home_chunk_index = hash & hashtable->chunks_mask;
+
+    hashtable_epoch_enter();
+    hashtable_mcmp_chunk_lock(hashtable, home_chunk_index);
+
+    uint64_t bucket_index = hashtable_mcmp_search(
+            hashtable,
+            hash,
+            key,
+            key_length,
+            &key_value,
+            NULL);
+
+    if (bucket_index != HASHTABLE_MCMP_BUCKET_INDEX_NOT_FOUND) {
+        // The pointer is cleared first, once the slot is a tombstone it can be claimed by the insert of a key with a
+        // different home chunk
+        __atomic_store_n(&hashtable->keys_values[bucket_index], NULL, __ATOMIC_RELEASE);
+        __atomic_store_n(
+                hashtable_mcmp_bucket_half_hash(hashtable, bucket_index),
+                HASHTABLE_HALF_HASH_TOMBSTONE,
+                __ATOMIC_RELEASE);
+        __atomic_fetch_sub(&hashtable->count, 1, __ATOMIC_RELAXED);
+    }
+
+    hashtable_mcmp_chunk_unlock(hashtable, home_chunk_index);
+
+    // The lookups that have already read the pointer can still be using the key value
+    if (bucket_index != HASHTABLE_MCMP_BUCKET_INDEX_NOT_FOUND) {
+        hashtable_epoch_retire(&key_value->retired);
+    }
+
+    hashtable_epoch_exit();
+
+    return bucket_index != HASHTABLE_MCMP_BUCKET_INDEX_NOT_FOUND;
+}
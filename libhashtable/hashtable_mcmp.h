@@ -0,0 +1,91 @@
+#ifndef HASHTABLE_MCMP_H
+#define HASHTABLE_MCMP_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "hashtable_support_hash.h"
+#include "hashtable_epoch.h"
+#include "hashtable.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Multi consumer multi producer variant of hashtable_t, same chunks of half hashes and same probing.
+//
+// The lookups are lock-free, the writers lock the chunk the hash of the key maps to, the home chunk, so the writes of
+// the same key are serialized, and claim the free slot they are going to fill with a CAS on its half hash as it may be
+// in a chunk shared with keys having a different home chunk. The key and the value are stored out of line and
+// published by pointer, a deleted key value is retired and freed by hashtable_epoch once no lookup can be reading it.
+//
+// Deleted slots always become tombstones, marking a slot as empty would require knowing that no key has been pushed
+// past the chunk by a concurrent insert. The tombstones are reused by the inserts.
+//
+// The threads using the hashtable must call hashtable_epoch_thread_free before terminating.
+
+// Set on the half hash of a slot claimed by an insert but not yet filled, it never matches a key and doesn't stop the
+// searches
+#define HASHTABLE_MCMP_HALF_HASH_RESERVED 2u
+
+typedef struct hashtable_mcmp_key_value hashtable_mcmp_key_value_t;
+struct hashtable_mcmp_key_value {
+    hashtable_epoch_retired_t retired;
+    uintptr_t value;
+    uint32_t key_length;
+    char key[];
+};
+
+typedef struct hashtable_mcmp hashtable_mcmp_t;
+struct hashtable_mcmp {
+    uint64_t buckets_count;
+    uint64_t chunks_count;
+    uint64_t chunks_mask;
+    hashtable_half_hashes_chunk_t* half_hashes_chunks;
+    hashtable_mcmp_key_value_t** keys_values;
+    uint8_t* chunks_locks;
+    // Updated only on the slow paths, they measure the contention between the writers
+    uint64_t chunks_locks_contended __attribute__((aligned(64)));
+    uint64_t slots_claims_failed;
+    uint64_t count __attribute__((aligned(64)));
+};
+
+// buckets_count is rounded up to a power of two, with at least one chunk
+hashtable_mcmp_t* hashtable_mcmp_new(
+        uint64_t buckets_count);
+
+// Can't be called while other threads are using the hashtable
+void hashtable_mcmp_free(
+        hashtable_mcmp_t* hashtable);
+
+// Returns false if the key already exists or if there are no free buckets in the chunks it can be stored in
+bool hashtable_mcmp_insert(
+        hashtable_mcmp_t* hashtable,
+        const char* key,
+        size_t key_length,
+        uintptr_t value);
+
+bool hashtable_mcmp_lookup(
+        hashtable_mcmp_t* hashtable,
+        const char* key,
+        size_t key_length,
+        uintptr_t* value);
+
+// Returns false if the key doesn't exist
+bool hashtable_mcmp_update(
+        hashtable_mcmp_t* hashtable,
+        const char* key,
+        size_t key_length,
+        uintptr_t value);
+
+bool hashtable_mcmp_delete(
+        hashtable_mcmp_t* hashtable,
+        const char* key,
+        size_t key_length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //HASHTABLE_MCMP_H
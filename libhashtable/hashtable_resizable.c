@@ -0,0 +1,208 @@
+/**
+ * Copyright (C) 2020-2021 Daniele Salvatore Albano
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license.  See the LICENSE file for details.
+ **/
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "hashtable_support_hash.h"
+#include "hashtable.h"
+#include "hashtable_resizable.h"
+
+// Returns false if a key can't be stored in the new hashtable, the chunks it can go in are all full. The key is left in
+// the old hashtable, where it's still found, and the keys already moved are tombstones, the chunk can be migrated again.
+static bool hashtable_resizable_migrate_chunk(
+        hashtable_resizable_t* hashtable_resizable,
+        uint64_t chunk_index) {
+    hashtable_t* hashtable_old = hashtable_resizable->hashtable_old;
+    hashtable_half_hashes_chunk_t* chunk = &hashtable_old->half_hashes_chunks[chunk_index];
+
+    for(uint32_t chunk_slot_index = 0; chunk_slot_index < HASHTABLE_HALF_HASHES_CHUNK_SLOTS; chunk_slot_index++) {
+        if ((chunk->half_hashes[chunk_slot_index] & HASHTABLE_HALF_HASH_FILLED) == 0) {
+            continue;
+        }
+
+        hashtable_key_value_t* key_value =
+                &hashtable_old->keys_values[chunk_index * HASHTABLE_HALF_HASHES_CHUNK_SLOTS + chunk_slot_index];
+
+        // Only the upper half of the hash is stored, the lower bits picking the chunk have to be calculated again
+        hashtable_hash_t hash = hashtable_support_hash_calculate(key_value->key, key_value->key_length);
+
+        // The new hashtable is twice as large and at most half full when the resize starts but the keys are limited
+        // to HASHTABLE_SEARCH_MAX_CHUNKS from their first chunk, a long enough run of keys can still fill them
+        if (!hashtable_insert_key_value(hashtable_resizable->hashtable, hash, key_value)) {
+            return false;
+        }
+
+        memset(key_value, 0, sizeof(hashtable_key_value_t));
+        chunk->half_hashes[chunk_slot_index] = HASHTABLE_HALF_HASH_TOMBSTONE;
+        hashtable_old->count--;
+    }
+
+    return true;
+}
+
+// Returns false if the migration is stuck on a key that can't be moved, the resize stays in progress
+static bool hashtable_resizable_migrate(
+        hashtable_resizable_t* hashtable_resizable,
+        uint64_t chunks_to_migrate) {
+    hashtable_t* hashtable_old = hashtable_resizable->hashtable_old;
+
+    if (hashtable_old == NULL) {
+        return true;
+    }
+
+    for(;
+            chunks_to_migrate > 0 && hashtable_resizable->migrate_chunk_index < hashtable_old->chunks_count;
+            chunks_to_migrate--, hashtable_resizable->migrate_chunk_index++) {
+        if (!hashtable_resizable_migrate_chunk(hashtable_resizable, hashtable_resizable->migrate_chunk_index)) {
+            return false;
+        }
+    }
+
+    // All the keys have been moved, hashtable_free doesn't have to scan the buckets to free them
+    if (hashtable_resizable->migrate_chunk_index == hashtable_old->chunks_count) {
+        hashtable_free(hashtable_old);
+        hashtable_resizable->hashtable_old = NULL;
+    }
+
+    return true;
+}
+
+static inline void hashtable_resizable_migrate_step(
+        hashtable_resizable_t* hashtable_resizable) {
+    if (hashtable_resizable->hashtable_old == NULL) {
+        return;
+    }
+
+    hashtable_resizable_migrate(
+            hashtable_resizable,
+            hashtable_resizable->migrate_chunks_per_op == HASHTABLE_RESIZABLE_MIGRATE_ALL
+                ? UINT64_MAX
+                : hashtable_resizable->migrate_chunks_per_op);
+}
+
+// Returns false if a resize is in progress and can't be completed, only two hashtables can coexist
+static bool hashtable_resizable_grow(
+        hashtable_resizable_t* hashtable_resizable) {
+    if (!hashtable_resizable_migrate(hashtable_resizable, UINT64_MAX)) {
+        return false;
+    }
+
+    hashtable_resizable->hashtable_old = hashtable_resizable->hashtable;
+    hashtable_resizable->hashtable = hashtable_new_lazy(hashtable_resizable->hashtable_old->buckets_count * 2);
+    hashtable_resizable->migrate_chunk_index = 0;
+    hashtable_resizable->resizes_count++;
+
+    hashtable_resizable_migrate_step(hashtable_resizable);
+
+    return true;
+}
+
+hashtable_resizable_t* hashtable_resizable_new(
+        uint64_t buckets_count,
+        uint64_t migrate_chunks_per_op) {
+    hashtable_resizable_t* hashtable_resizable = malloc(sizeof(hashtable_resizable_t));
+    memset(hashtable_resizable, 0, sizeof(hashtable_resizable_t));
+
+    hashtable_resizable->hashtable = hashtable_new_lazy(buckets_count);
+    hashtable_resizable->migrate_chunks_per_op = migrate_chunks_per_op;
+
+    return hashtable_resizable;
+}
+
+void hashtable_resizable_free(
+        hashtable_resizable_t* hashtable_resizable) {
+    if (hashtable_resizable->hashtable_old) {
+        hashtable_free(hashtable_resizable->hashtable_old);
+    }
+
+    hashtable_free(hashtable_resizable->hashtable);
+    free(hashtable_resizable);
+}
+
+uint64_t hashtable_resizable_count(
+        hashtable_resizable_t* hashtable_resizable) {
+    return hashtable_resizable->hashtable->count +
+           (hashtable_resizable->hashtable_old ? hashtable_resizable->hashtable_old->count : 0);
+}
+
+hashtable_resizable_insert_result_t hashtable_resizable_insert(
+        hashtable_resizable_t* hashtable_resizable,
+        const char* key,
+        size_t key_length,
+        uintptr_t value) {
+    uintptr_t value_found;
+
+    hashtable_resizable_migrate_step(hashtable_resizable);
+
+    // Has to happen before checking the old hashtable, growing turns the current one into the old one. If the resize
+    // in progress is stuck the key can still fit in the current hashtable, it's checked by the insert below
+    if (hashtable_resizable_count(hashtable_resizable) >=
+            hashtable_resizable->hashtable->buckets_count * HASHTABLE_RESIZABLE_MAX_LOAD_FACTOR_PERCENT / 100) {
+        hashtable_resizable_grow(hashtable_resizable);
+    }
+
+    if (hashtable_resizable->hashtable_old &&
+            hashtable_lookup(hashtable_resizable->hashtable_old, key, key_length, &value_found)) {
+        return HASHTABLE_RESIZABLE_INSERT_RESULT_EXISTS;
+    }
+
+    if (hashtable_insert(hashtable_resizable->hashtable, key, key_length, value)) {
+        return HASHTABLE_RESIZABLE_INSERT_RESULT_INSERTED;
+    }
+
+    // Either the key already exists or the chunks it can be stored in are full, in the latter case the hashtable
+    // grows before the load factor is reached
+    if (hashtable_lookup(hashtable_resizable->hashtable, key, key_length, &value_found)) {
+        return HASHTABLE_RESIZABLE_INSERT_RESULT_EXISTS;
+    }
+
+    if (!hashtable_resizable_grow(hashtable_resizable) ||
+            !hashtable_insert(hashtable_resizable->hashtable, key, key_length, value)) {
+        return HASHTABLE_RESIZABLE_INSERT_RESULT_FULL;
+    }
+
+    return HASHTABLE_RESIZABLE_INSERT_RESULT_INSERTED;
+}
+
+bool hashtable_resizable_lookup(
+        hashtable_resizable_t* hashtable_resizable,
+        const char* key,
+        size_t key_length,
+        uintptr_t* value) {
+    hashtable_resizable_migrate_step(hashtable_resizable);
+
+    return hashtable_lookup(hashtable_resizable->hashtable, key, key_length, value) ||
+           (hashtable_resizable->hashtable_old &&
+                   hashtable_lookup(hashtable_resizable->hashtable_old, key, key_length, value));
+}
+
+bool hashtable_resizable_update(
+        hashtable_resizable_t* hashtable_resizable,
+        const char* key,
+        size_t key_length,
+        uintptr_t value) {
+    hashtable_resizable_migrate_step(hashtable_resizable);
+
+    return hashtable_update(hashtable_resizable->hashtable, key, key_length, value) ||
+           (hashtable_resizable->hashtable_old &&
+                   hashtable_update(hashtable_resizable->hashtable_old, key, key_length, value));
+}
+
+bool hashtable_resizable_delete(
+        hashtable_resizable_t* hashtable_resizable,
+        const char* key,
+        size_t key_length) {
+    hashtable_resizable_migrate_step(hashtable_resizable);
+
+    return hashtable_delete(hashtable_resizable->hashtable, key, key_length) ||
+           (hashtable_resizable->hashtable_old &&
+                   hashtable_delete(hashtable_resizable->hashtable_old, key, key_length));
+}
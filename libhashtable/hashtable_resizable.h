@@ -0,0 +1,94 @@
+#ifndef HASHTABLE_RESIZABLE_H
+#define HASHTABLE_RESIZABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "hashtable.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Variant of hashtable_t that grows online, in place of a stop-the-world rehash.
+//
+// When the number of keys goes above HASHTABLE_RESIZABLE_MAX_LOAD_FACTOR_PERCENT of the buckets a hashtable twice as
+// large is allocated, the old and the new hashtable coexist and every operation migrates up to migrate_chunks_per_op
+// chunks of the old one to the new one, in order. While the migration is in progress the lookups, updates and deletes
+// search the new hashtable first and then the old one, the inserts always go in the new one. The migrated slots become
+// tombstones so the searches of the keys not yet migrated, that may have been pushed past a migrated chunk, still
+// find them. The old hashtable is freed once all its chunks have been migrated.
+//
+// The hashtables are allocated with hashtable_new_lazy, zeroing the new arrays upfront would be a stop-the-world pause
+// of its own.
+//
+// HASHTABLE_RESIZABLE_MIGRATE_ALL migrates all the chunks when the resize starts, as a stop-the-world rehash would do.
+//
+// A key is searched in up to HASHTABLE_SEARCH_MAX_CHUNKS chunks, if they are all full in the new hashtable the key
+// can't be migrated, it stays in the old hashtable and the migration is retried by the next operations. A resize can't
+// start while another one is in progress, if the migration is stuck and the chunks of a new key are full as well the
+// insert fails with HASHTABLE_RESIZABLE_INSERT_RESULT_FULL.
+
+#define HASHTABLE_RESIZABLE_MAX_LOAD_FACTOR_PERCENT 75
+#define HASHTABLE_RESIZABLE_MIGRATE_ALL 0
+
+enum hashtable_resizable_insert_result {
+    HASHTABLE_RESIZABLE_INSERT_RESULT_INSERTED = 0,
+    HASHTABLE_RESIZABLE_INSERT_RESULT_EXISTS,
+    // The chunks the key can be stored in are full and the hashtable can't grow, see above
+    HASHTABLE_RESIZABLE_INSERT_RESULT_FULL,
+};
+typedef enum hashtable_resizable_insert_result hashtable_resizable_insert_result_t;
+
+typedef struct hashtable_resizable hashtable_resizable_t;
+struct hashtable_resizable {
+    hashtable_t* hashtable;
+    // Not NULL while a resize is in progress
+    hashtable_t* hashtable_old;
+    uint64_t migrate_chunk_index;
+    uint64_t migrate_chunks_per_op;
+    uint64_t resizes_count;
+};
+
+// buckets_count is the initial size, rounded up as hashtable_new does
+hashtable_resizable_t* hashtable_resizable_new(
+        uint64_t buckets_count,
+        uint64_t migrate_chunks_per_op);
+
+void hashtable_resizable_free(
+        hashtable_resizable_t* hashtable_resizable);
+
+// Number of keys in the old and in the new hashtable
+uint64_t hashtable_resizable_count(
+        hashtable_resizable_t* hashtable_resizable);
+
+hashtable_resizable_insert_result_t hashtable_resizable_insert(
+        hashtable_resizable_t* hashtable_resizable,
+        const char* key,
+        size_t key_length,
+        uintptr_t value);
+
+bool hashtable_resizable_lookup(
+        hashtable_resizable_t* hashtable_resizable,
+        const char* key,
+        size_t key_length,
+        uintptr_t* value);
+
+// Returns false if the key doesn't exist
+bool hashtable_resizable_update(
+        hashtable_resizable_t* hashtable_resizable,
+        const char* key,
+        size_t key_length,
+        uintptr_t value);
+
+bool hashtable_resizable_delete(
+        hashtable_resizable_t* hashtable_resizable,
+        const char* key,
+        size_t key_length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //HASHTABLE_RESIZABLE_H
@@ -0,0 +1,440 @@
+/**
+ * Copyright (C) 2020-2021 Daniele Salvatore Albano
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license.  See the LICENSE file for details.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "hashtable_support_hash.h"
+#include "hashtable_support_hash_search.h"
+#include "hashtable.h"
+#include "hashtable_snapshot.h"
+
+#define HASHTABLE_SNAPSHOT_CHECKSUM_PRIME 0x9E3779B185EBCA87ull
+#define HASHTABLE_SNAPSHOT_TMP_SUFFIX ".tmp"
+
+typedef struct hashtable_snapshot_writer hashtable_snapshot_writer_t;
+struct hashtable_snapshot_writer {
+    int fd;
+    bool failed;
+    char* buffer;
+    size_t buffer_used;
+    uint64_t offset;
+    uint64_t checksum;
+};
+
+// The data is always checksummed in blocks that are a multiple of 8 bytes, the buffer is flushed only when it's full
+// or at the end of a section, padded to HASHTABLE_SNAPSHOT_SECTION_ALIGNMENT
+static uint64_t hashtable_snapshot_checksum_update(
+        uint64_t checksum,
+        const void* data,
+        size_t size) {
+    const uint64_t* words = data;
+
+    for(size_t index = 0; index < size / sizeof(uint64_t); index++) {
+        checksum = (((checksum << 31) | (checksum >> 33)) ^ words[index]) * HASHTABLE_SNAPSHOT_CHECKSUM_PRIME;
+    }
+
+    return checksum;
+}
+
+static void hashtable_snapshot_writer_write(
+        hashtable_snapshot_writer_t* writer,
+        const void* data,
+        size_t size) {
+    const char* data_char = data;
+
+    if (writer->failed) {
+        return;
+    }
+
+    writer->checksum = hashtable_snapshot_checksum_update(writer->checksum, data, size);
+    writer->offset += size;
+
+    while (size > 0) {
+        ssize_t written = write(writer->fd, data_char, size);
+
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            writer->failed = true;
+            return;
+        }
+
+        data_char += written;
+        size -= written;
+    }
+}
+
+static void hashtable_snapshot_writer_flush(
+        hashtable_snapshot_writer_t* writer) {
+    hashtable_snapshot_writer_write(writer, writer->buffer, writer->buffer_used);
+    writer->buffer_used = 0;
+}
+
+static void hashtable_snapshot_writer_append(
+        hashtable_snapshot_writer_t* writer,
+        const void* data,
+        size_t size) {
+    const char* data_char = data;
+
+    while (size > 0 && !writer->failed) {
+        size_t buffer_free = HASHTABLE_SNAPSHOT_WRITE_BUFFER_SIZE - writer->buffer_used;
+        size_t copy_size = size < buffer_free ? size : buffer_free;
+
+        memcpy(writer->buffer + writer->buffer_used, data_char, copy_size);
+        writer->buffer_used += copy_size;
+        data_char += copy_size;
+        size -= copy_size;
+
+        if (writer->buffer_used == HASHTABLE_SNAPSHOT_WRITE_BUFFER_SIZE) {
+            hashtable_snapshot_writer_flush(writer);
+        }
+    }
+}
+
+// Pads the section to the alignment and flushes the buffer, returns the offset of the next section
+static uint64_t hashtable_snapshot_writer_section_end(
+        hashtable_snapshot_writer_t* writer) {
+    static const char padding[HASHTABLE_SNAPSHOT_SECTION_ALIGNMENT] = { 0 };
+    uint64_t section_end = writer->offset + writer->buffer_used;
+    uint64_t padding_size =
+            (HASHTABLE_SNAPSHOT_SECTION_ALIGNMENT - (section_end % HASHTABLE_SNAPSHOT_SECTION_ALIGNMENT)) %
+            HASHTABLE_SNAPSHOT_SECTION_ALIGNMENT;
+
+    hashtable_snapshot_writer_append(writer, padding, padding_size);
+    hashtable_snapshot_writer_flush(writer);
+
+    return writer->offset;
+}
+
+static inline hashtable_half_hash_t hashtable_snapshot_bucket_half_hash(
+        hashtable_t* hashtable,
+        uint64_t bucket_index) {
+    return hashtable->half_hashes_chunks[bucket_index / HASHTABLE_HALF_HASHES_CHUNK_SLOTS]
+            .half_hashes[bucket_index % HASHTABLE_HALF_HASHES_CHUNK_SLOTS];
+}
+
+// The rename is persisted only once the directory is
+static bool hashtable_snapshot_sync_directory(
+        const char* path) {
+    const char* path_last_slash = strrchr(path, '/');
+    char* directory_path;
+    int fd;
+    bool result;
+
+    if (path_last_slash == NULL) {
+        directory_path = strdup(".");
+    } else if (path_last_slash == path) {
+        directory_path = strdup("/");
+    } else {
+        directory_path = strndup(path, path_last_slash - path);
+    }
+
+    if (directory_path == NULL) {
+        fprintf(stderr, "Unable to allocate the snapshot directory path\n");
+        exit(-1);
+    }
+
+    fd = open(directory_path, O_RDONLY | O_DIRECTORY);
+    free(directory_path);
+
+    if (fd < 0) {
+        return false;
+    }
+
+    result = fsync(fd) == 0;
+
+    int sync_errno = errno;
+    close(fd);
+    errno = sync_errno;
+
+    return result;
+}
+
+bool hashtable_snapshot_write(
+        hashtable_t* hashtable,
+        const char* path,
+        bool sync) {
+    hashtable_snapshot_header_t header = { 0 };
+    hashtable_snapshot_writer_t writer = { 0 };
+    uint64_t key_offset = 0;
+    char* path_tmp = malloc(strlen(path) + sizeof(HASHTABLE_SNAPSHOT_TMP_SUFFIX));
+
+    if (path_tmp == NULL) {
+        fprintf(stderr, "Unable to allocate the snapshot temporary path\n");
+        exit(-1);
+    }
+
+    strcpy(path_tmp, path);
+    strcat(path_tmp, HASHTABLE_SNAPSHOT_TMP_SUFFIX);
+
+    // The snapshot at path, and any process mapping it, isn't touched until the new one is completely written
+    writer.fd = open(path_tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (writer.fd < 0) {
+        int open_errno = errno;
+        free(path_tmp);
+        errno = open_errno;
+
+        return false;
+    }
+
+    writer.buffer = malloc(HASHTABLE_SNAPSHOT_WRITE_BUFFER_SIZE);
+    if (writer.buffer == NULL) {
+        fprintf(stderr, "Unable to allocate the snapshot write buffer\n");
+        exit(-1);
+    }
+
+    // The header is written at the end, once the checksum is known
+    writer.offset = HASHTABLE_SNAPSHOT_SECTION_ALIGNMENT;
+    if (lseek(writer.fd, (off_t)writer.offset, SEEK_SET) < 0) {
+        writer.failed = true;
+    }
+
+    // The chunks are written straight from the hashtable, without going through the buffer
+    header.half_hashes_chunks_offset = writer.offset;
+    hashtable_snapshot_writer_write(
+            &writer,
+            hashtable->half_hashes_chunks,
+            sizeof(hashtable_half_hashes_chunk_t) * hashtable->chunks_count);
+    header.buckets_offset = hashtable_snapshot_writer_section_end(&writer);
+
+    for(uint64_t bucket_index = 0; bucket_index < hashtable->buckets_count && !writer.failed; bucket_index++) {
+        hashtable_half_hash_t half_hash = hashtable_snapshot_bucket_half_hash(hashtable, bucket_index);
+        hashtable_snapshot_bucket_t bucket;
+
+        // The padding of the struct ends up in the file as well
+        memset(&bucket, 0, sizeof(bucket));
+
+        if (half_hash & HASHTABLE_HALF_HASH_FILLED) {
+            bucket.key_offset = key_offset;
+            bucket.key_length = hashtable->keys_values[bucket_index].key_length;
+            bucket.value = hashtable->keys_values[bucket_index].value;
+            key_offset += bucket.key_length;
+        }
+
+        hashtable_snapshot_writer_append(&writer, &bucket, sizeof(bucket));
+    }
+    header.keys_offset = hashtable_snapshot_writer_section_end(&writer);
+
+    // Same order of the buckets, the offsets assigned above match
+    for(uint64_t bucket_index = 0; bucket_index < hashtable->buckets_count && !writer.failed; bucket_index++) {
+        hashtable_half_hash_t half_hash = hashtable_snapshot_bucket_half_hash(hashtable, bucket_index);
+
+        if (half_hash & HASHTABLE_HALF_HASH_FILLED) {
+            hashtable_snapshot_writer_append(
+                    &writer,
+                    hashtable->keys_values[bucket_index].key,
+                    hashtable->keys_values[bucket_index].key_length);
+        }
+    }
+    header.keys_size = key_offset;
+    header.file_size = hashtable_snapshot_writer_section_end(&writer);
+
+    memcpy(header.magic, HASHTABLE_SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = HASHTABLE_SNAPSHOT_VERSION;
+    header.header_size = sizeof(header);
+    header.hash_seed = HASHTABLE_SUPPORT_HASH_SEED;
+    header.buckets_count = hashtable->buckets_count;
+    header.chunks_count = hashtable->chunks_count;
+    header.count = hashtable->count;
+    header.checksum = writer.checksum;
+
+    if (!writer.failed && pwrite(writer.fd, &header, sizeof(header), 0) != sizeof(header)) {
+        writer.failed = true;
+    }
+
+    // The data has to be on the disk before the rename, a crash must not leave a partially written file at path
+    if (!writer.failed && sync && fdatasync(writer.fd) < 0) {
+        writer.failed = true;
+    }
+
+    if (close(writer.fd) < 0 && !writer.failed) {
+        writer.failed = true;
+    }
+
+    if (!writer.failed && rename(path_tmp, path) < 0) {
+        writer.failed = true;
+    }
+
+    if (!writer.failed && sync && !hashtable_snapshot_sync_directory(path)) {
+        writer.failed = true;
+    }
+
+    // errno of the failure has to be preserved for the caller
+    int write_errno = errno;
+    if (writer.failed) {
+        unlink(path_tmp);
+    }
+    free(path_tmp);
+    free(writer.buffer);
+    errno = write_errno;
+
+    return !writer.failed;
+}
+
+// The header comes from the disk, the sizes of the sections are calculated only once the counts and the offsets are
+// known to fit in the file, a corrupted count can't make them wrap around
+static bool hashtable_snapshot_header_is_valid(
+        const hashtable_snapshot_header_t* header,
+        uint64_t file_size) {
+    if (memcmp(header->magic, HASHTABLE_SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+            header->version != HASHTABLE_SNAPSHOT_VERSION ||
+            header->header_size != sizeof(hashtable_snapshot_header_t) ||
+            header->hash_seed != HASHTABLE_SUPPORT_HASH_SEED ||
+            header->file_size != file_size) {
+        return false;
+    }
+
+    if (header->half_hashes_chunks_offset < HASHTABLE_SNAPSHOT_SECTION_ALIGNMENT ||
+            header->half_hashes_chunks_offset % HASHTABLE_SNAPSHOT_SECTION_ALIGNMENT != 0 ||
+            header->buckets_offset % HASHTABLE_SNAPSHOT_SECTION_ALIGNMENT != 0 ||
+            header->keys_offset % HASHTABLE_SNAPSHOT_SECTION_ALIGNMENT != 0 ||
+            header->half_hashes_chunks_offset > file_size ||
+            header->buckets_offset > file_size ||
+            header->keys_offset > file_size) {
+        return false;
+    }
+
+    if (header->chunks_count > (file_size - header->half_hashes_chunks_offset) /
+                    sizeof(hashtable_half_hashes_chunk_t) ||
+            header->buckets_count > (file_size - header->buckets_offset) / sizeof(hashtable_snapshot_bucket_t) ||
+            header->keys_size > file_size - header->keys_offset) {
+        return false;
+    }
+
+    uint64_t half_hashes_chunks_end =
+            header->half_hashes_chunks_offset + sizeof(hashtable_half_hashes_chunk_t) * header->chunks_count;
+    uint64_t buckets_end = header->buckets_offset + sizeof(hashtable_snapshot_bucket_t) * header->buckets_count;
+    uint64_t keys_end = header->keys_offset + header->keys_size;
+
+    return header->buckets_count >= HASHTABLE_HALF_HASHES_CHUNK_SLOTS &&
+           (header->buckets_count & (header->buckets_count - 1)) == 0 &&
+           header->chunks_count * HASHTABLE_HALF_HASHES_CHUNK_SLOTS == header->buckets_count &&
+           header->count <= header->buckets_count &&
+           half_hashes_chunks_end <= file_size &&
+           buckets_end <= file_size &&
+           keys_end <= file_size &&
+           header->buckets_offset >= half_hashes_chunks_end &&
+           header->keys_offset >= buckets_end;
+}
+
+hashtable_snapshot_t* hashtable_snapshot_open(
+        const char* path,
+        bool verify_checksum) {
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0) {
+        return NULL;
+    }
+
+    if (fstat(fd, &st) < 0 || (uint64_t)st.st_size < HASHTABLE_SNAPSHOT_SECTION_ALIGNMENT) {
+        close(fd);
+        return NULL;
+    }
+
+    void* mapping = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+
+    // The mapping stays valid after closing the file
+    close(fd);
+
+    const hashtable_snapshot_header_t* header = mapping;
+    if (!hashtable_snapshot_header_is_valid(header, st.st_size) ||
+            (verify_checksum && hashtable_snapshot_checksum_update(
+                    0,
+                    (char*)mapping + HASHTABLE_SNAPSHOT_SECTION_ALIGNMENT,
+                    header->file_size - HASHTABLE_SNAPSHOT_SECTION_ALIGNMENT) != header->checksum)) {
+        munmap(mapping, st.st_size);
+        return NULL;
+    }
+
+    hashtable_snapshot_t* snapshot = malloc(sizeof(hashtable_snapshot_t));
+    snapshot->mapping = mapping;
+    snapshot->mapping_size = st.st_size;
+    snapshot->chunks_mask = header->chunks_count - 1;
+    snapshot->header = header;
+    snapshot->half_hashes_chunks =
+            (const hashtable_half_hashes_chunk_t*)((char*)mapping + header->half_hashes_chunks_offset);
+    snapshot->buckets = (const hashtable_snapshot_bucket_t*)((char*)mapping + header->buckets_offset);
+    snapshot->keys = (char*)mapping + header->keys_offset;
+
+    return snapshot;
+}
+
+void hashtable_snapshot_close(
+        hashtable_snapshot_t* snapshot) {
+    munmap(snapshot->mapping, snapshot->mapping_size);
+    free(snapshot);
+}
+
+// Same search of hashtable_search, without looking for a free bucket
+bool hashtable_snapshot_lookup(
+        hashtable_snapshot_t* snapshot,
+        const char* key,
+        size_t key_length,
+        uintptr_t* value) {
+    hashtable_hash_t hash = hashtable_support_hash_calculate(key, key_length);
+    hashtable_half_hash_t half_hash = hashtable_half_hash_from_hash(hash);
+    uint64_t chunk_index = hash & snapshot->chunks_mask;
+    uint64_t chunks_to_search = snapshot->header->chunks_count < HASHTABLE_SEARCH_MAX_CHUNKS
+            ? snapshot->header->chunks_count
+            : HASHTABLE_SEARCH_MAX_CHUNKS;
+
+    for(uint64_t chunk_searched = 0; chunk_searched < chunks_to_search; chunk_searched++) {
+        // The search only reads the half hashes, the mapping is read only
+        hashtable_half_hash_t* half_hashes =
+                (hashtable_half_hash_t*)snapshot->half_hashes_chunks[chunk_index].half_hashes;
+        uint64_t chunk_first_bucket_index = chunk_index * HASHTABLE_HALF_HASHES_CHUNK_SLOTS;
+        uint32_t chunk_slot_index;
+        uint32_t skip_indexes_mask = 0;
+
+        while ((chunk_slot_index = hashtable_linear_search_16(
+                half_hash,
+                half_hashes,
+                skip_indexes_mask)) != HASHTABLE_MCMP_SUPPORT_HASH_SEARCH_NOT_FOUND) {
+            const hashtable_snapshot_bucket_t* bucket = &snapshot->buckets[chunk_first_bucket_index + chunk_slot_index];
+
+            // The offsets aren't validated when opening the snapshot, the ones out of the keys section never match,
+            // key_length is checked first as the offset can be anything and the sum could wrap around
+            if (bucket->key_length == key_length &&
+                    key_length <= snapshot->header->keys_size &&
+                    bucket->key_offset <= snapshot->header->keys_size - key_length &&
+                    memcmp(snapshot->keys + bucket->key_offset, key, key_length) == 0) {
+                *value = bucket->value;
+                return true;
+            }
+
+            skip_indexes_mask |= 1u << chunk_slot_index;
+        }
+
+        if (hashtable_linear_search_16(
+                HASHTABLE_HALF_HASH_EMPTY,
+                half_hashes,
+                0) != HASHTABLE_MCMP_SUPPORT_HASH_SEARCH_NOT_FOUND) {
+            break;
+        }
+
+        chunk_index = (chunk_index + chunk_searched + 1) & snapshot->chunks_mask;
+    }
+
+    return false;
+}
@@ -0,0 +1,100 @@
+#ifndef HASHTABLE_SNAPSHOT_H
+#define HASHTABLE_SNAPSHOT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "hashtable_support_hash.h"
+#include "hashtable.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// On-disk snapshot of a hashtable_t, for a warm restart without inserting the keys again.
+//
+// The file has four sections, each aligned to HASHTABLE_SNAPSHOT_SECTION_ALIGNMENT:
+// - the header
+// - the chunks of half hashes, written as they are in memory
+// - the buckets, the key is stored as an offset in the keys section instead of a pointer
+// - the keys, one after the other in the order of the buckets
+//
+// The snapshot is streamed section by section through a buffer of HASHTABLE_SNAPSHOT_WRITE_BUFFER_SIZE bytes, the
+// memory used doesn't depend on the size of the hashtable. It's written to a temporary file next to the final one,
+// <path>.tmp, that is renamed over the previous snapshot once complete: a crash while writing leaves the previous
+// snapshot in place, and the processes that have it mapped keep reading it.
+//
+// Opening a snapshot maps the file and validates the header, the lookups run directly on the mapping with the same
+// chunks and probing of hashtable_t, the pages are read from the disk on the first access.
+
+#define HASHTABLE_SNAPSHOT_MAGIC "HTSNAP\0\1"
+#define HASHTABLE_SNAPSHOT_VERSION 1
+#define HASHTABLE_SNAPSHOT_SECTION_ALIGNMENT 4096
+#define HASHTABLE_SNAPSHOT_WRITE_BUFFER_SIZE (1024 * 1024)
+
+typedef struct hashtable_snapshot_header hashtable_snapshot_header_t;
+struct hashtable_snapshot_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    // The hashes have to be calculated the same way they were when the snapshot was written
+    uint64_t hash_seed;
+    uint64_t buckets_count;
+    uint64_t chunks_count;
+    uint64_t count;
+    uint64_t half_hashes_chunks_offset;
+    uint64_t buckets_offset;
+    uint64_t keys_offset;
+    uint64_t keys_size;
+    uint64_t file_size;
+    // Of everything after the header, checked only if requested when opening the snapshot
+    uint64_t checksum;
+};
+
+typedef struct hashtable_snapshot_bucket hashtable_snapshot_bucket_t;
+struct hashtable_snapshot_bucket {
+    uint64_t key_offset;
+    uint32_t key_length;
+    uint64_t value;
+};
+
+typedef struct hashtable_snapshot hashtable_snapshot_t;
+struct hashtable_snapshot {
+    void* mapping;
+    uint64_t mapping_size;
+    uint64_t chunks_mask;
+    const hashtable_snapshot_header_t* header;
+    const hashtable_half_hashes_chunk_t* half_hashes_chunks;
+    const hashtable_snapshot_bucket_t* buckets;
+    const char* keys;
+};
+
+// Returns false, with errno set, if the file can't be written, the previous snapshot at path is left untouched. If sync
+// is true the temporary file is flushed to the disk before the rename and the directory after it, the snapshot
+// survives a crash of the system as well and not only of the process.
+bool hashtable_snapshot_write(
+        hashtable_t* hashtable,
+        const char* path,
+        bool sync);
+
+// Returns NULL if the file can't be opened or mapped or if it isn't a valid snapshot. The check of the checksum reads
+// the whole file, without it only the header is read.
+hashtable_snapshot_t* hashtable_snapshot_open(
+        const char* path,
+        bool verify_checksum);
+
+void hashtable_snapshot_close(
+        hashtable_snapshot_t* snapshot);
+
+bool hashtable_snapshot_lookup(
+        hashtable_snapshot_t* snapshot,
+        const char* key,
+        size_t key_length,
+        uintptr_t* value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //HASHTABLE_SNAPSHOT_H
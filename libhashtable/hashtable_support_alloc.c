@@ -0,0 +1,256 @@
+/**
+ * Copyright (C) 2020-2021 Daniele Salvatore Albano
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license.  See the LICENSE file for details.
+ **/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mman.h>
+
+#include "hashtable_support_alloc.h"
+
+// From linux/mempolicy.h, the numaif.h header is part of libnuma and mbind is invoked directly to not depend on it
+#define HASHTABLE_SUPPORT_ALLOC_MPOL_INTERLEAVE 3
+#define HASHTABLE_SUPPORT_ALLOC_MPOL_LOCAL 4
+#define HASHTABLE_SUPPORT_ALLOC_NUMA_NODES_MAX 64
+
+#define HASHTABLE_SUPPORT_ALLOC_PAGE_SIZE_4KB (4ul * 1024)
+#define HASHTABLE_SUPPORT_ALLOC_PAGE_SIZE_2MB (2ul * 1024 * 1024)
+#define HASHTABLE_SUPPORT_ALLOC_PAGE_SIZE_1GB (1024ul * 1024 * 1024)
+
+typedef struct hashtable_support_alloc_first_touch hashtable_support_alloc_first_touch_t;
+struct hashtable_support_alloc_first_touch {
+    pthread_t thread;
+    char* start;
+    size_t size;
+};
+
+static size_t hashtable_support_alloc_page_size(
+        hashtable_support_alloc_pages_t pages) {
+    switch (pages) {
+        case HASHTABLE_SUPPORT_ALLOC_PAGES_THP:
+        case HASHTABLE_SUPPORT_ALLOC_PAGES_HUGETLB_2MB:
+            return HASHTABLE_SUPPORT_ALLOC_PAGE_SIZE_2MB;
+        case HASHTABLE_SUPPORT_ALLOC_PAGES_HUGETLB_1GB:
+            return HASHTABLE_SUPPORT_ALLOC_PAGE_SIZE_1GB;
+        default:
+            return HASHTABLE_SUPPORT_ALLOC_PAGE_SIZE_4KB;
+    }
+}
+
+// Parses /sys/devices/system/node/online, e.g. 0-1,3
+static uint64_t hashtable_support_alloc_numa_online_nodes_mask(void) {
+    char buffer[256] = { 0 };
+    uint64_t nodes_mask = 0;
+    FILE* fp = fopen("/sys/devices/system/node/online", "r");
+
+    if (fp == NULL) {
+        return 1;
+    }
+
+    if (fgets(buffer, sizeof(buffer), fp) == NULL) {
+        fclose(fp);
+        return 1;
+    }
+    fclose(fp);
+
+    char* token = buffer;
+    while (*token != '\0' && *token != '\n') {
+        char* token_end;
+        long node_first = strtol(token, &token_end, 10);
+        long node_last = node_first;
+
+        if (*token_end == '-') {
+            node_last = strtol(token_end + 1, &token_end, 10);
+        }
+
+        for(long node = node_first; node <= node_last && node < HASHTABLE_SUPPORT_ALLOC_NUMA_NODES_MAX; node++) {
+            nodes_mask |= 1ull << node;
+        }
+
+        token = *token_end == ',' ? token_end + 1 : token_end;
+    }
+
+    return nodes_mask ? nodes_mask : 1;
+}
+
+static bool hashtable_support_alloc_numa_bind(
+        void* memptr,
+        size_t size,
+        hashtable_support_alloc_numa_t numa) {
+    long res = 0;
+
+    if (numa == HASHTABLE_SUPPORT_ALLOC_NUMA_LOCAL) {
+        res = syscall(SYS_mbind, memptr, size, HASHTABLE_SUPPORT_ALLOC_MPOL_LOCAL, NULL, 0, 0);
+    } else if (numa == HASHTABLE_SUPPORT_ALLOC_NUMA_INTERLEAVE) {
+        uint64_t nodes_mask = hashtable_support_alloc_numa_online_nodes_mask();
+        res = syscall(
+                SYS_mbind,
+                memptr,
+                size,
+                HASHTABLE_SUPPORT_ALLOC_MPOL_INTERLEAVE,
+                &nodes_mask,
+                HASHTABLE_SUPPORT_ALLOC_NUMA_NODES_MAX + 1,
+                0);
+    }
+
+    if (res != 0) {
+        perror("mbind");
+        return false;
+    }
+
+    return true;
+}
+
+static void* hashtable_support_alloc_first_touch_thread(
+        void* user_data) {
+    hashtable_support_alloc_first_touch_t* first_touch = user_data;
+    memset(first_touch->start, 0, first_touch->size);
+
+    return NULL;
+}
+
+static void hashtable_support_alloc_first_touch(
+        void* memptr,
+        size_t size,
+        size_t page_size,
+        uint32_t threads_count) {
+    size_t pages_count = size / page_size;
+    size_t pages_per_thread = (pages_count + threads_count - 1) / threads_count;
+    cpu_set_t cpuset_allowed;
+    uint32_t cpus_allowed[CPU_SETSIZE];
+    uint32_t cpus_allowed_count = 0;
+    hashtable_support_alloc_first_touch_t* first_touches;
+
+    // A single thread touches the pages from the caller, as a memset would
+    if (threads_count == 1) {
+        memset(memptr, 0, size);
+        return;
+    }
+
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &cpuset_allowed) != 0) {
+        perror("sched_getaffinity");
+        exit(-1);
+    }
+
+    for(uint32_t cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &cpuset_allowed)) {
+            cpus_allowed[cpus_allowed_count++] = cpu;
+        }
+    }
+
+    first_touches = malloc(sizeof(hashtable_support_alloc_first_touch_t) * threads_count);
+
+    // Each thread is pinned, round robin, to one of the cpus the caller can run on, the slice it touches is placed on
+    // the node of that cpu and not on the one the scheduler happened to pick
+    for(uint32_t index = 0; index < threads_count; index++) {
+        pthread_attr_t attr;
+        cpu_set_t cpuset;
+
+        size_t page_first = index * pages_per_thread < pages_count ? index * pages_per_thread : pages_count;
+        size_t page_last = page_first + pages_per_thread < pages_count ? page_first + pages_per_thread : pages_count;
+
+        first_touches[index].start = (char*)memptr + page_first * page_size;
+        first_touches[index].size = (page_last - page_first) * page_size;
+
+        CPU_ZERO(&cpuset);
+        CPU_SET(cpus_allowed[index % cpus_allowed_count], &cpuset);
+        pthread_attr_init(&attr);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpuset);
+
+        if (pthread_create(
+                &first_touches[index].thread,
+                &attr,
+                hashtable_support_alloc_first_touch_thread,
+                &first_touches[index]) != 0) {
+            perror("pthread_create");
+            exit(-1);
+        }
+
+        pthread_attr_destroy(&attr);
+    }
+
+    for(uint32_t index = 0; index < threads_count; index++) {
+        pthread_join(first_touches[index].thread, NULL);
+    }
+
+    free(first_touches);
+}
+
+void* hashtable_support_alloc(
+        size_t size,
+        const hashtable_support_alloc_policy_t* policy) {
+    void* memptr;
+    size_t page_size = hashtable_support_alloc_page_size(policy->pages);
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+    size = (size + page_size - 1) & ~(page_size - 1);
+
+    if (policy->pages == HASHTABLE_SUPPORT_ALLOC_PAGES_HUGETLB_2MB) {
+        flags |= MAP_HUGETLB | MAP_HUGE_2MB;
+    } else if (policy->pages == HASHTABLE_SUPPORT_ALLOC_PAGES_HUGETLB_1GB) {
+        flags |= MAP_HUGETLB | MAP_HUGE_1GB;
+    }
+
+    if (policy->pages == HASHTABLE_SUPPORT_ALLOC_PAGES_THP) {
+        // The transparent hugepages are used only for the 2MB aligned ranges, the mapping is extended to be able to
+        // align it and the excess is unmapped
+        char* mapping = mmap(NULL, size + page_size, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (mapping == MAP_FAILED) {
+            return NULL;
+        }
+
+        char* mapping_aligned = (char*)(((uintptr_t)mapping + page_size - 1) & ~(page_size - 1));
+        if (mapping_aligned > mapping) {
+            munmap(mapping, mapping_aligned - mapping);
+        }
+        munmap(mapping_aligned + size, (mapping + size + page_size) - (mapping_aligned + size));
+
+        memptr = mapping_aligned;
+        madvise(memptr, size, MADV_HUGEPAGE);
+    } else {
+        memptr = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (memptr == MAP_FAILED) {
+            return NULL;
+        }
+
+        if (policy->pages == HASHTABLE_SUPPORT_ALLOC_PAGES_4KB) {
+            madvise(memptr, size, MADV_NOHUGEPAGE);
+        }
+    }
+
+    // The policy has to be in place before the pages are touched
+    if (!hashtable_support_alloc_numa_bind(memptr, size, policy->numa)) {
+        munmap(memptr, size);
+        return NULL;
+    }
+
+    if (policy->first_touch_threads > 0) {
+        hashtable_support_alloc_first_touch(memptr, size, page_size, policy->first_touch_threads);
+    }
+
+    return memptr;
+}
+
+void hashtable_support_alloc_free(
+        void* memptr,
+        size_t size,
+        const hashtable_support_alloc_policy_t* policy) {
+    size_t page_size = hashtable_support_alloc_page_size(policy->pages);
+    size = (size + page_size - 1) & ~(page_size - 1);
+
+    munmap(memptr, size);
+}
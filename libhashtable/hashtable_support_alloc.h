@@ -0,0 +1,63 @@
+#ifndef HASHTABLE_SUPPORT_ALLOC_H
+#define HASHTABLE_SUPPORT_ALLOC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Allocation of the large bucket arrays with control over the page size, the NUMA placement and how the pages are
+// first touched, the memory is always mapped directly with mmap and returned zeroed.
+
+enum hashtable_support_alloc_pages {
+    // 4KB pages, the transparent hugepages are explicitly disabled for the mapping
+    HASHTABLE_SUPPORT_ALLOC_PAGES_4KB = 0,
+    // Transparent hugepages, the mapping is 2MB aligned and madvised, the kernel may still fall back to 4KB pages
+    HASHTABLE_SUPPORT_ALLOC_PAGES_THP,
+    // Explicit hugepages from the hugetlbfs pool, they have to be reserved in advance (vm.nr_hugepages or
+    // /sys/kernel/mm/hugepages/hugepages-1048576kB/nr_hugepages), the allocation fails if there aren't enough
+    HASHTABLE_SUPPORT_ALLOC_PAGES_HUGETLB_2MB,
+    HASHTABLE_SUPPORT_ALLOC_PAGES_HUGETLB_1GB,
+};
+typedef enum hashtable_support_alloc_pages hashtable_support_alloc_pages_t;
+
+enum hashtable_support_alloc_numa {
+    // Whatever the policy of the thread touching the page first is, usually the local node of that thread
+    HASHTABLE_SUPPORT_ALLOC_NUMA_DEFAULT = 0,
+    // Bound to the node of the thread touching the page first, even if the thread policy says otherwise
+    HASHTABLE_SUPPORT_ALLOC_NUMA_LOCAL,
+    // Spread page by page across all the online nodes
+    HASHTABLE_SUPPORT_ALLOC_NUMA_INTERLEAVE,
+};
+typedef enum hashtable_support_alloc_numa hashtable_support_alloc_numa_t;
+
+typedef struct hashtable_support_alloc_policy hashtable_support_alloc_policy_t;
+struct hashtable_support_alloc_policy {
+    hashtable_support_alloc_pages_t pages;
+    hashtable_support_alloc_numa_t numa;
+    // Number of threads touching the pages before returning the memory, each takes a contiguous slice and is pinned to
+    // one of the cpus the caller can run on, in order. 1 touches the pages from the calling thread, 0 doesn't touch
+    // them and leaves the placement to the first access of the caller
+    uint32_t first_touch_threads;
+};
+
+// Returns NULL if the memory can't be allocated with the requested policy (e.g. no hugepages reserved), size is rounded
+// up to the page size
+void* hashtable_support_alloc(
+        size_t size,
+        const hashtable_support_alloc_policy_t* policy);
+
+// size and policy have to match the ones passed to hashtable_support_alloc
+void hashtable_support_alloc_free(
+        void* memptr,
+        size_t size,
+        const hashtable_support_alloc_policy_t* policy);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //HASHTABLE_SUPPORT_ALLOC_H
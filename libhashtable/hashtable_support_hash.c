@@ -0,0 +1,369 @@
+/**
+ * Copyright (C) 2020-2021 Daniele Salvatore Albano
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license.  See the LICENSE file for details.
+ **/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdbool.h>
+#include <immintrin.h>
+
+#include "hashtable_support_hash.h"
+
+#define HASHTABLE_SUPPORT_HASH_PAGE_SIZE 4096
+
+#define HASHTABLE_SUPPORT_HASH_PRIME64_1 0x9E3779B185EBCA87ull
+#define HASHTABLE_SUPPORT_HASH_PRIME64_2 0xC2B2AE3D27D4EB4Full
+#define HASHTABLE_SUPPORT_HASH_PRIME64_3 0x165667B19E3779F9ull
+
+// Xor-ed with the words of the blocks before the multiply, the blocks use them in turn
+static const uint64_t hashtable_support_hash_casefold_secret[8] = {
+        0xBE4BA423396CFEB8ull, 0x1CAD21F72C81017Cull, 0xDB979083E96DD4DEull, 0x1F67B3B7A4A44072ull,
+        0x78E5C0CC4EE679CBull, 0x2172FFCC7DD05A82ull, 0x8E2443F7744608B8ull, 0x4C263A81E69035E0ull,
+};
+
+// 32 bytes set followed by 32 bytes cleared, loading from 32 - length gives the mask of the first length bytes
+static const uint8_t hashtable_support_hash_casefold_len_mask[64] __attribute__((aligned(64))) = {
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+// MurmurHash64A, the lower bits select the chunk and the upper half becomes the half hash so both ends need to be
+// well mixed
+hashtable_hash_t hashtable_support_hash_calculate(
+        const char* key,
+        size_t key_length) {
+    const uint64_t m = 0xC6A4A7935BD1E995ull;
+    const int r = 47;
+    uint64_t hash = HASHTABLE_SUPPORT_HASH_SEED ^ (key_length * m);
+    const char* key_end = key + (key_length & ~(size_t)7);
+
+    for(; key < key_end; key += 8) {
+        uint64_t k;
+        memcpy(&k, key, sizeof(k));
+
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+
+        hash ^= k;
+        hash *= m;
+    }
+
+    switch (key_length & 7) {
+        case 7: hash ^= (uint64_t)(uint8_t)key[6] << 48; // fall through
+        case 6: hash ^= (uint64_t)(uint8_t)key[5] << 40; // fall through
+        case 5: hash ^= (uint64_t)(uint8_t)key[4] << 32; // fall through
+        case 4: hash ^= (uint64_t)(uint8_t)key[3] << 24; // fall through
+        case 3: hash ^= (uint64_t)(uint8_t)key[2] << 16; // fall through
+        case 2: hash ^= (uint64_t)(uint8_t)key[1] << 8; // fall through
+        case 1: hash ^= (uint64_t)(uint8_t)key[0];
+            hash *= m;
+    }
+
+    hash ^= hash >> r;
+    hash *= m;
+    hash ^= hash >> r;
+
+    return hash;
+}
+
+static inline uint64_t hashtable_support_hash_mul128_fold64(
+        uint64_t a,
+        uint64_t b) {
+    __uint128_t product = (__uint128_t)a * b;
+
+    return (uint64_t)product ^ (uint64_t)(product >> 64);
+}
+
+static inline uint64_t hashtable_support_hash_casefold_init(
+        size_t key_length) {
+    return HASHTABLE_SUPPORT_HASH_SEED ^ (key_length * HASHTABLE_SUPPORT_HASH_PRIME64_3);
+}
+
+// The rotation and the multiply make the hash depend on the order of the blocks
+static inline uint64_t hashtable_support_hash_casefold_mix_block(
+        uint64_t hash,
+        uint64_t block_low,
+        uint64_t block_high,
+        size_t block_index) {
+    const uint64_t* secret = &hashtable_support_hash_casefold_secret[(block_index & 3) * 2];
+
+    hash += hashtable_support_hash_mul128_fold64(block_low ^ secret[0], block_high ^ secret[1]);
+
+    return ((hash << 23) | (hash >> 41)) * HASHTABLE_SUPPORT_HASH_PRIME64_1;
+}
+
+static inline hashtable_hash_t hashtable_support_hash_casefold_avalanche(
+        uint64_t hash) {
+    hash ^= hash >> 37;
+    hash *= HASHTABLE_SUPPORT_HASH_PRIME64_2;
+    hash ^= hash >> 32;
+
+    return hash;
+}
+
+static inline bool hashtable_support_hash_block_crosses_page(
+        const char* ptr,
+        size_t block_size) {
+    uintptr_t page_offset = (uintptr_t)ptr & (HASHTABLE_SUPPORT_HASH_PAGE_SIZE - 1);
+
+    return page_offset > HASHTABLE_SUPPORT_HASH_PAGE_SIZE - block_size;
+}
+
+// Returns from where a block holding the last tail_length bytes of the key can be loaded, the key itself if the block
+// doesn't cross a page boundary otherwise the bytes are copied in buffer. The bytes after tail_length are masked out.
+static inline const char* hashtable_support_hash_tail_block(
+        const char* tail,
+        size_t tail_length,
+        size_t block_size,
+        char* buffer) {
+    if (!hashtable_support_hash_block_crosses_page(tail, block_size)) {
+        return tail;
+    }
+
+    memcpy(buffer, tail, tail_length);
+
+    return buffer;
+}
+
+hashtable_hash_t hashtable_support_hash_casefold_scalar(
+        const char* key,
+        size_t key_length) {
+    uint64_t hash = hashtable_support_hash_casefold_init(key_length);
+
+    for(size_t index = 0; index < key_length; index += 16) {
+        uint64_t block[2] = { 0 };
+        size_t block_length = key_length - index < 16 ? key_length - index : 16;
+        uint8_t* block_bytes = (uint8_t*)block;
+
+        memcpy(block, key + index, block_length);
+        for(size_t block_byte_index = 0; block_byte_index < block_length; block_byte_index++) {
+            if (block_bytes[block_byte_index] >= 'A' && block_bytes[block_byte_index] <= 'Z') {
+                block_bytes[block_byte_index] |= 0x20;
+            }
+        }
+
+        hash = hashtable_support_hash_casefold_mix_block(hash, block[0], block[1], index / 16);
+    }
+
+    return hashtable_support_hash_casefold_avalanche(hash);
+}
+
+__attribute__((__target__("sse4.2")))
+static inline __m128i hashtable_support_hash_lowercase_sse42(
+        __m128i block) {
+    __m128i letters_uppercase_lower_mask = _mm_cmpgt_epi8(block, _mm_set1_epi8(0x40));
+    __m128i letters_uppercase_upper_mask = _mm_cmpgt_epi8(block, _mm_set1_epi8(0x5a));
+    __m128i letters_uppercase_mask = _mm_andnot_si128(letters_uppercase_upper_mask, letters_uppercase_lower_mask);
+
+    return _mm_or_si128(block, _mm_and_si128(letters_uppercase_mask, _mm_set1_epi8(0x20)));
+}
+
+__attribute__((__target__("sse4.2")))
+static inline uint64_t hashtable_support_hash_casefold_mix_sse42(
+        uint64_t hash,
+        __m128i block,
+        size_t block_index) {
+    block = hashtable_support_hash_lowercase_sse42(block);
+
+    return hashtable_support_hash_casefold_mix_block(
+            hash,
+            (uint64_t)_mm_cvtsi128_si64(block),
+            (uint64_t)_mm_extract_epi64(block, 1),
+            block_index);
+}
+
+__attribute__((__target__("sse4.2")))
+hashtable_hash_t hashtable_support_hash_casefold_sse42(
+        const char* key,
+        size_t key_length) {
+    uint64_t hash = hashtable_support_hash_casefold_init(key_length);
+    size_t index = 0;
+
+    for(; index + 16 <= key_length; index += 16) {
+        hash = hashtable_support_hash_casefold_mix_sse42(
+                hash,
+                _mm_loadu_si128((__m128i*)(key + index)),
+                index / 16);
+    }
+
+    size_t tail_length = key_length - index;
+    if (tail_length > 0) {
+        char tail_buffer[16];
+        __m128i block = _mm_and_si128(
+                _mm_loadu_si128((__m128i*)hashtable_support_hash_tail_block(
+                        key + index, tail_length, 16, tail_buffer)),
+                _mm_loadu_si128((__m128i*)&hashtable_support_hash_casefold_len_mask[32 - tail_length]));
+
+        hash = hashtable_support_hash_casefold_mix_sse42(hash, block, index / 16);
+    }
+
+    return hashtable_support_hash_casefold_avalanche(hash);
+}
+
+__attribute__((__target__("avx2")))
+static inline __m256i hashtable_support_hash_lowercase_avx2(
+        __m256i block) {
+    __m256i letters_uppercase_lower_mask = _mm256_cmpgt_epi8(block, _mm256_set1_epi8(0x40));
+    __m256i letters_uppercase_upper_mask = _mm256_cmpgt_epi8(block, _mm256_set1_epi8(0x5a));
+    __m256i letters_uppercase_mask = _mm256_andnot_si256(letters_uppercase_upper_mask, letters_uppercase_lower_mask);
+
+    return _mm256_or_si256(block, _mm256_and_si256(letters_uppercase_mask, _mm256_set1_epi8(0x20)));
+}
+
+// Mixes the first blocks_count blocks of 16 bytes of a 32 bytes block
+__attribute__((__target__("avx2")))
+static inline uint64_t hashtable_support_hash_casefold_mix_avx2(
+        uint64_t hash,
+        __m256i block,
+        size_t block_index,
+        size_t blocks_count) {
+    block = hashtable_support_hash_lowercase_avx2(block);
+
+    hash = hashtable_support_hash_casefold_mix_block(
+            hash,
+            (uint64_t)_mm256_extract_epi64(block, 0),
+            (uint64_t)_mm256_extract_epi64(block, 1),
+            block_index);
+
+    if (blocks_count > 1) {
+        hash = hashtable_support_hash_casefold_mix_block(
+                hash,
+                (uint64_t)_mm256_extract_epi64(block, 2),
+                (uint64_t)_mm256_extract_epi64(block, 3),
+                block_index + 1);
+    }
+
+    return hash;
+}
+
+__attribute__((__target__("avx2")))
+hashtable_hash_t hashtable_support_hash_casefold_avx2(
+        const char* key,
+        size_t key_length) {
+    uint64_t hash = hashtable_support_hash_casefold_init(key_length);
+    size_t index = 0;
+
+    for(; index + 32 <= key_length; index += 32) {
+        hash = hashtable_support_hash_casefold_mix_avx2(
+                hash,
+                _mm256_loadu_si256((__m256i*)(key + index)),
+                index / 16,
+                2);
+    }
+
+    size_t tail_length = key_length - index;
+    if (tail_length > 0) {
+        char tail_buffer[32];
+        __m256i block = _mm256_and_si256(
+                _mm256_loadu_si256((__m256i*)hashtable_support_hash_tail_block(
+                        key + index, tail_length, 32, tail_buffer)),
+                _mm256_loadu_si256((__m256i*)&hashtable_support_hash_casefold_len_mask[32 - tail_length]));
+
+        hash = hashtable_support_hash_casefold_mix_avx2(hash, block, index / 16, (tail_length + 15) / 16);
+    }
+
+    return hashtable_support_hash_casefold_avalanche(hash);
+}
+
+__attribute__((__target__("avx512bw")))
+static inline __m512i hashtable_support_hash_lowercase_avx512bw(
+        __m512i block) {
+    __mmask64 letters_uppercase_mask = _mm512_cmple_epu8_mask(
+            _mm512_sub_epi8(block, _mm512_set1_epi8('A')), _mm512_set1_epi8('Z' - 'A'));
+
+    return _mm512_mask_add_epi8(block, letters_uppercase_mask, block, _mm512_set1_epi8(0x20));
+}
+
+// Mixes the first blocks_count blocks of 16 bytes of a 64 bytes block
+__attribute__((__target__("avx512bw")))
+static inline uint64_t hashtable_support_hash_casefold_mix_avx512bw(
+        uint64_t hash,
+        __m512i block,
+        size_t block_index,
+        size_t blocks_count) {
+    uint64_t words[8] __attribute__((aligned(64)));
+
+    _mm512_store_si512(words, hashtable_support_hash_lowercase_avx512bw(block));
+
+    for(size_t block_offset = 0; block_offset < blocks_count; block_offset++) {
+        hash = hashtable_support_hash_casefold_mix_block(
+                hash,
+                words[block_offset * 2],
+                words[block_offset * 2 + 1],
+                block_index + block_offset);
+    }
+
+    return hash;
+}
+
+__attribute__((__target__("avx512bw")))
+hashtable_hash_t hashtable_support_hash_casefold_avx512bw(
+        const char* key,
+        size_t key_length) {
+    uint64_t hash = hashtable_support_hash_casefold_init(key_length);
+    size_t index = 0;
+
+    for(; index + 64 <= key_length; index += 64) {
+        hash = hashtable_support_hash_casefold_mix_avx512bw(
+                hash,
+                _mm512_loadu_si512(key + index),
+                index / 16,
+                4);
+    }
+
+    // As in hashtable_cmp_eq_str_avx512bw the masked load is used only when the block doesn't cross a page boundary,
+    // the fault suppression of the bytes excluded by the mask is too expensive
+    size_t tail_length = key_length - index;
+    if (tail_length > 0) {
+        char tail_buffer[64];
+        __mmask64 tail_mask = (__mmask64)((1ull << tail_length) - 1);
+        __m512i block = _mm512_maskz_loadu_epi8(
+                tail_mask,
+                hashtable_support_hash_tail_block(key + index, tail_length, 64, tail_buffer));
+
+        hash = hashtable_support_hash_casefold_mix_avx512bw(hash, block, index / 16, (tail_length + 15) / 16);
+    }
+
+    return hashtable_support_hash_casefold_avalanche(hash);
+}
+
+static hashtable_support_hash_casefold_fp_t* hashtable_support_hash_casefold_select(
+        const char** isa) {
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512bw")) {
+        *isa = "avx512bw";
+        return hashtable_support_hash_casefold_avx512bw;
+    } else if (__builtin_cpu_supports("avx2")) {
+        *isa = "avx2";
+        return hashtable_support_hash_casefold_avx2;
+    } else if (__builtin_cpu_supports("sse4.2")) {
+        *isa = "sse4.2";
+        return hashtable_support_hash_casefold_sse42;
+    }
+
+    *isa = "scalar";
+    return hashtable_support_hash_casefold_scalar;
+}
+
+static hashtable_support_hash_casefold_fp_t* hashtable_support_hash_casefold_resolve(void) {
+    const char* isa;
+    return hashtable_support_hash_casefold_select(&isa);
+}
+
+hashtable_hash_t hashtable_support_hash_casefold_calculate(
+        const char* key,
+        size_t key_length) __attribute__((ifunc("hashtable_support_hash_casefold_resolve")));
+
+const char* hashtable_support_hash_casefold_isa(void) {
+    const char* isa;
+    hashtable_support_hash_casefold_select(&isa);
+
+    return isa;
+}
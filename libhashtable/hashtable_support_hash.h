@@ -0,0 +1,56 @@
+#ifndef HASHTABLE_SUPPORT_HASH_H
+#define HASHTABLE_SUPPORT_HASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint64_t hashtable_hash_t;
+typedef uint32_t hashtable_half_hash_t;
+
+#define HASHTABLE_SUPPORT_HASH_SEED 0x5BD1E9955BD1E995ull
+
+hashtable_hash_t hashtable_support_hash_calculate(
+        const char* key,
+        size_t key_length);
+
+// Case insensitive hash, only the ASCII letters are folded. The key is read once, 16 bytes at a time: each block is
+// folded in register with the same upper case range compares of hashtable_casecmp_eq_str_32 and mixed with a 64x64 bits
+// multiply folded to 64 bits, as xxh3 does for the short inputs. All the variants return the same hash, the bytes past
+// the end of the key are never read.
+typedef hashtable_hash_t (hashtable_support_hash_casefold_fp_t)(
+        const char* key,
+        size_t key_length);
+
+// The variant is picked via ifunc when the binary is loaded
+hashtable_hash_t hashtable_support_hash_casefold_calculate(
+        const char* key,
+        size_t key_length);
+
+// Name of the instruction set of the variant picked (scalar, sse4.2, avx2 or avx512bw)
+const char* hashtable_support_hash_casefold_isa(void);
+
+hashtable_hash_t hashtable_support_hash_casefold_scalar(
+        const char* key,
+        size_t key_length);
+
+hashtable_hash_t hashtable_support_hash_casefold_sse42(
+        const char* key,
+        size_t key_length);
+
+hashtable_hash_t hashtable_support_hash_casefold_avx2(
+        const char* key,
+        size_t key_length);
+
+hashtable_hash_t hashtable_support_hash_casefold_avx512bw(
+        const char* key,
+        size_t key_length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //HASHTABLE_SUPPORT_HASH_H
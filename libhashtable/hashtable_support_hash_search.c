@@ -0,0 +1,232 @@
+/**
+ * Copyright (C) 2020-2021 Daniele Salvatore Albano
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license.  See the LICENSE file for details.
+ **/
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include "hashtable_support_hash_search.h"
+
+uint32_t hashtable_linear_search_scalar_16(
+        uint32_t half_hash,
+        uint32_t* half_hashes,
+        uint32_t skip_indexes_mask) {
+    for(uint32_t index = 0; index < 16; index++) {
+        if (half_hashes[index] == half_hash && (skip_indexes_mask & (1u << index)) == 0) {
+            return index;
+        }
+    }
+
+    return HASHTABLE_MCMP_SUPPORT_HASH_SEARCH_NOT_FOUND;
+}
+
+__attribute__((__target__("sse4.2")))
+uint32_t hashtable_linear_search_sse42_16(
+        uint32_t half_hash,
+        uint32_t* half_hashes,
+        uint32_t skip_indexes_mask) {
+    uint32_t compacted_result_mask = 0;
+    __m128i cmp_vector = _mm_set1_epi32((int)half_hash);
+
+    for(uint8_t base_index = 0; base_index < 16; base_index += 4) {
+        __m128i ring_vector = _mm_loadu_si128((__m128i*) (half_hashes + base_index));
+        __m128i result_mask_vector = _mm_cmpeq_epi32(ring_vector, cmp_vector);
+
+        compacted_result_mask |= (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(result_mask_vector)) << (base_index);
+    }
+
+    compacted_result_mask &= ~skip_indexes_mask & 0xFFFFu;
+
+    // tzcnt is not part of sse4.2, bsf is undefined for 0 so the not found case is handled explicitly
+    return compacted_result_mask == 0
+        ? HASHTABLE_MCMP_SUPPORT_HASH_SEARCH_NOT_FOUND
+        : (uint32_t)__builtin_ctz(compacted_result_mask);
+}
+
+__attribute__((__target__("avx2,bmi")))
+uint32_t hashtable_linear_search_avx2_16(
+        uint32_t half_hash,
+        uint32_t* half_hashes,
+        uint32_t skip_indexes_mask) {
+    uint32_t compacted_result_mask = 0;
+    uint32_t skip_indexes_mask_inv = ~skip_indexes_mask;
+    __m256i cmp_vector = _mm256_set1_epi32(half_hash);
+
+    for(uint8_t base_index = 0; base_index < 16; base_index += 8) {
+        __m256i ring_vector = _mm256_loadu_si256((__m256i*) (half_hashes + base_index));
+        __m256i result_mask_vector = _mm256_cmpeq_epi32(ring_vector, cmp_vector);
+
+        // Uses _mm256_movemask_ps to reduce the bandwidth
+        compacted_result_mask |= (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(result_mask_vector)) << (base_index);
+    }
+
+    return _tzcnt_u32(compacted_result_mask & skip_indexes_mask_inv);
+}
+
+__attribute__((__target__("avx512f,bmi")))
+uint32_t hashtable_linear_search_avx512f_16(
+        uint32_t half_hash,
+        uint32_t* half_hashes,
+        uint32_t skip_indexes_mask) {
+    __m512i cmp_vector = _mm512_set1_epi32((int)half_hash);
+    __m512i chunk_vector = _mm512_loadu_si512(half_hashes);
+
+    // The skip mask is inverted and used directly as the write mask of the compare, the bits above 16 are ignored
+    __mmask16 result_mask = _mm512_mask_cmpeq_epi32_mask((__mmask16)~skip_indexes_mask, chunk_vector, cmp_vector);
+
+    // tzcnt of the mask widened to 32 bits returns 32 when there are no matches, as for the avx2 version
+    return _tzcnt_u32((uint32_t)result_mask);
+}
+
+__attribute__((__target__("avx512bw,bmi")))
+uint32_t hashtable_linear_search_avx512bw_32(
+        uint16_t tag,
+        uint16_t* tags,
+        uint32_t skip_indexes_mask) {
+    __m512i cmp_vector = _mm512_set1_epi16((short)tag);
+    __m512i chunk_vector = _mm512_loadu_si512(tags);
+
+    __mmask32 result_mask = _mm512_mask_cmpeq_epi16_mask((__mmask32)~skip_indexes_mask, chunk_vector, cmp_vector);
+
+    return _tzcnt_u32((uint32_t)result_mask);
+}
+
+__attribute__((__target__("avx512bw,bmi")))
+uint32_t hashtable_linear_search_avx512bw_64(
+        uint16_t tag,
+        uint16_t* tags,
+        uint64_t skip_indexes_mask) {
+    __m512i cmp_vector = _mm512_set1_epi16((short)tag);
+    __m512i chunk_vector_low = _mm512_loadu_si512(tags);
+    __m512i chunk_vector_high = _mm512_loadu_si512(tags + 32);
+    uint64_t skip_indexes_mask_inv = ~skip_indexes_mask;
+
+    uint64_t result_mask =
+            (uint64_t)_mm512_mask_cmpeq_epi16_mask(
+                    (__mmask32)skip_indexes_mask_inv, chunk_vector_low, cmp_vector) |
+            ((uint64_t)_mm512_mask_cmpeq_epi16_mask(
+                    (__mmask32)(skip_indexes_mask_inv >> 32), chunk_vector_high, cmp_vector) << 32);
+
+    return (uint32_t)_tzcnt_u64(result_mask);
+}
+
+uint32_t hashtable_control_bytes_search_scalar_32(
+        uint8_t tag,
+        uint8_t* control_bytes,
+        uint32_t skip_indexes_mask) {
+    for(uint32_t index = 0; index < HASHTABLE_CONTROL_BYTES_CHUNK_SLOTS; index++) {
+        if (control_bytes[index] == tag && (skip_indexes_mask & (1u << index)) == 0) {
+            return index;
+        }
+    }
+
+    return HASHTABLE_MCMP_SUPPORT_HASH_SEARCH_NOT_FOUND;
+}
+
+__attribute__((__target__("sse4.2")))
+uint32_t hashtable_control_bytes_search_sse42_32(
+        uint8_t tag,
+        uint8_t* control_bytes,
+        uint32_t skip_indexes_mask) {
+    __m128i cmp_vector = _mm_set1_epi8((char)tag);
+    __m128i chunk_vector_low = _mm_loadu_si128((__m128i*)control_bytes);
+    __m128i chunk_vector_high = _mm_loadu_si128((__m128i*)(control_bytes + 16));
+
+    uint32_t compacted_result_mask =
+            (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk_vector_low, cmp_vector)) |
+            ((uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk_vector_high, cmp_vector)) << 16);
+
+    compacted_result_mask &= ~skip_indexes_mask;
+
+    return compacted_result_mask == 0
+        ? HASHTABLE_MCMP_SUPPORT_HASH_SEARCH_NOT_FOUND
+        : (uint32_t)__builtin_ctz(compacted_result_mask);
+}
+
+__attribute__((__target__("avx2,bmi")))
+uint32_t hashtable_control_bytes_search_avx2_32(
+        uint8_t tag,
+        uint8_t* control_bytes,
+        uint32_t skip_indexes_mask) {
+    __m256i cmp_vector = _mm256_set1_epi8((char)tag);
+    __m256i chunk_vector = _mm256_loadu_si256((__m256i*)control_bytes);
+
+    uint32_t compacted_result_mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk_vector, cmp_vector));
+
+    return _tzcnt_u32(compacted_result_mask & ~skip_indexes_mask);
+}
+
+static hashtable_linear_search_16_fp_t* hashtable_linear_search_16_select(
+        const char** isa) {
+    // The resolver can run before the constructors, the cpu features have to be initialized explicitly
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("bmi")) {
+        *isa = "avx512f";
+        return hashtable_linear_search_avx512f_16;
+    } else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi")) {
+        *isa = "avx2";
+        return hashtable_linear_search_avx2_16;
+    } else if (__builtin_cpu_supports("sse4.2")) {
+        *isa = "sse4.2";
+        return hashtable_linear_search_sse42_16;
+    }
+
+    *isa = "scalar";
+    return hashtable_linear_search_scalar_16;
+}
+
+static hashtable_linear_search_16_fp_t* hashtable_linear_search_16_resolve(void) {
+    const char* isa;
+    return hashtable_linear_search_16_select(&isa);
+}
+
+uint32_t hashtable_linear_search_16(
+        uint32_t half_hash,
+        uint32_t* half_hashes,
+        uint32_t skip_indexes_mask) __attribute__((ifunc("hashtable_linear_search_16_resolve")));
+
+const char* hashtable_linear_search_16_isa(void) {
+    const char* isa;
+    hashtable_linear_search_16_select(&isa);
+
+    return isa;
+}
+
+static hashtable_control_bytes_search_32_fp_t* hashtable_control_bytes_search_32_select(
+        const char** isa) {
+    __builtin_cpu_init();
+
+    // 32 control bytes fit in a ymm register, avx-512 wouldn't save any compare
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi")) {
+        *isa = "avx2";
+        return hashtable_control_bytes_search_avx2_32;
+    } else if (__builtin_cpu_supports("sse4.2")) {
+        *isa = "sse4.2";
+        return hashtable_control_bytes_search_sse42_32;
+    }
+
+    *isa = "scalar";
+    return hashtable_control_bytes_search_scalar_32;
+}
+
+static hashtable_control_bytes_search_32_fp_t* hashtable_control_bytes_search_32_resolve(void) {
+    const char* isa;
+    return hashtable_control_bytes_search_32_select(&isa);
+}
+
+uint32_t hashtable_control_bytes_search_32(
+        uint8_t tag,
+        uint8_t* control_bytes,
+        uint32_t skip_indexes_mask) __attribute__((ifunc("hashtable_control_bytes_search_32_resolve")));
+
+const char* hashtable_control_bytes_search_32_isa(void) {
+    const char* isa;
+    hashtable_control_bytes_search_32_select(&isa);
+
+    return isa;
+}
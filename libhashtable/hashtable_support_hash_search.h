@@ -0,0 +1,110 @@
+#ifndef HASHTABLE_SUPPORT_HASH_SEARCH_H
+#define HASHTABLE_SUPPORT_HASH_SEARCH_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HASHTABLE_MCMP_SUPPORT_HASH_SEARCH_NOT_FOUND     32u
+#define HASHTABLE_MCMP_SUPPORT_HASH_SEARCH_NOT_FOUND_64  64u
+
+// Control bytes, SwissTable style, one byte per slot: a full slot holds a 7 bits tag taken from the hash with the high
+// bit clear, the empty and deleted slots have the high bit set so they never match a tag
+#define HASHTABLE_CONTROL_BYTE_EMPTY    0x80u
+#define HASHTABLE_CONTROL_BYTE_DELETED  0xFEu
+#define HASHTABLE_CONTROL_BYTES_CHUNK_SLOTS 32
+
+typedef uint32_t (hashtable_linear_search_16_fp_t)(
+        uint32_t half_hash,
+        uint32_t* half_hashes,
+        uint32_t skip_indexes_mask);
+
+// Returns the index of the first of the 16 half hashes matching half_hash and not excluded by skip_indexes_mask, or
+// HASHTABLE_MCMP_SUPPORT_HASH_SEARCH_NOT_FOUND. The variant matching the best instruction set available on the cpu is
+// picked once, when the binary is loaded, via ifunc.
+uint32_t hashtable_linear_search_16(
+        uint32_t half_hash,
+        uint32_t* half_hashes,
+        uint32_t skip_indexes_mask);
+
+// Name of the instruction set of the variant picked by hashtable_linear_search_16 (scalar, sse4.2, avx2 or avx512f)
+const char* hashtable_linear_search_16_isa(void);
+
+// The variants below can be called directly but only if the cpu supports the related instruction set
+uint32_t hashtable_linear_search_scalar_16(
+        uint32_t half_hash,
+        uint32_t* half_hashes,
+        uint32_t skip_indexes_mask);
+
+uint32_t hashtable_linear_search_sse42_16(
+        uint32_t half_hash,
+        uint32_t* half_hashes,
+        uint32_t skip_indexes_mask);
+
+uint32_t hashtable_linear_search_avx2_16(
+        uint32_t half_hash,
+        uint32_t* half_hashes,
+        uint32_t skip_indexes_mask);
+
+// Same contract as hashtable_linear_search_avx2_16, the 16 half hashes are compared at once into a mask register
+uint32_t hashtable_linear_search_avx512f_16(
+        uint32_t half_hash,
+        uint32_t* half_hashes,
+        uint32_t skip_indexes_mask);
+
+// Variants for chunks of 16 bits tags (e.g. the hash quarters), 32 tags fit in a single compare and 64 tags, a whole
+// probe window of 4 chunks of 16 half hashes, in two
+uint32_t hashtable_linear_search_avx512bw_32(
+        uint16_t tag,
+        uint16_t* tags,
+        uint32_t skip_indexes_mask);
+
+// Returns HASHTABLE_MCMP_SUPPORT_HASH_SEARCH_NOT_FOUND_64 if there are no matches
+uint32_t hashtable_linear_search_avx512bw_64(
+        uint16_t tag,
+        uint16_t* tags,
+        uint64_t skip_indexes_mask);
+
+static inline uint8_t hashtable_control_byte_from_hash(
+        uint64_t hash) {
+    return (uint8_t)(hash >> 57);
+}
+
+typedef uint32_t (hashtable_control_bytes_search_32_fp_t)(
+        uint8_t tag,
+        uint8_t* control_bytes,
+        uint32_t skip_indexes_mask);
+
+// Returns the index of the first of the 32 control bytes matching tag and not excluded by skip_indexes_mask, or
+// HASHTABLE_MCMP_SUPPORT_HASH_SEARCH_NOT_FOUND, picked via ifunc as hashtable_linear_search_16
+uint32_t hashtable_control_bytes_search_32(
+        uint8_t tag,
+        uint8_t* control_bytes,
+        uint32_t skip_indexes_mask);
+
+// Name of the instruction set of the variant picked by hashtable_control_bytes_search_32 (scalar, sse4.2 or avx2)
+const char* hashtable_control_bytes_search_32_isa(void);
+
+uint32_t hashtable_control_bytes_search_scalar_32(
+        uint8_t tag,
+        uint8_t* control_bytes,
+        uint32_t skip_indexes_mask);
+
+uint32_t hashtable_control_bytes_search_sse42_32(
+        uint8_t tag,
+        uint8_t* control_bytes,
+        uint32_t skip_indexes_mask);
+
+// The 32 control bytes are compared with a single _mm256_cmpeq_epi8
+uint32_t hashtable_control_bytes_search_avx2_32(
+        uint8_t tag,
+        uint8_t* control_bytes,
+        uint32_t skip_indexes_mask);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //HASHTABLE_SUPPORT_HASH_SEARCH_H
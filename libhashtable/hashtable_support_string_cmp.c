@@ -0,0 +1,764 @@
+/**
+ * Copyright (C) 2020-2021 Daniele Salvatore Albano
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license.  See the LICENSE file for details.
+ **/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include <immintrin.h>
+
+#include "hashtable_support_string_cmp.h"
+
+#define HASHTABLE_SUPPORT_STRING_CMP_PAGE_SIZE 4096
+
+static uint32_t len_mask_table[33] = {
+        0x0000, 0x0001, 0x0003, 0x0007, 0x000f, 0x001f, 0x003f, 0x007f, 0x00ff,
+        0x01ff, 0x03ff, 0x07ff, 0x0fff, 0x1fff, 0x3fff, 0x7fff, 0xffff, 0x1ffff,
+        0x3ffff, 0x7ffff, 0xfffff, 0x1fffff, 0x3fffff, 0x7fffff, 0xffffff,
+        0x1ffffff, 0x3ffffff, 0x7ffffff, 0xfffffff, 0x1fffffff, 0x3fffffff,
+        0x7fffffff, 0xffffffff,
+};
+
+static inline char hashtable_casecmp_fold(
+        char c) {
+    return c >= 'A' && c <= 'Z' ? (char)(c | 0x20) : c;
+}
+
+int hashtable_casecmp_eq_str_scalar_32(
+        const char a[32],
+        size_t a_len,
+        const char b[32],
+        size_t b_len) {
+    assert(a_len <= 32);
+    assert(b_len <= 32);
+
+    if (a_len != b_len) {
+        return false;
+    }
+
+    for(size_t index = 0; index < a_len; index++) {
+        if (hashtable_casecmp_fold(a[index]) != hashtable_casecmp_fold(b[index])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+__attribute__((__target__("sse4.2")))
+static inline __m128i hashtable_casecmp_lowercase_sse42(
+        __m128i block) {
+    __m128i letters_uppercase_lower_mask = _mm_cmpgt_epi8(block, _mm_set1_epi8(0x40));
+    __m128i letters_uppercase_upper_mask = _mm_cmpgt_epi8(block, _mm_set1_epi8(0x5a));
+    __m128i letters_uppercase_mask = _mm_andnot_si128(letters_uppercase_upper_mask, letters_uppercase_lower_mask);
+
+    return _mm_or_si128(block, _mm_and_si128(letters_uppercase_mask, _mm_set1_epi8(0x20)));
+}
+
+__attribute__((__target__("sse4.2")))
+int hashtable_casecmp_eq_str_sse42_32(
+        const char a[32],
+        size_t a_len,
+        const char b[32],
+        size_t b_len) {
+    assert(a_len <= 32);
+    assert(b_len <= 32);
+
+    if (a_len != b_len) {
+        return false;
+    }
+
+    uint32_t eq_masq = 0;
+
+    // Same algorithm of the avx2 version, split in two halves of 16 bytes
+    for(uint8_t base_index = 0; base_index < 32; base_index += 16) {
+        __m128i a_lowercase = hashtable_casecmp_lowercase_sse42(_mm_loadu_si128((__m128i*)(a + base_index)));
+        __m128i b_lowercase = hashtable_casecmp_lowercase_sse42(_mm_loadu_si128((__m128i*)(b + base_index)));
+
+        eq_masq |= (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(a_lowercase, b_lowercase)) << base_index;
+    }
+
+    return (eq_masq & len_mask_table[a_len]) == len_mask_table[a_len];
+}
+
+__attribute__((__target__("avx2")))
+int hashtable_casecmp_eq_str_avx2_32(
+        const char a[32],
+        size_t a_len,
+        const char b[32],
+        size_t b_len) {
+    static uint8_t letter_uppercase_range_lower[32] = {
+            0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40,
+            0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40 };
+    static uint8_t letter_uppercase_range_upper[32] = {
+            0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a,
+            0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a };
+    static uint8_t letter_lowercase_bit[32] = {
+            0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+            0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20 };
+
+    assert(a_len <= 32);
+    assert(b_len <= 32);
+
+    if (a_len != b_len) {
+        return false;
+    }
+
+    uint32_t eq_masq;
+
+    // Load the strings
+    __m256i a_block = _mm256_castpd_si256(_mm256_loadu_pd((double*)a));
+    __m256i b_block = _mm256_castpd_si256(_mm256_loadu_pd((double*)b));
+    __m256i letter_uppercase_range_lower_block = _mm256_castpd_si256(_mm256_loadu_pd((double*)&letter_uppercase_range_lower));
+    __m256i letter_uppercase_range_upper_block = _mm256_castpd_si256(_mm256_loadu_pd((double*)&letter_uppercase_range_upper));
+    __m256i letter_lowercase_bit_block = _mm256_castpd_si256(_mm256_loadu_pd((double*)&letter_lowercase_bit));
+
+    // First identifies the upper case letters, because AVX2 doesn't provide a _mm256_cmplt_epi8 the _mm256_cmpgt_epi8
+    // is being used in combination with _mm256_andnot_si256 to build 2 masks to identify which bytes are over A and
+    // which ones are over Z and then convert the false of the second mask to true and identify the upper case letters.
+    // Once the letters are identified, a bitmask for the lowercase bit is built for the single bytes and then the
+    // bitmask of the bytes in the mask is applied to the initial string to covert it to lower case.
+    // This process is repeated twice for the two strings.
+    __m256i a_letters_uppercase_lower_mask = _mm256_cmpgt_epi8(a_block, letter_uppercase_range_lower_block);
+    __m256i a_letters_uppercase_upper_mask = _mm256_cmpgt_epi8(a_block, letter_uppercase_range_upper_block);
+    __m256i a_letters_uppercase_mask = _mm256_andnot_si256(a_letters_uppercase_upper_mask, a_letters_uppercase_lower_mask);
+    __m256i a_letters_lowercase_bit_mask = _mm256_and_si256(a_letters_uppercase_mask, letter_lowercase_bit_block);
+    __m256i a_lowercase = _mm256_or_si256(a_block, a_letters_lowercase_bit_mask);
+
+    __m256i b_letters_uppercase_lower_mask = _mm256_cmpgt_epi8(b_block, letter_uppercase_range_lower_block);
+    __m256i b_letters_uppercase_upper_mask = _mm256_cmpgt_epi8(b_block, letter_uppercase_range_upper_block);
+    __m256i b_letters_uppercase_mask = _mm256_andnot_si256(b_letters_uppercase_upper_mask, b_letters_uppercase_lower_mask);
+    __m256i b_letters_lowercase_bit_mask = _mm256_and_si256(b_letters_uppercase_mask, letter_lowercase_bit_block);
+    __m256i b_lowercase = _mm256_or_si256(b_block, b_letters_lowercase_bit_mask);
+
+    // This part of code matches the implementation of cmp_eq_32 but it's repeated as the code sharing wouldn't really
+    // improve the readability.
+    __m256i result_mask_vector = _mm256_cmpeq_epi8(a_lowercase, b_lowercase);
+    eq_masq = (uint32_t)_mm256_movemask_epi8(result_mask_vector);
+
+    return (eq_masq & len_mask_table[a_len]) == len_mask_table[a_len];
+}
+
+__attribute__((__target__("avx512bw,avx512vl")))
+int hashtable_casecmp_eq_str_avx512bw_32(
+        const char a[32],
+        size_t a_len,
+        const char b[32],
+        size_t b_len) {
+    assert(a_len <= 32);
+    assert(b_len <= 32);
+
+    if (a_len != b_len) {
+        return false;
+    }
+
+    // The length mask is used as load mask, the bytes past the end of the strings are never read, and the upper case
+    // letters are identified with the unsigned range compares directly into mask registers
+    __mmask32 len_mask = (__mmask32)len_mask_table[a_len];
+    __m256i a_block = _mm256_maskz_loadu_epi8(len_mask, a);
+    __m256i b_block = _mm256_maskz_loadu_epi8(len_mask, b);
+    __m256i letter_lowercase_bit_block = _mm256_set1_epi8(0x20);
+
+    __mmask32 a_letters_uppercase_mask = _mm256_cmple_epu8_mask(
+            _mm256_sub_epi8(a_block, _mm256_set1_epi8('A')), _mm256_set1_epi8('Z' - 'A'));
+    __mmask32 b_letters_uppercase_mask = _mm256_cmple_epu8_mask(
+            _mm256_sub_epi8(b_block, _mm256_set1_epi8('A')), _mm256_set1_epi8('Z' - 'A'));
+
+    // The lowercase bit is never set in the upper case letters, adding it is the same as or-ing it
+    __m256i a_lowercase = _mm256_mask_add_epi8(a_block, a_letters_uppercase_mask, a_block, letter_lowercase_bit_block);
+    __m256i b_lowercase = _mm256_mask_add_epi8(b_block, b_letters_uppercase_mask, b_block, letter_lowercase_bit_block);
+
+    return _mm256_cmpneq_epi8_mask(a_lowercase, b_lowercase) == 0;
+}
+
+static hashtable_casecmp_eq_str_32_fp_t* hashtable_casecmp_eq_str_32_select(
+        const char** isa) {
+    // The resolver can run before the constructors, the cpu features have to be initialized explicitly
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl")) {
+        *isa = "avx512bw";
+        return hashtable_casecmp_eq_str_avx512bw_32;
+    } else if (__builtin_cpu_supports("avx2")) {
+        *isa = "avx2";
+        return hashtable_casecmp_eq_str_avx2_32;
+    } else if (__builtin_cpu_supports("sse4.2")) {
+        *isa = "sse4.2";
+        return hashtable_casecmp_eq_str_sse42_32;
+    }
+
+    *isa = "scalar";
+    return hashtable_casecmp_eq_str_scalar_32;
+}
+
+static hashtable_casecmp_eq_str_32_fp_t* hashtable_casecmp_eq_str_32_resolve(void) {
+    const char* isa;
+    return hashtable_casecmp_eq_str_32_select(&isa);
+}
+
+int hashtable_casecmp_eq_str_32(
+        const char a[32],
+        size_t a_len,
+        const char b[32],
+        size_t b_len) __attribute__((ifunc("hashtable_casecmp_eq_str_32_resolve")));
+
+const char* hashtable_casecmp_eq_str_32_isa(void) {
+    const char* isa;
+    hashtable_casecmp_eq_str_32_select(&isa);
+
+    return isa;
+}
+
+// A full load of block_size bytes starting from ptr can't fault if it doesn't cross a page boundary, the page of ptr
+// is mapped
+static inline bool hashtable_cmp_block_crosses_page(
+        const char* ptr,
+        size_t block_size) {
+    uintptr_t page_offset = (uintptr_t)ptr & (HASHTABLE_SUPPORT_STRING_CMP_PAGE_SIZE - 1);
+
+    return page_offset > HASHTABLE_SUPPORT_STRING_CMP_PAGE_SIZE - block_size;
+}
+
+static inline bool hashtable_cmp_same_page(
+        const char* ptr1,
+        const char* ptr2) {
+    return ((uintptr_t)ptr1 & ~(uintptr_t)(HASHTABLE_SUPPORT_STRING_CMP_PAGE_SIZE - 1)) ==
+           ((uintptr_t)ptr2 & ~(uintptr_t)(HASHTABLE_SUPPORT_STRING_CMP_PAGE_SIZE - 1));
+}
+
+// Picks from where the blocks holding the last tail_len bytes of the strings are loaded, the tails start at index.
+// If neither block crosses a page boundary they are loaded from the tails, otherwise the blocks ending with the tails
+// are loaded if they start in already compared bytes or in the same page of the tails. As last resort the tails are
+// copied in the buffers. Returns the position of the first byte of the tails in the blocks.
+static inline size_t hashtable_cmp_tail_blocks(
+        const char* a,
+        const char* b,
+        size_t index,
+        size_t tail_len,
+        size_t block_size,
+        char* a_buffer,
+        char* b_buffer,
+        const char** a_block,
+        const char** b_block) {
+    const char* a_tail = a + index;
+    const char* b_tail = b + index;
+
+    if (!hashtable_cmp_block_crosses_page(a_tail, block_size) &&
+            !hashtable_cmp_block_crosses_page(b_tail, block_size)) {
+        *a_block = a_tail;
+        *b_block = b_tail;
+        return 0;
+    }
+
+    size_t offset = block_size - tail_len;
+    if (index >= offset ||
+            (hashtable_cmp_same_page(a_tail - offset, a_tail) && hashtable_cmp_same_page(b_tail - offset, b_tail))) {
+        *a_block = a_tail - offset;
+        *b_block = b_tail - offset;
+        return offset;
+    }
+
+    memcpy(a_buffer, a_tail, tail_len);
+    memcpy(b_buffer, b_tail, tail_len);
+    *a_block = a_buffer;
+    *b_block = b_buffer;
+
+    return 0;
+}
+
+static inline int hashtable_cmp_eq_bytes_scalar(
+        const char* a,
+        const char* b,
+        size_t len,
+        bool fold) {
+    for(size_t index = 0; index < len; index++) {
+        char a_char = fold ? hashtable_casecmp_fold(a[index]) : a[index];
+        char b_char = fold ? hashtable_casecmp_fold(b[index]) : b[index];
+
+        if (a_char != b_char) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+__attribute__((__target__("sse4.2")))
+static inline int hashtable_cmp_eq_bytes_sse42(
+        const char* a,
+        const char* b,
+        size_t len,
+        bool fold) {
+    size_t index = 0;
+
+    for(; index + 16 <= len; index += 16) {
+        __m128i a_block = _mm_loadu_si128((__m128i*)(a + index));
+        __m128i b_block = _mm_loadu_si128((__m128i*)(b + index));
+
+        if (fold) {
+            a_block = hashtable_casecmp_lowercase_sse42(a_block);
+            b_block = hashtable_casecmp_lowercase_sse42(b_block);
+        }
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(a_block, b_block)) != 0xFFFF) {
+            return false;
+        }
+    }
+
+    size_t tail_len = len - index;
+    if (tail_len == 0) {
+        return true;
+    }
+
+    char a_tail_buffer[16], b_tail_buffer[16];
+    const char *a_tail_block, *b_tail_block;
+    size_t tail_offset = hashtable_cmp_tail_blocks(
+            a, b, index, tail_len, 16, a_tail_buffer, b_tail_buffer, &a_tail_block, &b_tail_block);
+
+    __m128i a_block = _mm_loadu_si128((__m128i*)a_tail_block);
+    __m128i b_block = _mm_loadu_si128((__m128i*)b_tail_block);
+
+    if (fold) {
+        a_block = hashtable_casecmp_lowercase_sse42(a_block);
+        b_block = hashtable_casecmp_lowercase_sse42(b_block);
+    }
+
+    uint32_t eq_mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(a_block, b_block)) >> tail_offset;
+
+    return (eq_mask & len_mask_table[tail_len]) == len_mask_table[tail_len];
+}
+
+__attribute__((__target__("avx2")))
+static inline __m256i hashtable_casecmp_lowercase_avx2(
+        __m256i block) {
+    __m256i letters_uppercase_lower_mask = _mm256_cmpgt_epi8(block, _mm256_set1_epi8(0x40));
+    __m256i letters_uppercase_upper_mask = _mm256_cmpgt_epi8(block, _mm256_set1_epi8(0x5a));
+    __m256i letters_uppercase_mask = _mm256_andnot_si256(letters_uppercase_upper_mask, letters_uppercase_lower_mask);
+
+    return _mm256_or_si256(block, _mm256_and_si256(letters_uppercase_mask, _mm256_set1_epi8(0x20)));
+}
+
+__attribute__((__target__("avx2")))
+static inline __m256i hashtable_cmp_eq_block_avx2(
+        const char* a,
+        const char* b,
+        bool fold) {
+    __m256i a_block = _mm256_loadu_si256((__m256i*)a);
+    __m256i b_block = _mm256_loadu_si256((__m256i*)b);
+
+    if (fold) {
+        a_block = hashtable_casecmp_lowercase_avx2(a_block);
+        b_block = hashtable_casecmp_lowercase_avx2(b_block);
+    }
+
+    return _mm256_cmpeq_epi8(a_block, b_block);
+}
+
+__attribute__((__target__("avx2")))
+static inline int hashtable_cmp_eq_bytes_avx2(
+        const char* a,
+        const char* b,
+        size_t len,
+        bool fold) {
+    size_t index = 0;
+
+    // 64 bytes per iteration, the results of the two blocks are merged and checked with a single branch
+    for(; index + 64 <= len; index += 64) {
+        __m256i eq_block = _mm256_and_si256(
+                hashtable_cmp_eq_block_avx2(a + index, b + index, fold),
+                hashtable_cmp_eq_block_avx2(a + index + 32, b + index + 32, fold));
+
+        if ((uint32_t)_mm256_movemask_epi8(eq_block) != UINT32_MAX) {
+            return false;
+        }
+    }
+
+    if (index + 32 <= len) {
+        if ((uint32_t)_mm256_movemask_epi8(hashtable_cmp_eq_block_avx2(a + index, b + index, fold)) != UINT32_MAX) {
+            return false;
+        }
+
+        index += 32;
+    }
+
+    size_t tail_len = len - index;
+    if (tail_len == 0) {
+        return true;
+    }
+
+    char a_tail_buffer[32], b_tail_buffer[32];
+    const char *a_tail_block, *b_tail_block;
+    size_t tail_offset = hashtable_cmp_tail_blocks(
+            a, b, index, tail_len, 32, a_tail_buffer, b_tail_buffer, &a_tail_block, &b_tail_block);
+
+    uint32_t eq_mask = (uint32_t)_mm256_movemask_epi8(
+            hashtable_cmp_eq_block_avx2(a_tail_block, b_tail_block, fold)) >> tail_offset;
+
+    return (eq_mask & len_mask_table[tail_len]) == len_mask_table[tail_len];
+}
+
+__attribute__((__target__("avx512bw")))
+static inline __m512i hashtable_casecmp_lowercase_avx512bw(
+        __m512i block) {
+    __mmask64 letters_uppercase_mask = _mm512_cmple_epu8_mask(
+            _mm512_sub_epi8(block, _mm512_set1_epi8('A')), _mm512_set1_epi8('Z' - 'A'));
+
+    return _mm512_mask_add_epi8(block, letters_uppercase_mask, block, _mm512_set1_epi8(0x20));
+}
+
+__attribute__((__target__("avx512bw")))
+static inline int hashtable_cmp_eq_bytes_avx512bw(
+        const char* a,
+        const char* b,
+        size_t len,
+        bool fold) {
+    size_t index = 0;
+
+    for(; index + 64 <= len; index += 64) {
+        __m512i a_block = _mm512_loadu_si512(a + index);
+        __m512i b_block = _mm512_loadu_si512(b + index);
+
+        if (fold) {
+            a_block = hashtable_casecmp_lowercase_avx512bw(a_block);
+            b_block = hashtable_casecmp_lowercase_avx512bw(b_block);
+        }
+
+        if (_mm512_cmpneq_epi8_mask(a_block, b_block) != 0) {
+            return false;
+        }
+    }
+
+    size_t tail_len = len - index;
+    if (tail_len == 0) {
+        return true;
+    }
+
+    // A masked load would be enough to not fault but when the bytes excluded by the mask fall in an unmapped page the
+    // fault suppression goes through a microcode assist costing hundreds of cycles, the tail is handled as in the avx2
+    // version and the mask is applied only to the compare
+    char a_tail_buffer[64], b_tail_buffer[64];
+    const char *a_tail_block, *b_tail_block;
+    size_t tail_offset = hashtable_cmp_tail_blocks(
+            a, b, index, tail_len, 64, a_tail_buffer, b_tail_buffer, &a_tail_block, &b_tail_block);
+
+    __mmask64 tail_mask = (__mmask64)((1ull << tail_len) - 1) << tail_offset;
+    __m512i a_block = _mm512_loadu_si512(a_tail_block);
+    __m512i b_block = _mm512_loadu_si512(b_tail_block);
+
+    if (fold) {
+        a_block = hashtable_casecmp_lowercase_avx512bw(a_block);
+        b_block = hashtable_casecmp_lowercase_avx512bw(b_block);
+    }
+
+    return _mm512_mask_cmpneq_epi8_mask(tail_mask, a_block, b_block) == 0;
+}
+
+int hashtable_casecmp_eq_str_scalar(
+        const char* a,
+        size_t a_len,
+        const char* b,
+        size_t b_len) {
+    return a_len == b_len && hashtable_cmp_eq_bytes_scalar(a, b, a_len, true);
+}
+
+__attribute__((__target__("sse4.2")))
+int hashtable_casecmp_eq_str_sse42(
+        const char* a,
+        size_t a_len,
+        const char* b,
+        size_t b_len) {
+    return a_len == b_len && hashtable_cmp_eq_bytes_sse42(a, b, a_len, true);
+}
+
+__attribute__((__target__("avx2")))
+int hashtable_casecmp_eq_str_avx2(
+        const char* a,
+        size_t a_len,
+        const char* b,
+        size_t b_len) {
+    return a_len == b_len && hashtable_cmp_eq_bytes_avx2(a, b, a_len, true);
+}
+
+__attribute__((__target__("avx512bw")))
+int hashtable_casecmp_eq_str_avx512bw(
+        const char* a,
+        size_t a_len,
+        const char* b,
+        size_t b_len) {
+    return a_len == b_len && hashtable_cmp_eq_bytes_avx512bw(a, b, a_len, true);
+}
+
+int hashtable_cmp_eq_str_scalar(
+        const char* a,
+        size_t a_len,
+        const char* b,
+        size_t b_len) {
+    return a_len == b_len && hashtable_cmp_eq_bytes_scalar(a, b, a_len, false);
+}
+
+__attribute__((__target__("sse4.2")))
+int hashtable_cmp_eq_str_sse42(
+        const char* a,
+        size_t a_len,
+        const char* b,
+        size_t b_len) {
+    return a_len == b_len && hashtable_cmp_eq_bytes_sse42(a, b, a_len, false);
+}
+
+__attribute__((__target__("avx2")))
+int hashtable_cmp_eq_str_avx2(
+        const char* a,
+        size_t a_len,
+        const char* b,
+        size_t b_len) {
+    return a_len == b_len && hashtable_cmp_eq_bytes_avx2(a, b, a_len, false);
+}
+
+__attribute__((__target__("avx512bw")))
+int hashtable_cmp_eq_str_avx512bw(
+        const char* a,
+        size_t a_len,
+        const char* b,
+        size_t b_len) {
+    return a_len == b_len && hashtable_cmp_eq_bytes_avx512bw(a, b, a_len, false);
+}
+
+static hashtable_cmp_eq_str_fp_t* hashtable_casecmp_eq_str_select(
+        const char** isa) {
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512bw")) {
+        *isa = "avx512bw";
+        return hashtable_casecmp_eq_str_avx512bw;
+    } else if (__builtin_cpu_supports("avx2")) {
+        *isa = "avx2";
+        return hashtable_casecmp_eq_str_avx2;
+    } else if (__builtin_cpu_supports("sse4.2")) {
+        *isa = "sse4.2";
+        return hashtable_casecmp_eq_str_sse42;
+    }
+
+    *isa = "scalar";
+    return hashtable_casecmp_eq_str_scalar;
+}
+
+static hashtable_cmp_eq_str_fp_t* hashtable_casecmp_eq_str_resolve(void) {
+    const char* isa;
+    return hashtable_casecmp_eq_str_select(&isa);
+}
+
+int hashtable_casecmp_eq_str(
+        const char* a,
+        size_t a_len,
+        const char* b,
+        size_t b_len) __attribute__((ifunc("hashtable_casecmp_eq_str_resolve")));
+
+const char* hashtable_casecmp_eq_str_isa(void) {
+    const char* isa;
+    hashtable_casecmp_eq_str_select(&isa);
+
+    return isa;
+}
+
+static hashtable_cmp_eq_str_fp_t* hashtable_cmp_eq_str_select(
+        const char** isa) {
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512bw")) {
+        *isa = "avx512bw";
+        return hashtable_cmp_eq_str_avx512bw;
+    } else if (__builtin_cpu_supports("avx2")) {
+        *isa = "avx2";
+        return hashtable_cmp_eq_str_avx2;
+    } else if (__builtin_cpu_supports("sse4.2")) {
+        *isa = "sse4.2";
+        return hashtable_cmp_eq_str_sse42;
+    }
+
+    *isa = "scalar";
+    return hashtable_cmp_eq_str_scalar;
+}
+
+static hashtable_cmp_eq_str_fp_t* hashtable_cmp_eq_str_resolve(void) {
+    const char* isa;
+    return hashtable_cmp_eq_str_select(&isa);
+}
+
+int hashtable_cmp_eq_str(
+        const char* a,
+        size_t a_len,
+        const char* b,
+        size_t b_len) __attribute__((ifunc("hashtable_cmp_eq_str_resolve")));
+
+const char* hashtable_cmp_eq_str_isa(void) {
+    const char* isa;
+    hashtable_cmp_eq_str_select(&isa);
+
+    return isa;
+}
+
+uint32_t hashtable_casecmp_eq_str_32_many_scalar(
+        const char needle[32],
+        size_t needle_len,
+        const char candidates[][32],
+        const uint8_t candidates_len[HASHTABLE_CASECMP_EQ_STR_32_MANY_CANDIDATES],
+        uint32_t candidates_mask) {
+    uint32_t matches_mask = 0;
+
+    for(uint32_t index = 0; index < HASHTABLE_CASECMP_EQ_STR_32_MANY_CANDIDATES; index++) {
+        if ((candidates_mask & (1u << index)) &&
+                hashtable_casecmp_eq_str_scalar_32(candidates[index], candidates_len[index], needle, needle_len)) {
+            matches_mask |= 1u << index;
+        }
+    }
+
+    return matches_mask;
+}
+
+// The lengths of the 16 candidates are compared at once, the candidates with a different length are never loaded
+__attribute__((__target__("sse4.2")))
+static inline uint32_t hashtable_casecmp_eq_str_32_many_len_mask(
+        size_t needle_len,
+        const uint8_t candidates_len[HASHTABLE_CASECMP_EQ_STR_32_MANY_CANDIDATES]) {
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(
+            _mm_loadu_si128((__m128i*)candidates_len),
+            _mm_set1_epi8((char)needle_len)));
+}
+
+__attribute__((__target__("sse4.2")))
+uint32_t hashtable_casecmp_eq_str_32_many_sse42(
+        const char needle[32],
+        size_t needle_len,
+        const char candidates[][32],
+        const uint8_t candidates_len[HASHTABLE_CASECMP_EQ_STR_32_MANY_CANDIDATES],
+        uint32_t candidates_mask) {
+    assert(needle_len <= 32);
+
+    uint32_t matches_mask = 0;
+    uint32_t len_mask = len_mask_table[needle_len];
+    __m128i needle_low = hashtable_casecmp_lowercase_sse42(_mm_loadu_si128((__m128i*)needle));
+    __m128i needle_high = hashtable_casecmp_lowercase_sse42(_mm_loadu_si128((__m128i*)(needle + 16)));
+
+    candidates_mask &= hashtable_casecmp_eq_str_32_many_len_mask(needle_len, candidates_len);
+
+    while (candidates_mask) {
+        uint32_t index = __builtin_ctz(candidates_mask);
+        candidates_mask &= candidates_mask - 1;
+
+        __m128i candidate_low = hashtable_casecmp_lowercase_sse42(_mm_loadu_si128((__m128i*)candidates[index]));
+        __m128i candidate_high = hashtable_casecmp_lowercase_sse42(_mm_loadu_si128((__m128i*)(candidates[index] + 16)));
+        uint32_t eq_mask =
+                (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(candidate_low, needle_low)) |
+                ((uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(candidate_high, needle_high)) << 16);
+
+        matches_mask |= (uint32_t)((eq_mask & len_mask) == len_mask) << index;
+    }
+
+    return matches_mask;
+}
+
+__attribute__((__target__("avx2")))
+uint32_t hashtable_casecmp_eq_str_32_many_avx2(
+        const char needle[32],
+        size_t needle_len,
+        const char candidates[][32],
+        const uint8_t candidates_len[HASHTABLE_CASECMP_EQ_STR_32_MANY_CANDIDATES],
+        uint32_t candidates_mask) {
+    assert(needle_len <= 32);
+
+    uint32_t matches_mask = 0;
+    uint32_t len_mask = len_mask_table[needle_len];
+    __m256i needle_block = hashtable_casecmp_lowercase_avx2(_mm256_loadu_si256((__m256i*)needle));
+
+    candidates_mask &= hashtable_casecmp_eq_str_32_many_len_mask(needle_len, candidates_len);
+
+    // The candidates are independent, without a branch on the result of each compare the loads and the compares of
+    // the different candidates overlap
+    while (candidates_mask) {
+        uint32_t index = __builtin_ctz(candidates_mask);
+        candidates_mask &= candidates_mask - 1;
+
+        __m256i candidate_block = hashtable_casecmp_lowercase_avx2(_mm256_loadu_si256((__m256i*)candidates[index]));
+        uint32_t eq_mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(candidate_block, needle_block));
+
+        matches_mask |= (uint32_t)((eq_mask & len_mask) == len_mask) << index;
+    }
+
+    return matches_mask;
+}
+
+__attribute__((__target__("avx512bw")))
+uint32_t hashtable_casecmp_eq_str_32_many_avx512bw(
+        const char needle[32],
+        size_t needle_len,
+        const char candidates[][32],
+        const uint8_t candidates_len[HASHTABLE_CASECMP_EQ_STR_32_MANY_CANDIDATES],
+        uint32_t candidates_mask) {
+    assert(needle_len <= 32);
+
+    uint32_t matches_mask = 0;
+    uint64_t len_mask = (uint64_t)len_mask_table[needle_len] | ((uint64_t)len_mask_table[needle_len] << 32);
+    __m512i needle_block = hashtable_casecmp_lowercase_avx512bw(
+            _mm512_broadcast_i64x4(_mm256_loadu_si256((__m256i*)needle)));
+
+    candidates_mask &= hashtable_casecmp_eq_str_32_many_len_mask(needle_len, candidates_len);
+
+    // Two candidates per block, the needle is broadcasted in both the halves
+    uint32_t pairs_mask = (candidates_mask | (candidates_mask >> 1)) & 0x5555u;
+    while (pairs_mask) {
+        uint32_t index = __builtin_ctz(pairs_mask);
+        pairs_mask &= pairs_mask - 1;
+
+        __m512i candidates_block = hashtable_casecmp_lowercase_avx512bw(_mm512_loadu_si512(candidates[index]));
+        uint64_t neq_mask = _mm512_cmpneq_epi8_mask(candidates_block, needle_block) & len_mask;
+
+        matches_mask |= (uint32_t)((uint32_t)neq_mask == 0) << index;
+        matches_mask |= (uint32_t)((uint32_t)(neq_mask >> 32) == 0) << (index + 1);
+    }
+
+    return matches_mask & candidates_mask;
+}
+
+static hashtable_casecmp_eq_str_32_many_fp_t* hashtable_casecmp_eq_str_32_many_select(
+        const char** isa) {
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512bw")) {
+        *isa = "avx512bw";
+        return hashtable_casecmp_eq_str_32_many_avx512bw;
+    } else if (__builtin_cpu_supports("avx2")) {
+        *isa = "avx2";
+        return hashtable_casecmp_eq_str_32_many_avx2;
+    } else if (__builtin_cpu_supports("sse4.2")) {
+        *isa = "sse4.2";
+        return hashtable_casecmp_eq_str_32_many_sse42;
+    }
+
+    *isa = "scalar";
+    return hashtable_casecmp_eq_str_32_many_scalar;
+}
+
+static hashtable_casecmp_eq_str_32_many_fp_t* hashtable_casecmp_eq_str_32_many_resolve(void) {
+    const char* isa;
+    return hashtable_casecmp_eq_str_32_many_select(&isa);
+}
+
+uint32_t hashtable_casecmp_eq_str_32_many(
+        const char needle[32],
+        size_t needle_len,
+        const char candidates[][32],
+        const uint8_t candidates_len[HASHTABLE_CASECMP_EQ_STR_32_MANY_CANDIDATES],
+        uint32_t candidates_mask) __attribute__((ifunc("hashtable_casecmp_eq_str_32_many_resolve")));
+
+const char* hashtable_casecmp_eq_str_32_many_isa(void) {
+    const char* isa;
+    hashtable_casecmp_eq_str_32_many_select(&isa);
+
+    return isa;
+}
@@ -0,0 +1,188 @@
+#ifndef HASHTABLE_SUPPORT_STRING_CMP_H
+#define HASHTABLE_SUPPORT_STRING_CMP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Case insensitive comparison of two strings of up to 32 bytes, only the ASCII letters are folded. Returns true if the
+// lengths and the contents match. The SIMD variants always load 32 bytes from both a and b, the buffers have to be
+// readable for 32 bytes regardless of the length of the strings.
+typedef int (hashtable_casecmp_eq_str_32_fp_t)(
+        const char a[32],
+        size_t a_len,
+        const char b[32],
+        size_t b_len);
+
+// The variant matching the best instruction set available on the cpu is picked once, when the binary is loaded, via
+// ifunc
+int hashtable_casecmp_eq_str_32(
+        const char a[32],
+        size_t a_len,
+        const char b[32],
+        size_t b_len);
+
+// Name of the instruction set of the variant picked by hashtable_casecmp_eq_str_32 (scalar, sse4.2, avx2 or avx512bw)
+const char* hashtable_casecmp_eq_str_32_isa(void);
+
+// The variants below can be called directly but only if the cpu supports the related instruction set
+int hashtable_casecmp_eq_str_scalar_32(
+        const char a[32],
+        size_t a_len,
+        const char b[32],
+        size_t b_len);
+
+int hashtable_casecmp_eq_str_sse42_32(
+        const char a[32],
+        size_t a_len,
+        const char b[32],
+        size_t b_len);
+
+int hashtable_casecmp_eq_str_avx2_32(
+        const char a[32],
+        size_t a_len,
+        const char b[32],
+        size_t b_len);
+
+int hashtable_casecmp_eq_str_avx512bw_32(
+        const char a[32],
+        size_t a_len,
+        const char b[32],
+        size_t b_len);
+
+// Compares the needle against the candidates selected by candidates_mask in a single pass, instead of one candidate
+// at a time, and returns the bitmask of the candidates matching it. The candidates are keys of up to 32 bytes stored
+// in slots of 32 bytes, candidates_len holds the lengths of all the HASHTABLE_CASECMP_EQ_STR_32_MANY_CANDIDATES slots,
+// the candidates with a different length are excluded up front. As for hashtable_casecmp_eq_str_32 the needle has to
+// be readable for 32 bytes.
+#define HASHTABLE_CASECMP_EQ_STR_32_MANY_CANDIDATES 16
+
+typedef uint32_t (hashtable_casecmp_eq_str_32_many_fp_t)(
+        const char needle[32],
+        size_t needle_len,
+        const char candidates[][32],
+        const uint8_t candidates_len[HASHTABLE_CASECMP_EQ_STR_32_MANY_CANDIDATES],
+        uint32_t candidates_mask);
+
+// The variant is picked via ifunc when the binary is loaded
+uint32_t hashtable_casecmp_eq_str_32_many(
+        const char needle[32],
+        size_t needle_len,
+        const char candidates[][32],
+        const uint8_t candidates_len[HASHTABLE_CASECMP_EQ_STR_32_MANY_CANDIDATES],
+        uint32_t candidates_mask);
+
+const char* hashtable_casecmp_eq_str_32_many_isa(void);
+
+uint32_t hashtable_casecmp_eq_str_32_many_scalar(
+        const char needle[32],
+        size_t needle_len,
+        const char candidates[][32],
+        const uint8_t candidates_len[HASHTABLE_CASECMP_EQ_STR_32_MANY_CANDIDATES],
+        uint32_t candidates_mask);
+
+uint32_t hashtable_casecmp_eq_str_32_many_sse42(
+        const char needle[32],
+        size_t needle_len,
+        const char candidates[][32],
+        const uint8_t candidates_len[HASHTABLE_CASECMP_EQ_STR_32_MANY_CANDIDATES],
+        uint32_t candidates_mask);
+
+uint32_t hashtable_casecmp_eq_str_32_many_avx2(
+        const char needle[32],
+        size_t needle_len,
+        const char candidates[][32],
+        const uint8_t candidates_len[HASHTABLE_CASECMP_EQ_STR_32_MANY_CANDIDATES],
+        uint32_t candidates_mask);
+
+uint32_t hashtable_casecmp_eq_str_32_many_avx512bw(
+        const char needle[32],
+        size_t needle_len,
+        const char candidates[][32],
+        const uint8_t candidates_len[HASHTABLE_CASECMP_EQ_STR_32_MANY_CANDIDATES],
+        uint32_t candidates_mask);
+
+// Case insensitive and case sensitive comparisons of two strings of any length, only the ASCII letters are folded by
+// the case insensitive ones. Return true if the lengths and the contents match.
+// Unlike the 32 bytes variants above the buffers don't need any padding: the SIMD variants compare blocks of 16, 32 or
+// 64 bytes, returning at the first block with a mismatch, and the last partial block is loaded only from pages the
+// strings are known to be in, shifting it back to end with the strings if it would cross a page boundary.
+typedef int (hashtable_cmp_eq_str_fp_t)(
+        const char* a,
+        size_t a_len,
+        const char* b,
+        size_t b_len);
+
+// As hashtable_casecmp_eq_str_32, the variant is picked via ifunc when the binary is loaded
+int hashtable_casecmp_eq_str(
+        const char* a,
+        size_t a_len,
+        const char* b,
+        size_t b_len);
+
+const char* hashtable_casecmp_eq_str_isa(void);
+
+int hashtable_cmp_eq_str(
+        const char* a,
+        size_t a_len,
+        const char* b,
+        size_t b_len);
+
+const char* hashtable_cmp_eq_str_isa(void);
+
+int hashtable_casecmp_eq_str_scalar(
+        const char* a,
+        size_t a_len,
+        const char* b,
+        size_t b_len);
+
+int hashtable_casecmp_eq_str_sse42(
+        const char* a,
+        size_t a_len,
+        const char* b,
+        size_t b_len);
+
+int hashtable_casecmp_eq_str_avx2(
+        const char* a,
+        size_t a_len,
+        const char* b,
+        size_t b_len);
+
+int hashtable_casecmp_eq_str_avx512bw(
+        const char* a,
+        size_t a_len,
+        const char* b,
+        size_t b_len);
+
+int hashtable_cmp_eq_str_scalar(
+        const char* a,
+        size_t a_len,
+        const char* b,
+        size_t b_len);
+
+int hashtable_cmp_eq_str_sse42(
+        const char* a,
+        size_t a_len,
+        const char* b,
+        size_t b_len);
+
+int hashtable_cmp_eq_str_avx2(
+        const char* a,
+        size_t a_len,
+        const char* b,
+        size_t b_len);
+
+int hashtable_cmp_eq_str_avx512bw(
+        const char* a,
+        size_t a_len,
+        const char* b,
+        size_t b_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //HASHTABLE_SUPPORT_STRING_CMP_H
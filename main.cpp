@@ -6,6 +6,13 @@
 
 #include <benchmark/benchmark.h>
 
+#include "libhashtable/hashtable_support_hash.h"
+#include "libhashtable/hashtable_support_hash_search.h"
+#include "libhashtable/hashtable_support_string_cmp.h"
+
+#include "bench-support-perf.h"
+#include "bench-support-histogram.h"
+
 std::string GetCpuName() {
     std::string line, modelName;
 
@@ -94,7 +101,64 @@ std::int32_t GetNumaNodeCount() {
 };
 
 
+// Removes --perf_counters from the arguments, google benchmark would report it as unrecognized
+bool ParsePerfCountersFlag(int* argc, char** argv) {
+    bool enabled = false;
+    int argc_new = 1;
+
+    for (int index = 1; index < *argc; index++) {
+        std::string arg(argv[index]);
+
+        if (arg == "--perf_counters" || arg == "--perf_counters=true" || arg == "--perf_counters=1") {
+            enabled = true;
+            continue;
+        } else if (arg == "--perf_counters=false" || arg == "--perf_counters=0") {
+            enabled = false;
+            continue;
+        }
+
+        argv[argc_new++] = argv[index];
+    }
+
+    *argc = argc_new;
+
+    return enabled;
+}
+
+// Removes --latency_histograms and --latency_histograms_dump=<path> from the arguments, the dump implies the histograms
+bool ParseLatencyHistogramsFlags(int* argc, char** argv, std::string* dump_path) {
+    bool enabled = false;
+    int argc_new = 1;
+    std::string dump_prefix("--latency_histograms_dump=");
+
+    for (int index = 1; index < *argc; index++) {
+        std::string arg(argv[index]);
+
+        if (arg == "--latency_histograms" || arg == "--latency_histograms=true" || arg == "--latency_histograms=1") {
+            enabled = true;
+            continue;
+        } else if (arg == "--latency_histograms=false" || arg == "--latency_histograms=0") {
+            enabled = false;
+            continue;
+        } else if (arg.starts_with(dump_prefix)) {
+            *dump_path = arg.substr(dump_prefix.length());
+            enabled = !dump_path->empty() || enabled;
+            continue;
+        }
+
+        argv[argc_new++] = argv[index];
+    }
+
+    *argc = argc_new;
+
+    return enabled;
+}
+
 int main(int argc, char** argv) {
+    std::string latency_histograms_dump_path;
+    bool perf_counters = ParsePerfCountersFlag(&argc, argv);
+    bool latency_histograms = ParseLatencyHistogramsFlags(&argc, argv, &latency_histograms_dump_path);
+
     ::benchmark::Initialize(&argc, argv);
     if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
         return 1;
@@ -103,6 +167,19 @@ int main(int argc, char** argv) {
     ::benchmark::AddCustomContext("CPU Core Count", std::to_string(GetCpuCoreCount()));
     ::benchmark::AddCustomContext("CPU Frequency", std::to_string(GetCpuFrequency()));
     ::benchmark::AddCustomContext("NUMA Node Count", std::to_string(GetNumaNodeCount()));
+    ::benchmark::AddCustomContext("Hashtable Linear Search ISA", hashtable_linear_search_16_isa());
+    ::benchmark::AddCustomContext("Hashtable Control Bytes Search ISA", hashtable_control_bytes_search_32_isa());
+    ::benchmark::AddCustomContext("Hashtable Casecmp ISA", hashtable_casecmp_eq_str_32_isa());
+    ::benchmark::AddCustomContext("Hashtable Casecmp Any Length ISA", hashtable_casecmp_eq_str_isa());
+    ::benchmark::AddCustomContext("Hashtable Cmp Any Length ISA", hashtable_cmp_eq_str_isa());
+    ::benchmark::AddCustomContext("Hashtable Casecmp Many ISA", hashtable_casecmp_eq_str_32_many_isa());
+    ::benchmark::AddCustomContext("Hashtable Hash Casefold ISA", hashtable_support_hash_casefold_isa());
+    if (perf_counters) {
+        ::benchmark::AddCustomContext("Perf Counters", BenchPerfCountersEnable());
+    }
+    if (latency_histograms) {
+        ::benchmark::AddCustomContext("Latency Histograms", BenchHistogramEnable(latency_histograms_dump_path));
+    }
     ::benchmark::RunSpecifiedBenchmarks();
 
     return 0;